@@ -78,6 +78,7 @@ inline constexpr bool is_cpp_message_v = std::is_base_of_v<CppMessage, MessageT>
 // 参数 field_name: 字段名称
 #define _MILLION_DEF_META_FIELD_DATA_IMPL_II(struct_name, i, field_name) \
 	static auto value(struct_name& obj) -> decltype(auto) { return (obj.field_name); } \
+	static auto value(const struct_name& obj) -> decltype(auto) { return (obj.field_name); } \
 	constexpr static const char* name() { return META_TO_STR(field_name); }
 
 // 生成元数据结构体内的字段(第一步)
@@ -0,0 +1,371 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <tuple>
+#include <typeindex>
+#include <type_traits>
+#include <unordered_map>
+#include <shared_mutex>
+
+#include <million/api.h>
+#include <million/noncopyable.h>
+#include <million/cpp_message.h>
+#include <million/net/packet.h>
+
+namespace million {
+
+// 由注册时的类型名哈希(FNV-1a)得到，与编译器及加载顺序无关，各节点一致
+using CppMessageTypeId = uint32_t;
+constexpr CppMessageTypeId kCppMessageTypeIdInvalid = 0;
+
+constexpr CppMessageTypeId MakeCppMessageTypeId(std::string_view type_name) {
+    uint32_t hash = 2166136261u;
+    for (auto c : type_name) {
+        hash ^= static_cast<uint8_t>(c);
+        hash *= 16777619u;
+    }
+    return hash == kCppMessageTypeIdInvalid ? 1 : hash;
+}
+
+class CppMessageWriter {
+public:
+    explicit CppMessageWriter(net::Packet& packet)
+        : packet_(packet) {}
+
+    void WriteBytes(const void* data, size_t size) {
+        auto pos = packet_.size();
+        packet_.resize(pos + size);
+        if (size > 0) {
+            std::memcpy(packet_.data() + pos, data, size);
+        }
+    }
+
+    // 按小端写入
+    template <typename T>
+    void WritePod(T value) {
+        static_assert(std::is_trivially_copyable_v<T>);
+        if constexpr (std::endian::native == std::endian::big && sizeof(T) > 1) {
+            auto bytes = std::bit_cast<std::array<uint8_t, sizeof(T)>>(value);
+            std::reverse(bytes.begin(), bytes.end());
+            value = std::bit_cast<T>(bytes);
+        }
+        WriteBytes(&value, sizeof(value));
+    }
+
+    void WriteVarint(uint64_t value) {
+        uint8_t buf[10];
+        size_t size = 0;
+        while (value >= 0x80) {
+            buf[size++] = static_cast<uint8_t>(value) | 0x80;
+            value >>= 7;
+        }
+        buf[size++] = static_cast<uint8_t>(value);
+        WriteBytes(buf, size);
+    }
+
+private:
+    net::Packet& packet_;
+};
+
+// 越界或格式错误时返回false，之后的读取均失败
+class CppMessageReader {
+public:
+    explicit CppMessageReader(net::PacketSpan span)
+        : span_(span) {}
+
+    bool ReadBytes(void* data, size_t size) {
+        if (!ok_ || remaining() < size) {
+            ok_ = false;
+            return false;
+        }
+        if (size > 0) {
+            std::memcpy(data, span_.data() + pos_, size);
+        }
+        pos_ += size;
+        return true;
+    }
+
+    template <typename T>
+    bool ReadPod(T* value) {
+        static_assert(std::is_trivially_copyable_v<T>);
+        if (!ReadBytes(value, sizeof(T))) {
+            return false;
+        }
+        if constexpr (std::endian::native == std::endian::big && sizeof(T) > 1) {
+            auto bytes = std::bit_cast<std::array<uint8_t, sizeof(T)>>(*value);
+            std::reverse(bytes.begin(), bytes.end());
+            *value = std::bit_cast<T>(bytes);
+        }
+        return true;
+    }
+
+    bool ReadVarint(uint64_t* value) {
+        uint64_t result = 0;
+        for (uint32_t shift = 0; shift < 64; shift += 7) {
+            uint8_t byte;
+            if (!ReadBytes(&byte, sizeof(byte))) {
+                return false;
+            }
+            result |= static_cast<uint64_t>(byte & 0x7f) << shift;
+            if ((byte & 0x80) == 0) {
+                *value = result;
+                return true;
+            }
+        }
+        ok_ = false;
+        return false;
+    }
+
+    // 读取长度，每个元素至少min_size字节，超出剩余字节数时视为格式错误，避免按恶意长度分配内存
+    // 元素可能不占字节时(min_size为0)以包的最大长度为上限
+    bool ReadLength(size_t min_size, size_t* length) {
+        uint64_t value;
+        if (!ReadVarint(&value)) {
+            return false;
+        }
+        auto limit = min_size > 0 ? remaining() / min_size : net::kPacketMaxSize;
+        if (value > limit) {
+            ok_ = false;
+            return false;
+        }
+        *length = static_cast<size_t>(value);
+        return true;
+    }
+
+    size_t remaining() const { return span_.size() - pos_; }
+    bool ok() const { return ok_; }
+
+private:
+    net::PacketSpan span_;
+    size_t pos_ = 0;
+    bool ok_ = true;
+};
+
+// 字段编解码，未特化的字段类型在编码该消息时编译报错
+template <typename T>
+struct CppFieldCodec {
+    static_assert(sizeof(T) == 0, "Unsupported CppMessage field type.");
+};
+
+template <typename MsgT, size_t kIndex>
+using CppMessageFieldType = std::remove_cvref_t<decltype(MsgT::template MetaFieldData<kIndex>::value(std::declval<MsgT&>()))>;
+
+// 宽度随平台变化的整数类型(如Windows上long为32位、wchar_t为16位)，按固定宽度编码，保证各节点一致
+template <typename T>
+struct CppFieldWireType { using type = T; };
+template <>
+struct CppFieldWireType<long> { using type = int64_t; };
+template <>
+struct CppFieldWireType<unsigned long> { using type = uint64_t; };
+template <>
+struct CppFieldWireType<wchar_t> { using type = uint32_t; };
+
+template <typename T>
+    requires std::is_arithmetic_v<T> || std::is_enum_v<T>
+struct CppFieldCodec<T> {
+    using WireType = typename CppFieldWireType<T>::type;
+
+    static void Encode(CppMessageWriter& writer, const T& value) {
+        if constexpr (std::is_same_v<T, bool>) {
+            writer.WritePod(static_cast<uint8_t>(value));
+        }
+        else {
+            writer.WritePod(static_cast<WireType>(value));
+        }
+    }
+
+    static std::optional<T> Decode(CppMessageReader& reader) {
+        if constexpr (std::is_same_v<T, bool>) {
+            uint8_t value;
+            if (!reader.ReadPod(&value)) return std::nullopt;
+            return value != 0;
+        }
+        else {
+            WireType value;
+            if (!reader.ReadPod(&value)) return std::nullopt;
+            // 对端的类型更宽时，超出本节点范围的值视为解码失败
+            if (static_cast<WireType>(static_cast<T>(value)) != value) return std::nullopt;
+            return static_cast<T>(value);
+        }
+    }
+};
+
+template <>
+struct CppFieldCodec<std::string> {
+    static void Encode(CppMessageWriter& writer, const std::string& value) {
+        writer.WriteVarint(value.size());
+        writer.WriteBytes(value.data(), value.size());
+    }
+
+    static std::optional<std::string> Decode(CppMessageReader& reader) {
+        size_t size;
+        if (!reader.ReadLength(1, &size)) return std::nullopt;
+        std::string value(size, '\0');
+        if (!reader.ReadBytes(value.data(), size)) return std::nullopt;
+        return value;
+    }
+};
+
+template <typename T>
+struct CppFieldCodec<std::vector<T>> {
+    // 小端机器上固定宽度的数值数组整块拷贝
+    static constexpr bool kBulk = (std::is_arithmetic_v<T> || std::is_enum_v<T>)
+        && !std::is_same_v<T, bool> && std::is_same_v<typename CppFieldWireType<T>::type, T>
+        && std::endian::native == std::endian::little;
+
+    static void Encode(CppMessageWriter& writer, const std::vector<T>& value) {
+        writer.WriteVarint(value.size());
+        if constexpr (kBulk) {
+            writer.WriteBytes(value.data(), value.size() * sizeof(T));
+        }
+        else {
+            for (const auto& element : value) {
+                CppFieldCodec<T>::Encode(writer, element);
+            }
+        }
+    }
+
+    static std::optional<std::vector<T>> Decode(CppMessageReader& reader) {
+        std::vector<T> value;
+        if constexpr (kBulk) {
+            size_t size;
+            if (!reader.ReadLength(sizeof(T), &size)) return std::nullopt;
+            value.resize(size);
+            if (!reader.ReadBytes(value.data(), size * sizeof(T))) return std::nullopt;
+        }
+        else {
+            // 空消息等元素可能不占字节，不按长度预分配
+            size_t size;
+            if (!reader.ReadLength(0, &size)) return std::nullopt;
+            value.reserve(std::min(size, reader.remaining()));
+            for (size_t i = 0; i < size; ++i) {
+                auto element = CppFieldCodec<T>::Decode(reader);
+                if (!element) return std::nullopt;
+                value.emplace_back(std::move(*element));
+            }
+        }
+        return value;
+    }
+};
+
+template <typename T>
+struct CppFieldCodec<std::optional<T>> {
+    static void Encode(CppMessageWriter& writer, const std::optional<T>& value) {
+        writer.WritePod(static_cast<uint8_t>(value.has_value()));
+        if (value) {
+            CppFieldCodec<T>::Encode(writer, *value);
+        }
+    }
+
+    static std::optional<std::optional<T>> Decode(CppMessageReader& reader) {
+        uint8_t has_value;
+        if (!reader.ReadPod(&has_value)) return std::nullopt;
+        if (!has_value) return std::optional<T>();
+        auto value = CppFieldCodec<T>::Decode(reader);
+        if (!value) return std::nullopt;
+        return std::optional<T>(std::move(*value));
+    }
+};
+
+// 嵌套的消息按字段顺序依次编码，不写字段名及类型
+template <typename T>
+    requires is_cpp_message_v<T>
+struct CppFieldCodec<T> {
+    static void Encode(CppMessageWriter& writer, const T& msg) {
+        if constexpr (requires { T::kMetaFieldCount; }) {
+            ForeachMetaFieldData(msg, [&](auto field) {
+                using FieldData = decltype(field);
+                const auto& value = FieldData::value(msg);
+                CppFieldCodec<std::remove_cvref_t<decltype(value)>>::Encode(writer, value);
+            });
+        }
+    }
+
+    static std::optional<T> Decode(CppMessageReader& reader) {
+        if constexpr (requires { T::kMetaFieldCount; }) {
+            return DecodeFields(reader, std::make_index_sequence<T::kMetaFieldCount>{});
+        }
+        else {
+            return T();
+        }
+    }
+
+private:
+    template <size_t... I>
+    static std::optional<T> DecodeFields(CppMessageReader& reader, std::index_sequence<I...>) {
+        // 花括号初始化保证按字段顺序求值
+        std::tuple<std::optional<CppMessageFieldType<T, I>>...> fields{ CppFieldCodec<CppMessageFieldType<T, I>>::Decode(reader)... };
+        if (!(std::get<I>(fields) && ...)) {
+            return std::nullopt;
+        }
+        return std::optional<T>(std::in_place, std::move(*std::get<I>(fields))...);
+    }
+};
+
+// 可跨节点传输的CppMessage的注册表
+// 编码格式: 类型id(4字节小端) + 按定义顺序的各字段
+//     数值及枚举: 小端定长; bool: 1字节
+//     std::string/std::vector: varint长度 + 元素
+//     std::optional: 1字节标记 + 值
+//     嵌套的消息: 各字段依次编码
+class MILLION_API CppMessageCodec : noncopyable {
+public:
+    using EncodeFunction = void(*)(CppMessageWriter& writer, const CppMessage& msg);
+    using DecodeFunction = CppMessageUnique(*)(CppMessageReader& reader);
+
+    // 各节点需以相同的type_name注册，重复注册同一类型返回true，与其他类型的id冲突时返回false
+    template <typename MsgT>
+    bool Register(std::string_view type_name) {
+        static_assert(is_cpp_message_v<MsgT>, "Unsupported message type.");
+        return Register(MakeCppMessageTypeId(type_name), MsgT::type_static(), &EncodeMessageImpl<MsgT>, &DecodeMessageImpl<MsgT>);
+    }
+    bool Register(CppMessageTypeId type_id, const std::type_info& type, EncodeFunction encode, DecodeFunction decode);
+
+    std::optional<CppMessageTypeId> FindTypeId(const std::type_info& type) const;
+    bool Registered(const CppMessage& msg) const { return FindTypeId(msg.type()).has_value(); }
+
+    std::optional<net::Packet> EncodeMessage(const CppMessage& msg) const;
+    // 未注册的类型、格式错误或有多余字节时返回nullptr
+    CppMessageUnique DecodeMessage(net::PacketSpan packet) const;
+
+private:
+    template <typename MsgT>
+    static void EncodeMessageImpl(CppMessageWriter& writer, const CppMessage& msg) {
+        CppFieldCodec<MsgT>::Encode(writer, static_cast<const MsgT&>(msg));
+    }
+
+    template <typename MsgT>
+    static CppMessageUnique DecodeMessageImpl(CppMessageReader& reader) {
+        auto msg = CppFieldCodec<MsgT>::Decode(reader);
+        if (!msg) {
+            return nullptr;
+        }
+        return std::make_unique<MsgT>(std::move(*msg));
+    }
+
+private:
+    struct Encoder {
+        CppMessageTypeId type_id;
+        EncodeFunction encode;
+    };
+    struct Decoder {
+        std::type_index type;
+        DecodeFunction decode;
+    };
+
+    // 注册通常在初始化时完成，编解码只读
+    mutable std::shared_mutex mutex_;
+    std::unordered_map<std::type_index, Encoder> encoders_;
+    std::unordered_map<CppMessageTypeId, Decoder> decoders_;
+};
+
+} // namespace million
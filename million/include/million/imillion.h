@@ -7,9 +7,13 @@
 #include <million/exception.h>
 #include <million/noncopyable.h>
 #include <million/message.h>
+#include <million/mailbox_def.h>
+#include <million/trace_def.h>
+#include <million/metrics.h>
 #include <million/iservice.h>
 #include <million/logger.h>
 #include <million/proto_mgr.h>
+#include <million/cpp_message_codec.h>
 
 #ifdef WIN32
 #undef StartService
@@ -47,6 +51,16 @@ public:
         return handle;
     }
 
+    // 分片模式下，将服务固定放置到指定worker，非分片模式下与NewService相同
+    template <typename IServiceT, typename ...Args>
+    std::optional<ServiceHandle> NewServiceOnShard(size_t shard_id, Args&&... args) {
+        auto iservice = std::make_unique<IServiceT>(this, std::forward<Args>(args)...);
+        auto handle = AddService(std::move(iservice), shard_id);
+        if (!handle) return std::nullopt;
+        StartService(*handle, nullptr);
+        return handle;
+    }
+
     template <typename IServiceT, typename ...Args>
     std::optional<ServiceHandle> NewServiceWithoutStart(Args&&... args) {
         auto iservice = std::make_unique<IServiceT>(this, std::forward<Args>(args)...);
@@ -102,20 +116,25 @@ public:
 
     SessionId NewSession();
 
-    std::optional<SessionId> Send(const ServiceHandle& sender, const ServiceHandle& target, MessagePointer msg);
+    std::optional<SessionId> Send(const ServiceHandle& sender, const ServiceHandle& target, MessagePointer msg, SessionDeadline deadline = kSessionDeadlineNone);
     
     template <typename MsgT, typename ...Args>
     std::optional<SessionId> Send(const ServiceHandle& sender, const ServiceHandle& target, Args&&... args) {
         return Send(sender, target, make_message<MsgT>(std::forward<Args>(args)...));
     }
 
-    bool SendTo(const ServiceHandle& sender, const ServiceHandle& target, SessionId session_id, MessagePointer msg);
+    bool SendTo(const ServiceHandle& sender, const ServiceHandle& target, SessionId session_id, MessagePointer msg, SessionDeadline deadline = kSessionDeadlineNone);
     
     template <typename MsgT, typename ...Args>
     bool SendTo(const ServiceHandle& sender, const ServiceHandle& target, SessionId session_id, Args&&... args) {
         return SendTo(sender, target, session_id, make_message<MsgT>(std::forward<Args>(args)...));
     }
 
+    // 投递失败时不会移走msg，可用于重试
+    MailboxPushResult TrySendTo(const ServiceHandle& sender, const ServiceHandle& target, SessionId session_id, MessagePointer& msg);
+    // target邮箱出现空位时，向waiter回复wait_session_id；target邮箱未满时返回false
+    bool WaitMailboxWritable(const ServiceHandle& waiter, const ServiceHandle& target, SessionId wait_session_id);
+
     template <typename MsgT>
     SessionAwaiter<MsgT> Recv(SessionId session_id) {
         // 0表示默认超时时间
@@ -146,6 +165,31 @@ public:
     }
 
     void EnableSeparateWorker(const ServiceHandle& service);
+    // 开启后，目标空闲时由发送方所在的工作线程直接处理请求，需在服务开始接收消息前调用
+    void EnableDirectDispatch(const ServiceHandle& service);
+
+    // 开启后回复及服务控制类消息(超时/停止/退出等)先于普通请求被处理
+    void EnablePriorityLanes(const ServiceHandle& service, bool enable = true);
+
+    // 设置服务邮箱容量，仅限制请求消息，回复及服务控制类消息不受限制
+    void SetMailboxCapacity(const ServiceHandle& service, size_t capacity, MailboxFullPolicy policy = MailboxFullPolicy::kReject);
+    std::optional<MailboxStats> GetMailboxStats(const ServiceHandle& service);
+
+    // 指标注册表，模块可以注册自定义指标
+    MetricsRegistry& metrics();
+    // 合并所有线程的指标并生成快照，服务中也可以向metrics_service发送MetricsSnapshotReq获取
+    MetricsSnapshot GetMetricsSnapshot();
+    const std::optional<ServiceHandle>& metrics_service();
+
+    // 将追踪器中各线程最近记录的事件导出为Chrome trace JSON文件，未开启'tracer'时只包含线程信息
+    bool DumpTrace(std::string_view path);
+    bool TraceEnabled();
+    // 当前线程正在处理的消息所属的追踪上下文，未开启'tracer'时无效
+    TraceContext GetTraceContext();
+    // 替换当前的追踪上下文，本次处理中之后发出的消息都将携带该上下文，用于恢复从其他节点收到的上下文
+    void SetTraceContext(const TraceContext& context);
+    // 记录已结束的区间，如跨节点调用的一跳，仅在上下文被采样时记录，name需在进程生命周期内有效
+    void RecordTraceSpan(const char* name, ServiceId service_id, const TraceContext& context, uint64_t begin_ns, uint64_t end_ns);
 
     const YAML::Node& YamlSettings() const;
     asio::io_context& NextIoContext();
@@ -153,6 +197,8 @@ public:
     NodeId node_id();
     Logger& logger();
     ProtoMgr& proto_mgr();
+    // 可跨节点传输的CppMessage的注册表
+    CppMessageCodec& cpp_codec();
     Million& impl() { return *impl_; }
 
 protected:
@@ -161,7 +207,7 @@ protected:
     virtual void OnExit() { }
 
 private:
-    std::optional<ServiceHandle> AddService(std::unique_ptr<IService> iservice);
+    std::optional<ServiceHandle> AddService(std::unique_ptr<IService> iservice, std::optional<size_t> shard_id = std::nullopt);
 
 private:
     Million* impl_;
@@ -171,6 +217,33 @@ inline std::optional<SessionId> IService::Send(const ServiceHandle& target, Mess
     return imillion_->Send(service_handle_, target, std::move(msg));
 }
 
+inline std::optional<SessionId> IService::SendWithDeadline(const ServiceHandle& target, SessionDeadline deadline, MessagePointer msg) {
+    return imillion_->Send(service_handle_, target, std::move(msg), deadline);
+}
+
+inline Task<std::optional<SessionId>> IService::SendAsync(const ServiceHandle& target, MessagePointer msg) {
+    auto session_id = imillion_->NewSession();
+    while (true) {
+        auto res = imillion_->TrySendTo(service_handle_, target, session_id, msg);
+        if (res == MailboxPushResult::kSuccess) {
+            co_return session_id;
+        }
+        if (res != MailboxPushResult::kWouldBlock) {
+            co_return std::nullopt;
+        }
+        auto wait_session_id = imillion_->NewSession();
+        if (!imillion_->WaitMailboxWritable(service_handle_, target, wait_session_id)) {
+            // 登记前邮箱已出现空位，直接重试
+            continue;
+        }
+        auto writable_msg = co_await RecvOrNull(wait_session_id);
+        if (!writable_msg) {
+            // 等待超时
+            co_return std::nullopt;
+        }
+    }
+}
+
 inline bool IService::SendTo(const ServiceHandle& target, SessionId session_id, MessagePointer msg) {
     return imillion_->SendTo(service_handle_, target, session_id, std::move(msg)) != kSessionIdInvalid;
 }
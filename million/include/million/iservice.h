@@ -8,6 +8,7 @@
 #include <million/api.h>
 #include <million/noncopyable.h>
 #include <million/session_def.h>
+#include <million/trace_def.h>
 #include <million/message.h>
 #include <million/service_handle.h>
 #include <million/service_lock.h>
@@ -20,10 +21,12 @@ using ServiceTypeKey = std::type_index;
 
 class MessageElementWithWeakSender : public noncopyable {
 public:
-    MessageElementWithWeakSender(ServiceHandle sender, SessionId session_id, MessagePointer message) :
+    MessageElementWithWeakSender(ServiceHandle sender, SessionId session_id, MessagePointer message, SessionDeadline deadline = kSessionDeadlineNone, TraceContext trace_context = {}) :
         sender_(std::move(sender)),
         session_id_(session_id),
-        message_(std::move(message)) {}
+        message_(std::move(message)),
+        deadline_(deadline),
+        trace_context_(trace_context) {}
     ~MessageElementWithWeakSender() = default;
 
     MessageElementWithWeakSender(MessageElementWithWeakSender&&) noexcept = default;
@@ -33,19 +36,24 @@ public:
     SessionId session_id() const { return session_id_; }
     const MessagePointer& message() const { return message_; }
     MessagePointer& message() { return message_; }
+    SessionDeadline deadline() const { return deadline_; }
+    const TraceContext& trace_context() const { return trace_context_; }
 
 private:
     ServiceHandle sender_;
     SessionId session_id_;
     MessagePointer message_;
+    SessionDeadline deadline_;
+    TraceContext trace_context_;
 };
 
 class MessageElementWithStrongSender : public noncopyable {
 public:
-    MessageElementWithStrongSender(ServiceShared sender, SessionId session_id, MessagePointer message) :
+    MessageElementWithStrongSender(ServiceShared sender, SessionId session_id, MessagePointer message, SessionDeadline deadline = kSessionDeadlineNone) :
         sender_(std::move(sender)),
         session_id_(session_id),
-        message_(std::move(message)) {}
+        message_(std::move(message)),
+        deadline_(deadline) {}
     ~MessageElementWithStrongSender() = default;
 
     MessageElementWithStrongSender(MessageElementWithStrongSender&&) noexcept = default;
@@ -55,11 +63,22 @@ public:
     SessionId session_id() const { return session_id_; }
     const MessagePointer& message() const { return message_; }
     MessagePointer& message() { return message_; }
+    // 请求的截止时间，超过后目标服务不再处理该请求
+    SessionDeadline deadline() const { return deadline_; }
+    // 进入邮箱的时间(steady clock纳秒)，仅在开启指标统计时记录
+    uint64_t enqueue_ns() const { return enqueue_ns_; }
+    void set_enqueue_ns(uint64_t enqueue_ns) { enqueue_ns_ = enqueue_ns; }
+    // 发送方的追踪上下文，仅在开启追踪时记录
+    const TraceContext& trace_context() const { return trace_context_; }
+    void set_trace_context(const TraceContext& trace_context) { trace_context_ = trace_context; }
 
 private:
     ServiceShared sender_;
     SessionId session_id_;
     MessagePointer message_;
+    SessionDeadline deadline_;
+    uint64_t enqueue_ns_ = 0;
+    TraceContext trace_context_;
 };
 
 template <typename MessageT, typename ServiceT>
@@ -96,6 +115,22 @@ public:
         return Send(target, make_message<MessageT>(std::forward<Args>(args)...));
     }
 
+    // 超过截止时间仍未被处理的请求，会被目标服务丢弃
+    std::optional<SessionId> SendWithDeadline(const ServiceHandle& target, SessionDeadline deadline, MessagePointer msg);
+
+    template <typename MessageT, typename ...Args>
+    std::optional<SessionId> SendWithDeadline(const ServiceHandle& target, SessionDeadline deadline, Args&&... args) {
+        return SendWithDeadline(target, deadline, make_message<MessageT>(std::forward<Args>(args)...));
+    }
+
+    // 目标邮箱已满且策略为kSuspend时，挂起直到邮箱出现空位再投递
+    Task<std::optional<SessionId>> SendAsync(const ServiceHandle& target, MessagePointer msg);
+
+    template <typename MessageT, typename ...Args>
+    Task<std::optional<SessionId>> SendAsync(const ServiceHandle& target, Args&&... args) {
+        return SendAsync(target, make_message<MessageT>(std::forward<Args>(args)...));
+    }
+
     bool SendTo(const ServiceHandle& target, SessionId session_id, MessagePointer msg);
 
     template <typename MessageT, typename ...Args>
@@ -163,13 +198,13 @@ public:
 
     template <typename SendMessageT, typename RecvMessageT, typename ...SendArgsT>
     SessionAwaiter<RecvMessageT> CallWithTimeout(const ServiceHandle& target, uint32_t timeout_s, SendArgsT&&... args) {
-        auto session_id = Send<SendMessageT>(target, std::forward<SendArgsT>(args)...);
+        auto session_id = SendWithDeadline<SendMessageT>(target, SessionDeadlineAfter(timeout_s), std::forward<SendArgsT>(args)...);
         return RecvWithTimeout<RecvMessageT>(session_id.value(), timeout_s);
     }
 
     template <typename MessageT, typename ...Args>
     SessionAwaiterBase CallWithTimeout(const ServiceHandle& target, uint32_t timeout_s, Args&&... args) {
-        auto session_id = Send<MessageT>(target, std::forward<Args>(args)...);
+        auto session_id = SendWithDeadline<MessageT>(target, SessionDeadlineAfter(timeout_s), std::forward<Args>(args)...);
         return RecvWithTimeout(session_id.value(), timeout_s);
     }
 
@@ -187,13 +222,13 @@ public:
 
     template <typename SendMessageT, typename RecvMessageT, typename ...SendArgsT>
     SessionAwaiter<RecvMessageT> CallOrNullWithTimeout(const ServiceHandle& target, uint32_t timeout_s, SendArgsT&&... args) {
-        auto session_id = Send<SendMessageT>(target, std::forward<SendArgsT>(args)...);
+        auto session_id = SendWithDeadline<SendMessageT>(target, SessionDeadlineAfter(timeout_s), std::forward<SendArgsT>(args)...);
         return RecvOrNullWithTimeout<RecvMessageT>(session_id.value(), timeout_s);
     }
 
     template <typename MessageT, typename ...Args>
     SessionAwaiterBase CallOrNullWithTimeout(const ServiceHandle& target, uint32_t timeout_s, Args&&... args) {
-        auto session_id = Send<MessageT>(target, std::forward<Args>(args)...);
+        auto session_id = SendWithDeadline<MessageT>(target, SessionDeadlineAfter(timeout_s), std::forward<Args>(args)...);
         return RecvOrNullWithTimeout(session_id.value(), timeout_s);
     }
 
@@ -221,6 +256,10 @@ protected:
 
     virtual ServiceTypeKey GetTypeKey() = 0;
 
+    // 当前分发的请求的截止时间，仅在处理函数首次挂起前有效
+    SessionDeadline msg_deadline() const { return msg_deadline_; }
+    void set_msg_deadline(SessionDeadline deadline) { msg_deadline_ = deadline; }
+
     Task<MessagePointer> MessageDispatch(ServiceHandle sender, SessionId session_id, MessagePointer msg) {
         auto handler = FindMessageHandler(msg);
         if (handler) {
@@ -280,6 +319,7 @@ private:
     IMillion* imillion_;
     ServiceShared service_shared_;
     ServiceHandle service_handle_;
+    SessionDeadline msg_deadline_ = kSessionDeadlineNone;
 
     struct TypeIndexPair {
         ServiceTypeKey service_type_key;
@@ -0,0 +1,133 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+#include <array>
+#include <format>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+
+namespace million {
+
+// 异步日志记录中参数的编码
+// 算术类型及指针按原始字节写入，字符串写入长度及内容，由后台线程解码后再格式化
+// 其他类型(如自定义formatter的类型)无法编码，整条日志在调用方格式化后以字符串写入
+// kTypeKind及kTypeSize描述编码后的类型，写入二进制日志的字典供离线解码:
+// b:bool c:char i:有符号整数 u:无符号整数 f:浮点数 p:指针 n:nullptr s:字符串，kTypeSize为字节数
+template <typename T, typename = void>
+struct LogArgTraits {
+    static constexpr bool kEncodable = false;
+};
+
+template <typename T>
+struct LogArgTraits<T, std::enable_if_t<std::is_arithmetic_v<T> || std::is_same_v<T, std::nullptr_t>
+    || std::is_same_v<T, void*> || std::is_same_v<T, const void*>>> {
+    static constexpr bool kEncodable = true;
+    static constexpr char kTypeKind = std::is_same_v<T, bool> ? 'b'
+        : std::is_same_v<T, char> ? 'c'
+        : std::is_floating_point_v<T> ? 'f'
+        : std::is_same_v<T, std::nullptr_t> ? 'n'
+        : std::is_pointer_v<T> ? 'p'
+        : std::is_signed_v<T> ? 'i' : 'u';
+    static constexpr uint8_t kTypeSize = sizeof(T);
+    using Decoded = T;
+
+    static size_t Size(const T&) {
+        return sizeof(T);
+    }
+
+    static uint8_t* Encode(uint8_t* buf, const T& value) {
+        std::memcpy(buf, &value, sizeof(T));
+        return buf + sizeof(T);
+    }
+
+    static T Decode(const uint8_t** buf) {
+        T value;
+        std::memcpy(&value, *buf, sizeof(T));
+        *buf += sizeof(T);
+        return value;
+    }
+};
+
+struct LogStringArgTraits {
+    static constexpr bool kEncodable = true;
+    static constexpr char kTypeKind = 's';
+    static constexpr uint8_t kTypeSize = 0;
+    using Decoded = std::string_view;
+
+    static size_t Size(std::string_view value) {
+        return sizeof(uint32_t) + value.size();
+    }
+
+    static uint8_t* Encode(uint8_t* buf, std::string_view value) {
+        auto size = static_cast<uint32_t>(value.size());
+        std::memcpy(buf, &size, sizeof(size));
+        std::memcpy(buf + sizeof(size), value.data(), value.size());
+        return buf + sizeof(size) + value.size();
+    }
+
+    static std::string_view Decode(const uint8_t** buf) {
+        uint32_t size;
+        std::memcpy(&size, *buf, sizeof(size));
+        std::string_view value(reinterpret_cast<const char*>(*buf + sizeof(size)), size);
+        *buf += sizeof(size) + size;
+        return value;
+    }
+};
+
+template <> struct LogArgTraits<std::string> : LogStringArgTraits {};
+template <> struct LogArgTraits<std::string_view> : LogStringArgTraits {};
+template <> struct LogArgTraits<const char*> : LogStringArgTraits {};
+template <> struct LogArgTraits<char*> : LogStringArgTraits {};
+template <size_t N> struct LogArgTraits<char[N]> : LogStringArgTraits {};
+
+template <typename T>
+using LogArg = LogArgTraits<std::remove_cvref_t<T>>;
+
+template <typename... Args>
+constexpr bool kLogArgsEncodable = (LogArg<Args>::kEncodable && ...);
+
+// 每个参数两个字符: 类型及'0'+字节数
+template <typename... Args>
+constexpr auto MakeLogArgTypes() {
+    std::array<char, sizeof...(Args) * 2 + 1> types{};
+    size_t i = 0;
+    ((types[i++] = LogArg<Args>::kTypeKind, types[i++] = static_cast<char>('0' + LogArg<Args>::kTypeSize)), ...);
+    return types;
+}
+
+template <typename... Args>
+inline constexpr auto kLogArgTypes = MakeLogArgTypes<Args...>();
+
+template <typename... Args>
+constexpr std::string_view LogArgTypes() {
+    return std::string_view(kLogArgTypes<Args...>.data(), sizeof...(Args) * 2);
+}
+
+template <typename... Args>
+size_t LogArgsSize(const Args&... args) {
+    return (size_t(0) + ... + LogArg<Args>::Size(args));
+}
+
+template <typename... Args>
+void EncodeLogArgs(uint8_t* buf, const Args&... args) {
+    ((buf = LogArg<Args>::Encode(buf, args)), ...);
+}
+
+// 解码参数并按格式追加到out，每个日志位置在注册时记录对应参数类型的实例
+using LogFormatFunc = void(*)(std::string* out, std::string_view fmt, const uint8_t* args);
+
+template <typename... Args>
+void FormatLogArgs(std::string* out, std::string_view fmt, [[maybe_unused]] const uint8_t* args) {
+    // 花括号初始化保证按参数顺序解码
+    std::tuple<typename LogArg<Args>::Decoded...> values{ LogArg<Args>::Decode(&args)... };
+    std::apply([&](auto&... value) {
+        std::vformat_to(std::back_inserter(*out), fmt, std::make_format_args(value...));
+    }, values);
+}
+
+} // namespace million
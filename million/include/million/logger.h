@@ -1,14 +1,28 @@
 #pragma once
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <span>
 #include <string>
 #include <format>
 #include <source_location>
+#include <type_traits>
 
 #include <million/message.h>
 #include <million/service_handle.h>
+#include <million/log_record.h>
 
 namespace million {
 
+// 编译期日志级别阈值(0:trace ... 6:off)，低于该级别的LOG_*调用会被if constexpr整体移除
+#ifndef MILLION_LOG_ACTIVE_LEVEL
+#define MILLION_LOG_ACTIVE_LEVEL 0
+#endif
+
 struct SourceLocation {
     uint32_t line;
     uint32_t column;
@@ -16,6 +30,26 @@ struct SourceLocation {
     std::string function_name;
 };
 
+// 日志位置的id，由LOG_*宏在首次调用时注册并缓存，0表示未注册
+using LogSiteId = uint32_t;
+constexpr LogSiteId kLogSiteIdInvalid = 0;
+
+struct AsyncLogOptions {
+    uint32_t ring_size = 1024 * 1024;       // 每个线程的环形缓冲区字节数，向上取整为2的幂
+    uint32_t flush_interval_ms = 1;         // 后台线程轮询缓冲区的间隔
+    bool sync_on_overflow = false;          // 缓冲区满时在调用线程同步写入，否则丢弃并计数
+};
+
+// 每个调用位置的限流(令牌桶)，rate为每秒允许的条数，0表示不限制，burst为允许的突发条数
+struct LogRateLimit {
+    uint32_t rate = 0;
+    uint32_t burst = 1;
+};
+
+struct LogSite;
+struct LogSiteState;
+class LogSink;
+class LogWriter;
 class Million;
 class MILLION_API Logger {
 public:
@@ -48,10 +82,55 @@ public:
         Log(logger_svr_handle_, std::move(source), level, str);
     }
 
+    // 由LOG_*宏调用，先按编译期阈值及当前级别过滤，通过后才编码或格式化参数
+    template <LogLevel kLevel, typename Formatter>
+    void Log(const std::source_location& source, std::integral_constant<LogLevel, kLevel>, Formatter&& formatter);
+
     void SetLevel(LogLevel level) {
+        UpdateLevel(level);
         SetLevel(logger_svr_handle_, level);
     }
 
+    bool ShouldLog(LogLevel level) const {
+        return level >= level_.load(std::memory_order_relaxed);
+    }
+
+    LogLevel level() const {
+        return level_.load(std::memory_order_relaxed);
+    }
+
+    // 仅更新调用方过滤使用的级别，由日志服务在加载配置及处理LoggerSetLevel时调用
+    void UpdateLevel(LogLevel level) {
+        level_.store(level, std::memory_order_relaxed);
+    }
+
+    // 开启异步日志，LOG_*宏的参数编码写入各线程的环形缓冲区，由后台线程格式化后批量写入sink
+    // sink需在StopAsync返回前保持有效
+    bool StartAsync(LogSink* sink, const AsyncLogOptions& options);
+    // 等待正在写入的线程完成，停止后台线程并写出缓冲区中剩余的日志
+    // 返回后不再访问sink，之后可以重新StartAsync
+    void StopAsync();
+
+    bool async() const {
+        return async_running_.load(std::memory_order_acquire);
+    }
+
+    // 缓冲区满而被丢弃的日志数
+    uint64_t dropped() const;
+
+    // 设置该级别每个调用位置的限流，由日志服务加载配置时调用
+    void SetRateLimit(LogLevel level, const LogRateLimit& limit);
+    // 为限流期间丢弃过日志的位置各输出一条汇总，由日志服务定时调用
+    void ReportSuppressed();
+
+    // 因限流而被丢弃的日志数，在输出汇总时累加
+    uint64_t suppressed() const {
+        return suppressed_.load(std::memory_order_relaxed);
+    }
+
+    // 注册日志位置，返回的id在进程生命周期内有效
+    static LogSiteId RegisterSite(const std::source_location& source, LogLevel level, std::string_view fmt, std::string_view arg_types, LogFormatFunc format);
+
     static std::string ExtractFunctionName(std::string_view full_name) {
         auto paren_pos = full_name.find_last_of('(');
         if (paren_pos == std::string_view::npos) {
@@ -73,22 +152,229 @@ private:
     void InitLog(LogLevel level, const char* function_name, uint32_t line, const char* msg);
     void SetLevel(const ServiceHandle& sender, LogLevel level);
 
+    friend class LogWriter;
+    // 在格式化参数前检查限流，返回false表示丢弃
+    bool AcquireRate(LogSiteState* site, const std::source_location& source, LogLevel level);
+    void AddSuppressedSite(LogSiteState* site, const std::source_location& source, LogLevel level);
+    // 异步写入的区间，返回false表示未开启异步日志
+    // 先登记再检查开启标记，与StopAsync中先清除标记再等待登记数归零配合
+    bool BeginAsyncWrite() {
+        async_writers_.fetch_add(1, std::memory_order_seq_cst);
+        if (async_running_.load(std::memory_order_seq_cst)) {
+            return true;
+        }
+        async_writers_.fetch_sub(1, std::memory_order_release);
+        return false;
+    }
+    void EndAsyncWrite() {
+        async_writers_.fetch_sub(1, std::memory_order_release);
+    }
+    // 在当前线程的环形缓冲区中预留记录，返回参数区的起始地址
+    // 缓冲区满或记录过大时返回nullptr，未开启sync_on_overflow时计为丢弃
+    uint8_t* BeginRecord(LogSiteId site_id, size_t args_size);
+    void CommitRecord();
+    // 缓冲区溢出时在调用线程直接写入sink
+    void WriteSync(LogSiteId site_id, std::string_view msg);
+    bool sync_on_overflow() const;
+
 private:
     Million* million_;
     bool is_bind_ = false;
     ServiceHandle logger_svr_handle_;
+    // 日志服务加载配置前不过滤，初始化日志直接输出到控制台
+    std::atomic<LogLevel> level_ = LogLevel::kTrace;
+
+    class AsyncLog;
+    // 保护async_的创建与销毁，写入线程通过async_writers_保证期间async_有效
+    mutable std::mutex async_mutex_;
+    std::unique_ptr<AsyncLog> async_;
+    std::atomic<bool> async_running_ = false;
+    std::atomic<uint32_t> async_writers_ = 0;
+    // 已停止的异步日志累计丢弃的日志数
+    uint64_t stopped_dropped_ = 0;
+
+    // 按级别的限流参数，interval_ns为0表示不限制
+    struct RateLimitState {
+        std::atomic<int64_t> interval_ns = 0;
+        std::atomic<int64_t> tolerance_ns = 0;
+    };
+    std::array<RateLimitState, static_cast<size_t>(LogLevel::kOff) + 1> rate_limits_;
+    std::atomic<uint64_t> suppressed_ = 0;
+};
+
+// LOG_*宏在每个调用位置定义的静态状态
+struct LogSiteState {
+    std::atomic<LogSiteId> id = kLogSiteIdInvalid;
+    // 限流使用GCRA形式的令牌桶，只需一个原子变量: 下一条日志的理论到达时间
+    std::atomic<int64_t> tat_ns = 0;
+    std::atomic<uint64_t> suppressed = 0;
+    std::atomic<bool> listed = false;
+    // 首次被限流时记录，用于输出汇总
+    std::source_location source;
+    Logger::LogLevel level = Logger::LogLevel::kTrace;
+};
+
+struct LogSite {
+    Logger::LogLevel level;
+    const char* file_name;
+    uint32_t line;
+    std::string function_name;
+    std::string_view fmt;
+    std::string_view arg_types;     // 见LogArgTraits
+    LogFormatFunc format;
+};
+
+struct LogRecordInfo {
+    LogSiteId site_id;
+    const LogSite* site;
+    std::chrono::system_clock::time_point time;
+    size_t thread_id;
+    ServiceId service_id;           // 写日志时正在处理消息的服务，不在服务中为0
+    const char* service_type;       // 该服务的类型名，不在服务中为nullptr
+    bool text_only;                 // 缓冲区溢出时同步写入的记录，只有格式化后的文本
 };
 
+// 异步日志的输出端，由日志服务实现
+// 由后台线程调用，缓冲区溢出同步写入时也可能由调用线程调用，实现需保证线程安全
+class MILLION_API LogSink {
+public:
+    virtual ~LogSink() = default;
+
+    // 写入格式化后的文本
+    virtual void Write(const LogRecordInfo& record, std::string_view msg) = 0;
+
+    // 返回true时后台线程对每条记录调用WriteArgs写入编码后的参数，由输出端自行保存或解码
+    virtual bool WantsArgs() const { return false; }
+    virtual void WriteArgs(const LogRecordInfo& record, std::span<const uint8_t> args) {}
+
+    // 返回false时后台线程不格式化该位置的记录，也不调用Write
+    virtual bool WantsText(const LogSite& site) const { return true; }
+
+    // 后台线程每轮写出后调用
+    virtual void Flush() {}
+
+    // 在写日志的线程上调用，返回的id随记录一起写出
+    virtual size_t CurrentThreadId() = 0;
+};
+
+// 接收LOG_*宏的格式串及参数
+// 未开启异步日志时格式化后发送给日志服务，开启后将参数编码写入当前线程的环形缓冲区
+class LogWriter {
+public:
+    LogWriter(Logger* logger, const std::source_location& source, Logger::LogLevel level)
+        : logger_(logger)
+        , source_(source)
+        , level_(level) {}
+
+    template <typename... Args>
+    void operator()(LogSiteState& site, std::format_string<Args...> fmt, Args&&... args) {
+        if (!logger_->AcquireRate(&site, source_, level_)) {
+            return;
+        }
+        if (!logger_->BeginAsyncWrite()) {
+            logger_->Log(source_, level_, std::format(fmt, std::forward<Args>(args)...));
+            return;
+        }
+        struct AsyncWriteScope {
+            Logger* logger;
+            ~AsyncWriteScope() { logger->EndAsyncWrite(); }
+        } scope{ logger_ };
+        auto id = site.id.load(std::memory_order_acquire);
+        if (id == kLogSiteIdInvalid) {
+            // 并发首次调用可能重复注册，不影响正确性
+            id = RegisterSite<Args...>(fmt.get());
+            site.id.store(id, std::memory_order_release);
+        }
+        if constexpr (kLogArgsEncodable<Args...>) {
+            auto buf = logger_->BeginRecord(id, LogArgsSize(args...));
+            if (buf) {
+                EncodeLogArgs(buf, args...);
+                logger_->CommitRecord();
+            }
+            else if (logger_->sync_on_overflow()) {
+                logger_->WriteSync(id, std::format(fmt, std::forward<Args>(args)...));
+            }
+        }
+        else {
+            auto msg = std::format(fmt, std::forward<Args>(args)...);
+            auto buf = logger_->BeginRecord(id, LogArg<std::string>::Size(msg));
+            if (buf) {
+                EncodeLogArgs(buf, msg);
+                logger_->CommitRecord();
+            }
+            else if (logger_->sync_on_overflow()) {
+                logger_->WriteSync(id, msg);
+            }
+        }
+    }
+
+private:
+    template <typename... Args>
+    LogSiteId RegisterSite(std::string_view fmt) {
+        if constexpr (kLogArgsEncodable<Args...>) {
+            return Logger::RegisterSite(source_, level_, fmt, LogArgTypes<Args...>(), &FormatLogArgs<Args...>);
+        }
+        else {
+            return Logger::RegisterSite(source_, level_, "{}", LogArgTypes<std::string_view>(), &FormatLogArgs<std::string_view>);
+        }
+    }
+
+private:
+    Logger* logger_;
+    const std::source_location& source_;
+    Logger::LogLevel level_;
+};
+
+template <Logger::LogLevel kLevel, typename Formatter>
+void Logger::Log(const std::source_location& source, std::integral_constant<LogLevel, kLevel>, Formatter&& formatter) {
+    if constexpr (static_cast<int>(kLevel) >= MILLION_LOG_ACTIVE_LEVEL) {
+        if (ShouldLog(kLevel)) {
+            formatter(LogWriter(this, source, kLevel));
+        }
+    }
+}
+
+inline bool Logger::AcquireRate(LogSiteState* site, const std::source_location& source, LogLevel level) {
+    auto& limit = rate_limits_[static_cast<size_t>(level)];
+    auto interval = limit.interval_ns.load(std::memory_order_relaxed);
+    if (interval == 0) {
+        return true;
+    }
+    auto tolerance = limit.tolerance_ns.load(std::memory_order_relaxed);
+    auto now = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    auto tat = site->tat_ns.load(std::memory_order_relaxed);
+    while (true) {
+        auto begin = std::max(tat, now);
+        if (begin - now > tolerance) {
+            break;
+        }
+        if (site->tat_ns.compare_exchange_weak(tat, begin + interval, std::memory_order_relaxed)) {
+            return true;
+        }
+    }
+    site->suppressed.fetch_add(1, std::memory_order_relaxed);
+    if (!site->listed.load(std::memory_order_relaxed)) {
+        AddSuppressedSite(site, source, level);
+    }
+    return false;
+}
+
 MILLION_MESSAGE_DEFINE(MILLION_API, LoggerLog, (const std::source_location) source, (Logger::LogLevel) level, (const std::string) msg);
 MILLION_MESSAGE_DEFINE(MILLION_API, LoggerLog2, (SourceLocation) source, (Logger::LogLevel) level, (const std::string) msg);
 MILLION_MESSAGE_DEFINE(MILLION_API, LoggerSetLevel, (Logger::LogLevel) new_level);
 
-#define LOG_TRACE(fmt, ...) Log(std::source_location::current(), ::million::Logger::LogLevel::kTrace, ::std::format(fmt, __VA_ARGS__))
-#define LOG_DEBUG(fmt, ...) Log(std::source_location::current(), ::million::Logger::LogLevel::kDebug, ::std::format(fmt, __VA_ARGS__))
-#define LOG_INFO(fmt, ...) Log(std::source_location::current(), ::million::Logger::LogLevel::kInfo, ::std::format(fmt, __VA_ARGS__))
-#define LOG_WARN(fmt, ...) Log(std::source_location::current(), ::million::Logger::LogLevel::kWarn, ::std::format(fmt, __VA_ARGS__))
-#define LOG_ERROR(fmt, ...) Log(std::source_location::current(), ::million::Logger::LogLevel::kError, ::std::format(fmt, __VA_ARGS__))
-#define LOG_CRITICAL(fmt, ...) Log(std::source_location::current(), ::million::Logger::LogLevel::kCritical, ::std::format(fmt, __VA_ARGS__))
-#define LOG_OFF(fmt, ...) Log(std::source_location::current(), ::million::Logger::LogLevel::kOff, ::std::format(fmt, __VA_ARGS__))
+// 每个调用位置的lambda类型唯一，其中的静态变量保存该位置的LogSiteId及限流状态
+#define MILLION_LOG_IMPL_(level_, fmt, ...) Log(std::source_location::current(), ::std::integral_constant<::million::Logger::LogLevel, level_>{}, [&](auto&& writer_) { \
+    static ::million::LogSiteState site_; \
+    writer_(site_, fmt, __VA_ARGS__); \
+})
+
+#define LOG_TRACE(fmt, ...) MILLION_LOG_IMPL_(::million::Logger::LogLevel::kTrace, fmt, __VA_ARGS__)
+#define LOG_DEBUG(fmt, ...) MILLION_LOG_IMPL_(::million::Logger::LogLevel::kDebug, fmt, __VA_ARGS__)
+#define LOG_INFO(fmt, ...) MILLION_LOG_IMPL_(::million::Logger::LogLevel::kInfo, fmt, __VA_ARGS__)
+#define LOG_WARN(fmt, ...) MILLION_LOG_IMPL_(::million::Logger::LogLevel::kWarn, fmt, __VA_ARGS__)
+#define LOG_ERROR(fmt, ...) MILLION_LOG_IMPL_(::million::Logger::LogLevel::kError, fmt, __VA_ARGS__)
+#define LOG_CRITICAL(fmt, ...) MILLION_LOG_IMPL_(::million::Logger::LogLevel::kCritical, fmt, __VA_ARGS__)
+#define LOG_OFF(fmt, ...) MILLION_LOG_IMPL_(::million::Logger::LogLevel::kOff, fmt, __VA_ARGS__)
 
 } // namespace million
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+namespace million {
+
+// 邮箱容量为0表示不限制
+constexpr size_t kMailboxUnbounded = 0;
+
+// 服务邮箱(消息队列)已满时的处理策略
+enum class MailboxFullPolicy {
+    kReject,        // 拒绝投递新消息，Send返回nullopt
+    kDropOldest,    // 丢弃最旧的一条请求消息，再投递新消息
+    kSuspend,       // 拒绝投递新消息，但通过SendAsync发送时，发送方会挂起直到目标邮箱出现空位
+};
+
+enum class MailboxPushResult {
+    kSuccess,       // 已投递
+    kFull,          // 邮箱已满，未投递
+    kWouldBlock,    // 邮箱已满且策略为kSuspend，未投递，可等待邮箱出现空位后重试
+    kClosed,        // 目标服务不可接收消息(不存在/已停止)，未投递
+};
+
+struct MailboxStats {
+    size_t size = 0;                // 当前邮箱中的消息数
+    size_t capacity = kMailboxUnbounded;
+    MailboxFullPolicy policy = MailboxFullPolicy::kReject;
+    size_t high_water_mark = 0;     // 历史最大消息数
+    uint64_t rejected_count = 0;    // 因邮箱已满被拒绝的消息数(kReject/kDropOldest)
+    uint64_t suspended_count = 0;   // kSuspend策略下因邮箱已满未投递的次数，同一条消息重试时会重复计数
+    uint64_t dropped_count = 0;     // 因邮箱已满被丢弃的旧消息数
+    uint64_t shed_count = 0;        // 因超过截止时间被丢弃的请求数
+};
+
+} // namespace million
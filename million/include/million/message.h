@@ -2,6 +2,7 @@
 
 #include <variant>
 #include <typeindex>
+#include <utility>
 
 #include <million/api.h>
 #include <million/proto_message.h>
@@ -40,6 +41,14 @@ public:
         message_ptr_ = std::move(other.message_ptr_);
     }
 
+    // 开启复用时ProtoMessageUnique带有ProtoMessageDeleter，需要单独的重载，否则模板只能推导default_delete
+    MessagePointer(ProtoMessageUnique&& other) noexcept
+        : message_ptr_(std::in_place_type<ProtoMessageUnique>, std::move(other)) {}
+
+    void operator=(ProtoMessageUnique&& other) noexcept {
+        message_ptr_.emplace<ProtoMessageUnique>(std::move(other));
+    }
+
     template <typename T>
         requires is_proto_message_v<T>
     MessagePointer(std::unique_ptr<T>&& other) noexcept
@@ -51,6 +60,9 @@ public:
         message_ptr_ = ProtoMessageUnique(std::move(other));
     }
 
+    MessagePointer(ProtoMessageArena&& other) noexcept
+        : message_ptr_(std::in_place_type<ProtoMessageArena>, std::move(other)) {}
+
     template <typename T>
         requires is_cpp_message_v<T>
     MessagePointer(std::unique_ptr<T>&& other) noexcept
@@ -85,8 +97,29 @@ public:
     }
 
 
+    // 消息的存储方式
+    bool IsProtoMessageUnique() const {
+        return std::holds_alternative<ProtoMessageUnique>(message_ptr_);
+    }
+
+    bool IsProtoMessageShared() const {
+        return std::holds_alternative<ProtoMessageShared>(message_ptr_);
+    }
+
+    bool IsProtoMessageArena() const {
+        return std::holds_alternative<ProtoMessageArena>(message_ptr_);
+    }
+
+    bool IsCppMessageUnique() const {
+        return std::holds_alternative<CppMessageUnique>(message_ptr_);
+    }
+
+    bool IsCppMessageShared() const {
+        return std::holds_alternative<CppMessageShared>(message_ptr_);
+    }
+
     bool IsProtoMessage() const {
-        return IsProtoMessageUnique() || IsProtoMessageShared();
+        return IsProtoMessageUnique() || IsProtoMessageShared() || IsProtoMessageArena();
     }
 
     bool IsCppMessage() const {
@@ -147,6 +180,9 @@ public:
         else if (IsProtoMessageShared()) {
             return GetProtoMessageShared().get();
         }
+        else if (IsProtoMessageArena()) {
+            return GetProtoMessageArena().get();
+        }
         else {
             throw std::bad_variant_access();
         }
@@ -165,6 +201,9 @@ public:
     }
 
     ProtoMessage* GetMutableProtoMessage() const {
+        if (IsProtoMessageArena()) {
+            return GetProtoMessageArena().get();
+        }
         return GetProtoMessageUnique().get();
     }
 
@@ -177,19 +216,37 @@ public:
         if (IsProtoMessageUnique()) {
             return GetProtoMessageUnique().release();
         }
+        else if (IsProtoMessageArena()) {
+            // Arena上的消息不能单独释放，复制到堆上再交出所有权
+            auto new_msg = CopyProtoMessageToHeap(*GetProtoMessageArena());
+            message_ptr_ = nullptr;
+            return new_msg;
+        }
         else if (IsCppMessageUnique()) {
             return GetCppMessageUnique().release();
         }
         return nullptr;
     }
 
+    // 共享的消息不可修改，替换为独占的副本
+    void MakeMutable() {
+        if (IsProtoMessageShared()) {
+            message_ptr_ = ProtoMessageUnique(CopyProtoMessageToHeap(*GetProtoMessageShared()));
+        }
+        else if (IsCppMessageShared()) {
+            auto new_msg = GetCppMessageShared()->Copy();
+            if (!new_msg) throw std::bad_alloc();
+            message_ptr_ = CppMessageUnique(new_msg);
+        }
+    }
+
     MessagePointer Copy() const {
-        if (IsProtoMessageUnique()) {
+        if (IsProtoMessageUnique() || IsProtoMessageArena()) {
             auto proto_msg = GetProtoMessage();
-            auto new_msg = proto_msg->New();
+            auto new_msg = NewProtoMessage(*proto_msg);
             if (!new_msg) throw std::bad_alloc();
             new_msg->CopyFrom(*proto_msg);
-            return MessagePointer(ProtoMessageUnique(new_msg));
+            return MessagePointer(std::move(new_msg));
         }
         else if (IsProtoMessageShared()) {
             return MessagePointer(GetProtoMessageShared());
@@ -221,22 +278,6 @@ public:
     }
 
 private:
-    bool IsProtoMessageUnique() const {
-        return std::holds_alternative<ProtoMessageUnique>(message_ptr_);
-    }
-
-    bool IsProtoMessageShared() const {
-        return std::holds_alternative<ProtoMessageShared>(message_ptr_);
-    }
-
-    bool IsCppMessageUnique() const {
-        return std::holds_alternative<CppMessageUnique>(message_ptr_);
-    }
-
-    bool IsCppMessageShared() const {
-        return std::holds_alternative<CppMessageShared>(message_ptr_);
-    }
-
     const ProtoMessageUnique& GetProtoMessageUnique() const {
         return std::get<ProtoMessageUnique>(message_ptr_);
     }
@@ -253,6 +294,17 @@ private:
         return std::get<CppMessageShared>(message_ptr_);
     }
 
+    const ProtoMessageArena& GetProtoMessageArena() const {
+        return std::get<ProtoMessageArena>(message_ptr_);
+    }
+
+    static ProtoMessage* CopyProtoMessageToHeap(const ProtoMessage& proto_msg) {
+        auto new_msg = NewProtoMessage(proto_msg);
+        if (!new_msg) throw std::bad_alloc();
+        new_msg->CopyFrom(proto_msg);
+        return new_msg.release();
+    }
+
     ProtoMessageUnique& GetProtoMessageUnique() {
         return std::get<ProtoMessageUnique>(message_ptr_);
     }
@@ -274,10 +326,63 @@ private:
         std::nullptr_t
         , ProtoMessageUnique
         , ProtoMessageShared
+        , ProtoMessageArena
         , CppMessageUnique
         , CppMessageShared> message_ptr_;
 };
 
+// 类型化接收的消息，如co_await Recv<MsgT>的结果
+// 保留原有的存储方式：堆上的proto消息析构时仍经过ProtoMessageDeleter，Arena上的消息共享持有Arena而不复制到堆上
+template <typename MsgT>
+class TypedMessagePointer {
+public:
+    TypedMessagePointer() = default;
+    TypedMessagePointer(std::nullptr_t) {}
+
+    explicit TypedMessagePointer(MessagePointer msg)
+        : msg_(std::move(msg)) {
+        if (!msg_) {
+            return;
+        }
+        msg_.MakeMutable();
+        if constexpr (std::is_same_v<MsgT, ProtoMessage>) {
+            ptr_ = msg_.GetMutableProtoMessage();
+        }
+        else if constexpr (std::is_same_v<MsgT, CppMessage>) {
+            ptr_ = msg_.GetMutableCppMessage();
+        }
+        else {
+            ptr_ = msg_.GetMutableMessage<MsgT>();
+        }
+    }
+
+    TypedMessagePointer(TypedMessagePointer&& other) noexcept
+        : msg_(std::move(other.msg_))
+        , ptr_(std::exchange(other.ptr_, nullptr)) {}
+
+    TypedMessagePointer& operator=(TypedMessagePointer&& other) noexcept {
+        msg_ = std::move(other.msg_);
+        ptr_ = std::exchange(other.ptr_, nullptr);
+        return *this;
+    }
+
+    MsgT* get() const { return ptr_; }
+    MsgT* operator->() const { return ptr_; }
+    MsgT& operator*() const { return *ptr_; }
+    explicit operator bool() const { return ptr_ != nullptr; }
+    bool operator==(std::nullptr_t) const { return ptr_ == nullptr; }
+
+    // 交还所有权，如co_return或转发给其他服务
+    operator MessagePointer() && {
+        ptr_ = nullptr;
+        return std::move(msg_);
+    }
+
+private:
+    MessagePointer msg_;
+    MsgT* ptr_ = nullptr;
+};
+
 template <typename MessageT, typename... Args>
 inline MessagePointer make_message(Args&&... args) {
     if constexpr (is_proto_message_v<MessageT>) {
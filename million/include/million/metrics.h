@@ -0,0 +1,209 @@
+#pragma once
+
+#include <cstdint>
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <million/api.h>
+#include <million/noncopyable.h>
+#include <million/message.h>
+
+namespace million {
+
+// 编译期开关，关闭后埋点代码会被if constexpr整体移除
+#ifdef MILLION_METRICS_ENABLED
+constexpr bool kMetricsEnabled = true;
+#else
+constexpr bool kMetricsEnabled = false;
+#endif
+
+// 指标使用的单调时钟(纳秒)
+inline uint64_t MetricsNowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+using MetricId = uint32_t;
+constexpr MetricId kMetricIdInvalid = 0xffffffff;
+
+enum class MetricType {
+    kCounter,
+    kGauge,
+    kHistogram,
+};
+
+using MetricLabels = std::vector<std::pair<std::string, std::string>>;
+
+// HDR风格的直方图：按2的幂分组，每组再线性划分为kSubBucketCount个子桶，相对误差不超过1/kSubBucketCount
+struct HistogramBuckets {
+    static constexpr size_t kSubBucketBit = 4;
+    static constexpr size_t kSubBucketCount = 1 << kSubBucketBit;
+    static constexpr size_t kGroupCount = 64 - kSubBucketBit + 1;
+    static constexpr size_t kBucketCount = kGroupCount * kSubBucketCount;
+
+    static size_t BucketIndex(uint64_t value) {
+        if (value < kSubBucketCount) {
+            return static_cast<size_t>(value);
+        }
+        size_t bit = 63 - std::countl_zero(value);
+        size_t group = bit - kSubBucketBit + 1;
+        size_t sub = static_cast<size_t>(value >> (bit - kSubBucketBit)) & (kSubBucketCount - 1);
+        return group * kSubBucketCount + sub;
+    }
+
+    // 桶内可以落入的最大值
+    static uint64_t BucketUpperBound(size_t index) {
+        size_t group = index / kSubBucketCount;
+        uint64_t sub = index % kSubBucketCount;
+        if (group == 0) {
+            return sub;
+        }
+        size_t shift = group - 1;
+        uint64_t lower = (kSubBucketCount + sub) << shift;
+        return lower + ((uint64_t(1) << shift) - 1);
+    }
+
+    // 导出为Prometheus格式时使用固定的桶边界2^(i+1)-1，与上面的分组边界对齐，累计数量是精确的
+    static constexpr size_t kExportBucketCount = 63;
+
+    static uint64_t ExportUpperBound(size_t index) {
+        return (uint64_t(2) << index) - 1;
+    }
+};
+
+struct HistogramSnapshot {
+    uint64_t count = 0;
+    uint64_t sum = 0;
+    uint64_t max = 0;
+    // (桶上界, 落入该桶的数量)，只包含非空桶，按上界升序
+    std::vector<std::pair<uint64_t, uint64_t>> buckets;
+
+    uint64_t Percentile(double p) const {
+        if (count == 0) {
+            return 0;
+        }
+        auto target = static_cast<uint64_t>(p * count);
+        if (target >= count) target = count - 1;
+        uint64_t seen = 0;
+        for (auto& [upper, n] : buckets) {
+            seen += n;
+            if (seen > target) {
+                return upper < max ? upper : max;
+            }
+        }
+        return max;
+    }
+};
+
+struct MetricSample {
+    std::string name;
+    std::string help;
+    MetricType type = MetricType::kCounter;
+    MetricLabels labels;
+    double value = 0;                   // 计数器及仪表盘的值
+    HistogramSnapshot histogram;        // 仅直方图有效
+};
+
+struct MetricsSnapshot {
+    std::vector<MetricSample> samples;
+
+    const MetricSample* Find(std::string_view name) const {
+        for (auto& sample : samples) {
+            if (sample.name == name) {
+                return &sample;
+            }
+        }
+        return nullptr;
+    }
+};
+
+// 指标注册表
+// 计数器与直方图写入当前线程独占的分片，无需加锁，读取时合并所有分片
+// 仪表盘及按服务划分的指标，通过采集回调在读取时生成
+class MILLION_API MetricsRegistry : noncopyable {
+public:
+    static constexpr size_t kMaxCounters = 128;
+    static constexpr size_t kMaxHistograms = 32;
+
+    using Collector = std::function<void(MetricsSnapshot*)>;
+
+    MetricsRegistry();
+    ~MetricsRegistry();
+
+    // 注册失败(超出上限)返回kMetricIdInvalid，重复注册同名指标返回已有id
+    MetricId RegisterCounter(std::string_view name, std::string_view help);
+    MetricId RegisterHistogram(std::string_view name, std::string_view help);
+    // 由其他模块自行累计的计数器，读取时通过回调取值
+    void RegisterCounter(std::string_view name, std::string_view help, std::function<double()> getter);
+    void RegisterGauge(std::string_view name, std::string_view help, std::function<double()> getter);
+    void AddCollector(Collector collector);
+
+    void Add(MetricId id, uint64_t value = 1) {
+        if constexpr (!kMetricsEnabled) return;
+        if (id >= kMaxCounters) return;
+        auto& counter = LocalShard().counters[id];
+        // 仅当前线程写入，不需要原子的读-改-写
+        counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+    }
+
+    void Record(MetricId id, uint64_t value) {
+        if constexpr (!kMetricsEnabled) return;
+        if (id >= kMaxHistograms) return;
+        LocalShard().Histogram(id).Record(value);
+    }
+
+    MetricsSnapshot Snapshot();
+
+private:
+    struct HistogramData {
+        std::array<std::atomic<uint64_t>, HistogramBuckets::kBucketCount> buckets{};
+        std::atomic<uint64_t> count = 0;
+        std::atomic<uint64_t> sum = 0;
+        std::atomic<uint64_t> max = 0;
+
+        void Record(uint64_t value) {
+            auto& bucket = buckets[HistogramBuckets::BucketIndex(value)];
+            bucket.store(bucket.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            count.store(count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            sum.store(sum.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+            if (value > max.load(std::memory_order_relaxed)) {
+                max.store(value, std::memory_order_relaxed);
+            }
+        }
+    };
+
+    struct Shard {
+        std::array<std::atomic<uint64_t>, kMaxCounters> counters{};
+        // 直方图较大，首次写入时才分配
+        std::array<std::atomic<HistogramData*>, kMaxHistograms> histograms{};
+
+        ~Shard();
+        HistogramData& Histogram(MetricId id);
+    };
+
+    struct State;
+    friend struct MetricsThreadLocal;
+
+    Shard& LocalShard();
+
+private:
+    // 线程退出时需要把分片合并回注册表，注册表可能已先于线程销毁，因此状态单独共享
+    std::shared_ptr<State> state_;
+};
+
+// 按Prometheus文本格式(0.0.4)输出快照，同名指标合并为一组
+MILLION_API std::string RenderPrometheusText(const MetricsSnapshot& snapshot);
+
+MILLION_MESSAGE_DEFINE_EMPTY(MILLION_API, MetricsSnapshotReq);
+MILLION_MESSAGE_DEFINE(MILLION_API, MetricsSnapshotResp, (MetricsSnapshot) snapshot);
+
+} // namespace million
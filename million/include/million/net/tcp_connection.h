@@ -10,6 +10,7 @@
 #endif
 
 #include <million/api.h>
+#include <million/profiled_mutex.h>
 #include <million/net/packet.h>
 #include <million/net/tcp_connection_handle.h>
 
@@ -26,6 +27,9 @@ public:
     void Process(bool call_on_connection);
     void Send(Packet&& packet);
     void Send(Packet&& packet, PacketSpan span, uint32_t total_size);
+    // 取出大小为size的缓冲区，优先复用该连接已发送完成的缓冲区，内容需由调用方完整写入
+    // 可将长度前缀一并写入后以total_size为0发送，整条消息只需一次写入
+    Packet AcquirePacket(size_t size);
     bool Connected() const;
 
     auto iter() const { return iter_; }
@@ -45,7 +49,7 @@ public:
     asio::ip::tcp::endpoint remote_endpoint_;
     asio::any_io_executor executor_;
 
-    std::mutex send_queue_mutex_;
+    ProfiledMutex send_queue_mutex_{ "tcp_connection.send_queue" };
     struct SendPacket {
         Packet packet;
         PacketSpan span;
@@ -53,6 +57,8 @@ public:
     };
     bool sending_ = false;
     std::queue<SendPacket> send_queue_;
+    // 发送完成后回收的缓冲区，与send_queue_共用锁
+    std::vector<Packet> packet_pool_;
 };
 
 } // namespace net
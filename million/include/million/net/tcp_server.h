@@ -6,6 +6,7 @@
 #include <optional>
 
 #include <million/imillion.h>
+#include <million/profiled_mutex.h>
 #include <million/net/packet.h>
 #include <million/net/tcp_connection.h>
 
@@ -43,7 +44,7 @@ private:
 private:
     IMillion* imillion_;
 
-    std::mutex connections_mutex_;
+    ProfiledMutex connections_mutex_{ "tcp_server.connections" };
     std::list<TcpConnectionShared> connections_;
 
     TcpConnectionFunc on_connection_;
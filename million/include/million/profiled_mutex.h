@@ -0,0 +1,123 @@
+#pragma once
+
+#include <cstdint>
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <million/api.h>
+#include <million/noncopyable.h>
+
+namespace million {
+
+#ifdef MILLION_LOCK_PROFILE_ENABLED
+constexpr bool kLockProfileEnabled = true;
+#else
+constexpr bool kLockProfileEnabled = false;
+#endif
+
+struct LockSiteStats {
+    std::string name;
+    uint64_t acquisitions = 0;      // 加锁次数
+    uint64_t contentions = 0;       // 加锁时锁已被占用的次数
+    uint64_t wait_ns = 0;           // 竞争时等待的总时间
+    uint64_t max_wait_ns = 0;
+};
+
+// 加锁位置的统计，同名的锁(如每个服务各自的邮箱锁)共用同一份统计
+class MILLION_API LockSite : noncopyable {
+public:
+    explicit LockSite(std::string name)
+        : name_(std::move(name)) {}
+
+    // 获取或注册指定名称的统计，返回的指针在进程生命周期内有效
+    static LockSite* Get(std::string_view name);
+
+    void RecordAcquire() {
+        acquisitions_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void RecordContention(uint64_t wait_ns) {
+        acquisitions_.fetch_add(1, std::memory_order_relaxed);
+        contentions_.fetch_add(1, std::memory_order_relaxed);
+        wait_ns_.fetch_add(wait_ns, std::memory_order_relaxed);
+        auto max = max_wait_ns_.load(std::memory_order_relaxed);
+        while (wait_ns > max && !max_wait_ns_.compare_exchange_weak(max, wait_ns, std::memory_order_relaxed)) {}
+    }
+
+    LockSiteStats stats() const;
+    void Reset();
+
+private:
+    std::string name_;
+    std::atomic<uint64_t> acquisitions_ = 0;
+    std::atomic<uint64_t> contentions_ = 0;
+    std::atomic<uint64_t> wait_ns_ = 0;
+    std::atomic<uint64_t> max_wait_ns_ = 0;
+};
+
+// 所有加锁位置的统计，按等待总时间降序
+MILLION_API std::vector<LockSiteStats> GetLockProfile();
+MILLION_API void ResetLockProfile();
+// 格式化为便于输出到日志的表格
+MILLION_API std::string FormatLockProfile(const std::vector<LockSiteStats>& profile);
+
+#ifdef MILLION_LOCK_PROFILE_ENABLED
+
+// 带竞争统计的互斥锁，先尝试加锁，失败时计为一次竞争并记录等待时间
+class ProfiledMutex : noncopyable {
+public:
+    explicit ProfiledMutex(std::string_view site)
+        : site_(LockSite::Get(site)) {}
+
+    void lock() {
+        if (mutex_.try_lock()) {
+            site_->RecordAcquire();
+            return;
+        }
+        auto begin = std::chrono::steady_clock::now();
+        mutex_.lock();
+        auto wait = std::chrono::steady_clock::now() - begin;
+        site_->RecordContention(std::chrono::duration_cast<std::chrono::nanoseconds>(wait).count());
+    }
+
+    bool try_lock() {
+        if (!mutex_.try_lock()) {
+            return false;
+        }
+        site_->RecordAcquire();
+        return true;
+    }
+
+    void unlock() { mutex_.unlock(); }
+
+    // 需要配合std::condition_variable等待时使用
+    std::unique_lock<std::mutex> unique_lock() {
+        lock();
+        return std::unique_lock<std::mutex>(mutex_, std::adopt_lock);
+    }
+
+private:
+    std::mutex mutex_;
+    LockSite* site_;
+};
+
+#else
+
+// 未开启MILLION_LOCK_PROFILE时即为std::mutex
+class ProfiledMutex : public std::mutex {
+public:
+    explicit ProfiledMutex([[maybe_unused]] std::string_view site) {}
+
+    std::unique_lock<std::mutex> unique_lock() {
+        return std::unique_lock<std::mutex>(*this);
+    }
+};
+
+#endif
+
+} // namespace million
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstdint>
+
+#include <memory>
+
+#include <google/protobuf/arena.h>
+
+#include <million/api.h>
+#include <million/proto_message.h>
+
+namespace million {
+
+struct ProtoArenaOptions {
+    size_t block_size = 8 * 1024;       // 每个Arena预先分配的初始块，超出时由Arena自行扩展
+    size_t pool_size = 16;              // 每个线程缓存的Arena数
+};
+
+// 解码用的Arena缓存池，每个线程一个
+// Arena在最后一个引用释放时Reset(保留初始块)，并归还到执行释放的线程的缓存池
+class MILLION_API ProtoArenaPool {
+public:
+    // 需在工作线程开始解码前设置
+    static void SetOptions(const ProtoArenaOptions& options);
+
+    static std::shared_ptr<protobuf::Arena> Acquire();
+
+    // 在Arena上创建消息，返回的指针同时持有该Arena
+    static ProtoMessageArena NewMessage(const ProtoMessage& prototype);
+
+    // 新建的Arena数，与解码次数的差即为复用次数
+    static uint64_t created();
+};
+
+} // namespace million
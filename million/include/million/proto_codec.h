@@ -1,5 +1,8 @@
 #pragma once
 
+#include <span>
+#include <string_view>
+
 #include <million/noncopyable.h>
 #include <million/exception.h>
 #include <million/message.h>
@@ -11,6 +14,8 @@ namespace million {
 using ProtoMessageKey = ModuleCode;
 using ProtoMessageId = ModuleSubCode;
 constexpr ProtoMessageId kProtoMessageIdInvalid = kModuleSubCodeInvalid;
+// (文件内的消息下标, 消息id)，与proto/CMakeLists.txt生成的<name>.ids.h一致
+using ProtoMessageIdEntry = std::pair<int32_t, uint32_t>;
 
 class ProtoMgr;
 class MILLION_API ProtoCodec : noncopyable {
@@ -21,22 +26,40 @@ public:
     // 注册协议
     template <typename ModuleExtIdT, typename MessageExtIdT>
     bool RegisterFile(const std::string& proto_file_name, ModuleExtIdT module_ext_id, MessageExtIdT msg_ext_id);
+    // 注册构建时生成的id表，如RegisterIdTable<test::ss::ss_test_ids>()，不再通过选项扩展反射遍历文件
+    // 只构建该文件的描述符
+    template <typename IdTableT>
+    bool RegisterIdTable() {
+        return RegisterIdTable(IdTableT::kProtoFile, IdTableT::kModuleId, IdTableT::kMessageIds);
+    }
+    bool RegisterIdTable(std::string_view proto_file_name, uint32_t module_id, std::span<const ProtoMessageIdEntry> msg_ids);
 
     std::optional<std::pair<ModuleId, ProtoMessageId>> FindMessageId(const protobuf::Message& message) const;
 
     std::optional<net::Packet> EncodeMessage(const protobuf::Message& message) const;
+    // 将消息键及消息体直接序列化到buffer，buffer需至少有EncodedSize(byte_size)字节
+    // byte_size需由调用方通过message.ByteSizeLong()计算，计算时缓存的各字段大小供序列化复用
+    bool EncodeMessageTo(const protobuf::Message& message, size_t byte_size, uint8_t* buffer) const;
+    static constexpr size_t EncodedSize(size_t byte_size) {
+        return sizeof(ProtoMessageKey) + byte_size;
+    }
+
     struct DecodeRes {
         ModuleId module_id;
         ProtoMessageId msg_id;
-        ProtoMessageUnique msg;
+        MessagePointer msg;
     };
+    // 开启arena_decode时消息在ProtoArenaPool的Arena上解码
     std::optional<DecodeRes> DecodeMessage(net::PacketSpan packet) const;
 
+    bool arena_decode() const { return arena_decode_; }
+    void set_arena_decode(bool arena_decode) { arena_decode_ = arena_decode; }
+
 private:
     const protobuf::Descriptor* FindMessageDesc(ModuleId module_id, ProtoMessageId msg_id) const;
     std::optional<ProtoMessageKey> FindMessageKey(const protobuf::Descriptor* desc) const;
-
-    std::optional<ProtoMessageUnique> NewMessage(ModuleId module_id, ProtoMessageId msg_id) const;
+    // 已注册的消息保留先注册的
+    void AddMessage(ModuleId module_id, ProtoMessageId msg_id, const protobuf::Descriptor* desc);
 
     uint32_t host_to_network_u32(uint32_t value) const;
     uint32_t network_to_host_u32(uint32_t value) const;
@@ -44,13 +67,16 @@ private:
 private:
     const ProtoMgr& proto_mgr_;
 
-    std::unordered_map<ProtoMessageKey, const protobuf::Descriptor*> msg_desc_map_;
-    std::unordered_map<const protobuf::Descriptor*, ProtoMessageKey> msg_id_map_;
+    // 模块id及消息id均为较小的连续整数，按[module_id][msg_id]直接索引
+    std::vector<std::vector<const protobuf::Descriptor*>> msg_desc_table_;
+    // 按Descriptor地址排序，二分查找
+    std::vector<std::pair<const protobuf::Descriptor*, ProtoMessageKey>> msg_key_table_;
+    bool arena_decode_ = false;
 };
 
 inline net::Packet ProtoMsgToPacket(const google::protobuf::Message& msg) {
-    auto packet = net::Packet(msg.ByteSize());
-    if (!msg.SerializeToArray(packet.data(), packet.size())) {
+    auto packet = net::Packet(msg.ByteSizeLong());
+    if (!msg.SerializeToArray(packet.data(), static_cast<int>(packet.size()))) {
         TaskAbort("Failed to serialize protobuf message to packet.");
     }
     return packet;
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <memory>
 #include <vector>
 #include <string>
 #include <optional>
@@ -10,15 +11,51 @@
 #include <google/protobuf/descriptor.h>
 #include <google/protobuf/compiler/importer.h>
 
+#include <million/api.h>
+
 namespace million {
 
 namespace protobuf = google::protobuf;
 
 using ProtoMessage = protobuf::Message;
-using ProtoMessageUnique = std::unique_ptr<ProtoMessage>;
+// 开启ProtoMgr的消息复用时，析构改为Clear后放回当前线程的空闲链表
+struct MILLION_API ProtoMessageDeleter {
+    ProtoMessageDeleter() noexcept = default;
+    template <typename T>
+    ProtoMessageDeleter(const std::default_delete<T>&) noexcept {}
+
+    void operator()(ProtoMessage* msg) const;
+};
+
+using ProtoMessageUnique = std::unique_ptr<ProtoMessage, ProtoMessageDeleter>;
 using ProtoMessageShared = std::shared_ptr<const ProtoMessage>;
 using ProtoMessageWeak = std::weak_ptr<const ProtoMessage>;
 
+class ProtoArenaPool;
+// 在Arena上创建的消息，引用计数同时持有Arena
+// 单独的类型且只能由ProtoArenaPool创建，避免普通的shared_ptr被当作Arena上的消息
+class ProtoMessageArena {
+public:
+    ProtoMessageArena() = default;
+    ProtoMessageArena(std::nullptr_t) {}
+
+    ProtoMessage* get() const { return msg_.get(); }
+    ProtoMessage* operator->() const { return msg_.get(); }
+    ProtoMessage& operator*() const { return *msg_; }
+    explicit operator bool() const { return msg_ != nullptr; }
+
+private:
+    friend class ProtoArenaPool;
+    explicit ProtoMessageArena(std::shared_ptr<ProtoMessage> msg)
+        : msg_(std::move(msg)) {}
+
+private:
+    std::shared_ptr<ProtoMessage> msg_;
+};
+
+// 创建与prototype同类型的消息，开启复用时优先取出空闲链表中的对象
+MILLION_API ProtoMessageUnique NewProtoMessage(const ProtoMessage& prototype);
+
 inline const google::protobuf::FieldDescriptor& GetFieldDescriptor(const google::protobuf::Descriptor& descriptor, int index) {
     const auto* field_desc = descriptor.field(index);
     if (!field_desc) {
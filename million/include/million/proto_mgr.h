@@ -5,6 +5,10 @@
 
 namespace million {
 
+struct ProtoMessagePoolOptions {
+    size_t max_per_type = 16;           // 每个线程每种消息缓存的对象数
+};
+
 class MILLION_API ProtoMgr {
 public:
     ProtoMgr();
@@ -20,12 +24,17 @@ public:
 
     ProtoMessageUnique NewMessage(const google::protobuf::Descriptor& desc) const;
 
+    // 开启消息复用，释放的ProtoMessageUnique按Descriptor放入当前线程的空闲链表，Clear后保留字符串及repeated字段的容量
+    // 需在工作线程开始创建消息前调用
+    static void EnableMessagePool(const ProtoMessagePoolOptions& options);
+    // 从空闲链表中取出的次数
+    static uint64_t message_pool_reused();
+
     const ProtoCodec& codec() const { return codec_; }
     ProtoCodec& codec() { return codec_; }
 
 private:
     static const google::protobuf::DescriptorPool& desc_pool();
-    static google::protobuf::DescriptorDatabase& desc_db();
     static google::protobuf::MessageFactory& msg_factory();
 
 private:
@@ -78,9 +87,7 @@ bool ProtoCodec::RegisterFile(const std::string& proto_file_name, ModuleExtIdT m
             return false;
         }
 
-        auto key = EncodeModuleCode(module_id_ui, msg_id_ui);
-        msg_desc_map_.emplace(key, desc);
-        msg_id_map_.emplace(desc, key);
+        AddMessage(module_id_ui, msg_id_ui, desc);
     }
 
     return true;
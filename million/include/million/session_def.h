@@ -2,6 +2,8 @@
 
 #include <cstdint>
 
+#include <chrono>
+
 #include <million/seata_snowflake.hpp>
 
 namespace million {
@@ -11,6 +13,26 @@ constexpr SessionId kSessionIdInvalid = kSnowIdInvalid;
 
 constexpr uint32_t kSessionNeverTimeout = 0xffffffff;
 
+// 会话截止时间，steady_clock下的毫秒时间戳
+using SessionDeadline = uint64_t;
+constexpr SessionDeadline kSessionDeadlineNone = 0;
+
+inline SessionDeadline SessionNowMs() {
+	return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// 0(默认超时时间)及kSessionNeverTimeout不设截止时间
+inline SessionDeadline SessionDeadlineAfter(uint32_t timeout_s) {
+	if (timeout_s == 0 || timeout_s == kSessionNeverTimeout) {
+		return kSessionDeadlineNone;
+	}
+	return SessionNowMs() + static_cast<SessionDeadline>(timeout_s) * 1000;
+}
+
+inline bool SessionDeadlineExpired(SessionDeadline deadline) {
+	return deadline != kSessionDeadlineNone && SessionNowMs() >= deadline;
+}
+
 inline SessionId SessionSendToReplyId(SessionId session_id) {
 	return session_id | 0x8000000000000000;
 }
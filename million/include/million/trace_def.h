@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstdint>
+
+namespace million {
+
+using TraceId = uint64_t;
+constexpr TraceId kTraceIdInvalid = 0;
+
+using SpanId = uint64_t;
+constexpr SpanId kSpanIdInvalid = 0;
+
+// 追踪上下文，随消息在服务间及节点间传递
+// 服务处理一条请求即为一个span，span id为该请求的会话id，发出的消息以当前span作为父span
+struct TraceContext {
+    TraceId trace_id = kTraceIdInvalid;         // 链路id，由链路中第一条请求的会话id生成
+    SpanId span_id = kSpanIdInvalid;            // 当前span，消息中为发送方的span
+    SpanId parent_span_id = kSpanIdInvalid;
+    bool sampled = false;
+
+    bool valid() const { return trace_id != kTraceIdInvalid; }
+
+    // 以当前上下文为父span，生成子span的上下文
+    TraceContext ChildOf(SpanId child_span_id) const {
+        return TraceContext{ trace_id, child_span_id, span_id, sampled };
+    }
+};
+
+} // namespace million
@@ -0,0 +1,73 @@
+#include <million/cpp_message_codec.h>
+
+#include <mutex>
+
+namespace million {
+
+bool CppMessageCodec::Register(CppMessageTypeId type_id, const std::type_info& type, EncodeFunction encode, DecodeFunction decode) {
+    auto lock = std::unique_lock(mutex_);
+    auto iter = decoders_.find(type_id);
+    if (iter != decoders_.end()) {
+        return iter->second.type == std::type_index(type);
+    }
+    if (encoders_.contains(std::type_index(type))) {
+        // 同一类型以不同的名称注册
+        return false;
+    }
+    encoders_.emplace(std::type_index(type), Encoder{ type_id, encode });
+    decoders_.emplace(type_id, Decoder{ std::type_index(type), decode });
+    return true;
+}
+
+std::optional<CppMessageTypeId> CppMessageCodec::FindTypeId(const std::type_info& type) const {
+    auto lock = std::shared_lock(mutex_);
+    auto iter = encoders_.find(std::type_index(type));
+    if (iter == encoders_.end()) {
+        return std::nullopt;
+    }
+    return iter->second.type_id;
+}
+
+std::optional<net::Packet> CppMessageCodec::EncodeMessage(const CppMessage& msg) const {
+    Encoder encoder;
+    {
+        auto lock = std::shared_lock(mutex_);
+        auto iter = encoders_.find(std::type_index(msg.type()));
+        if (iter == encoders_.end()) {
+            return std::nullopt;
+        }
+        encoder = iter->second;
+    }
+
+    auto packet = net::Packet();
+    auto writer = CppMessageWriter(packet);
+    writer.WritePod(encoder.type_id);
+    encoder.encode(writer, msg);
+    return packet;
+}
+
+CppMessageUnique CppMessageCodec::DecodeMessage(net::PacketSpan packet) const {
+    auto reader = CppMessageReader(packet);
+    CppMessageTypeId type_id;
+    if (!reader.ReadPod(&type_id)) {
+        return nullptr;
+    }
+
+    DecodeFunction decode;
+    {
+        auto lock = std::shared_lock(mutex_);
+        auto iter = decoders_.find(type_id);
+        if (iter == decoders_.end()) {
+            return nullptr;
+        }
+        decode = iter->second.decode;
+    }
+
+    auto msg = decode(reader);
+    if (!msg || !reader.ok() || reader.remaining() != 0) {
+        return nullptr;
+    }
+    return msg;
+}
+
+} // namespace million
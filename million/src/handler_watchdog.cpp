@@ -0,0 +1,259 @@
+#include "handler_watchdog.h"
+
+#include <chrono>
+#include <format>
+
+#include <million/exception.h>
+#include <million/metrics.h>
+
+#include "million.h"
+#include "worker.h"
+#include "worker_mgr.h"
+
+#ifdef MILLION_STACK_TRACE
+#if defined(_WIN32)
+#include <windows.h>
+#include <dbghelp.h>
+#pragma comment(lib, "dbghelp.lib")
+#elif defined(__linux__)
+#include <csignal>
+#include <cstdlib>
+#include <pthread.h>
+#include <execinfo.h>
+#endif
+#endif
+
+namespace million {
+
+#ifdef MILLION_STACK_TRACE
+#if defined(_WIN32) && defined(_M_X64)
+
+// 挂起目标线程后回溯其调用栈，挂起期间不分配内存，避免目标线程持有堆锁时死锁
+static std::string CaptureThreadStack(std::thread::native_handle_type thread) {
+    static std::once_flag sym_init_flag;
+    std::call_once(sym_init_flag, [] {
+        SymSetOptions(SYMOPT_UNDNAME | SYMOPT_DEFERRED_LOADS);
+        SymInitialize(GetCurrentProcess(), nullptr, TRUE);
+    });
+
+    constexpr size_t kMaxFrames = 64;
+    DWORD64 frames[kMaxFrames];
+    size_t frame_count = 0;
+
+    auto handle = static_cast<HANDLE>(thread);
+    if (SuspendThread(handle) == static_cast<DWORD>(-1)) {
+        return {};
+    }
+    CONTEXT context{};
+    context.ContextFlags = CONTEXT_FULL;
+    if (GetThreadContext(handle, &context)) {
+        STACKFRAME64 frame{};
+        frame.AddrPC.Offset = context.Rip;
+        frame.AddrPC.Mode = AddrModeFlat;
+        frame.AddrFrame.Offset = context.Rbp;
+        frame.AddrFrame.Mode = AddrModeFlat;
+        frame.AddrStack.Offset = context.Rsp;
+        frame.AddrStack.Mode = AddrModeFlat;
+        while (frame_count < kMaxFrames
+            && StackWalk64(IMAGE_FILE_MACHINE_AMD64, GetCurrentProcess(), handle, &frame, &context,
+                nullptr, SymFunctionTableAccess64, SymGetModuleBase64, nullptr)) {
+            if (frame.AddrPC.Offset == 0) {
+                break;
+            }
+            frames[frame_count++] = frame.AddrPC.Offset;
+        }
+    }
+    ResumeThread(handle);
+
+    std::string stack;
+    alignas(SYMBOL_INFO) char buffer[sizeof(SYMBOL_INFO) + MAX_SYM_NAME];
+    auto symbol = reinterpret_cast<SYMBOL_INFO*>(buffer);
+    for (size_t i = 0; i < frame_count; ++i) {
+        symbol->SizeOfStruct = sizeof(SYMBOL_INFO);
+        symbol->MaxNameLen = MAX_SYM_NAME;
+        DWORD64 displacement = 0;
+        if (SymFromAddr(GetCurrentProcess(), frames[i], &displacement, symbol)) {
+            stack += std::format("#{} {}+0x{:x}\n", i, symbol->Name, displacement);
+        }
+        else {
+            stack += std::format("#{} 0x{:x}\n", i, frames[i]);
+        }
+    }
+    return stack;
+}
+
+#elif defined(__linux__)
+
+// 通过信号让目标线程在信号处理函数中回溯自身的调用栈
+// 处理函数中只调用backtrace，其首次调用可能分配内存，因此在安装时预先调用一次
+// 信号可能打断目标线程中阻塞的系统调用，仅建议在排查问题时开启
+static constexpr size_t kMaxStackFrames = 64;
+static std::mutex stack_capture_mutex;
+static void* stack_capture_frames[kMaxStackFrames];
+static std::atomic<int> stack_capture_size = -1;
+
+static void StackCaptureSignalHandler(int) {
+    auto size = backtrace(stack_capture_frames, kMaxStackFrames);
+    stack_capture_size.store(size, std::memory_order_release);
+}
+
+static std::string CaptureThreadStack(std::thread::native_handle_type thread) {
+    static const int signal_number = [] {
+        void* frame;
+        backtrace(&frame, 1);
+        struct sigaction action {};
+        action.sa_handler = StackCaptureSignalHandler;
+        action.sa_flags = SA_RESTART;
+        sigemptyset(&action.sa_mask);
+        sigaction(SIGRTMIN + 1, &action, nullptr);
+        return SIGRTMIN + 1;
+    }();
+
+    auto lock = std::lock_guard(stack_capture_mutex);
+    stack_capture_size.store(-1, std::memory_order_relaxed);
+    if (pthread_kill(thread, signal_number) != 0) {
+        return {};
+    }
+    // 目标线程可能处于不可中断的阻塞中，最多等待100ms
+    int size = -1;
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(100);
+    while ((size = stack_capture_size.load(std::memory_order_acquire)) < 0) {
+        if (std::chrono::steady_clock::now() >= deadline) {
+            return {};
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    std::string stack;
+    auto symbols = backtrace_symbols(stack_capture_frames, size);
+    // 跳过信号处理函数及信号跳板
+    for (int i = 2; i < size; ++i) {
+        stack += std::format("#{} {}\n", i - 2, symbols ? symbols[i] : "?");
+    }
+    std::free(symbols);
+    return stack;
+}
+
+#else
+
+static std::string CaptureThreadStack(std::thread::native_handle_type thread) {
+    return {};
+}
+
+#endif
+#endif
+
+HandlerWatchdog::HandlerWatchdog(Million* million, const HandlerWatchdogConfig& config)
+    : million_(million)
+    , config_(config)
+    , budget_ns_(static_cast<uint64_t>(config.budget_ms) * 1000000) {}
+
+HandlerWatchdog::~HandlerWatchdog() = default;
+
+void HandlerWatchdog::Start() {
+    reported_seq_.assign(million_->worker_mgr().worker_num(), 0);
+    thread_.emplace([this](std::stop_token st) {
+        auto interval = std::chrono::milliseconds(config_.check_interval_ms);
+        while (!st.stop_requested()) {
+            std::this_thread::sleep_for(interval);
+            if (st.stop_requested()) {
+                break;
+            }
+            Check();
+        }
+    });
+}
+
+void HandlerWatchdog::Stop() {
+    thread_.reset();
+}
+
+void HandlerWatchdog::Check() {
+    auto& worker_mgr = million_->worker_mgr();
+    for (size_t i = 0; i < worker_mgr.worker_num(); ++i) {
+        auto& slot = worker_mgr.worker(i).watch_slot();
+        auto begin_ns = slot.begin_ns.load(std::memory_order_acquire);
+        if (begin_ns == 0) {
+            continue;
+        }
+        auto seq = slot.seq.load(std::memory_order_relaxed);
+        if (seq == reported_seq_[i]) {
+            continue;
+        }
+        auto now_ns = MetricsNowNs();
+        if (now_ns < begin_ns || now_ns - begin_ns < budget_ns_) {
+            continue;
+        }
+        auto service_id = slot.service_id.load(std::memory_order_relaxed);
+        auto service_type = slot.service_type.load(std::memory_order_relaxed);
+        auto msg_type_key = slot.msg_type_key.load(std::memory_order_relaxed);
+        auto msg_is_proto = slot.msg_is_proto.load(std::memory_order_relaxed);
+        auto session_id = slot.session_id.load(std::memory_order_relaxed);
+        // 读取期间已进入下一次处理，本次读到的信息可能不一致
+        if (slot.seq.load(std::memory_order_acquire) != seq || slot.begin_ns.load(std::memory_order_relaxed) != begin_ns) {
+            continue;
+        }
+        reported_seq_[i] = seq;
+        Report(i, now_ns - begin_ns, service_id, service_type, msg_type_key, msg_is_proto, session_id);
+    }
+}
+
+// 类型键即protobuf消息的描述符或CppMessage的type_info，生命周期与进程一致
+static const char* MessageTypeKeyName(MessageTypeKey key, bool is_proto) {
+    if (key == 0) {
+        return "unknown";
+    }
+    if (is_proto) {
+        return reinterpret_cast<const google::protobuf::Descriptor*>(key)->full_name().c_str();
+    }
+    return reinterpret_cast<const std::type_info*>(key)->name();
+}
+
+void HandlerWatchdog::Report(size_t worker_index, uint64_t elapsed_ns, ServiceId service_id, const std::type_info* service_type, MessageTypeKey msg_type_key, bool msg_is_proto, SessionId session_id) {
+    auto service_type_name = service_type ? service_type->name() : "unknown";
+    auto msg_type_name = MessageTypeKeyName(msg_type_key, msg_is_proto);
+    slow_count_.fetch_add(1, std::memory_order_relaxed);
+    uint64_t count = 0;
+    {
+        auto lock = std::lock_guard(offenders_mutex_);
+        count = ++offenders_[{ service_type_name, msg_type_name }];
+    }
+
+    std::string stack;
+#ifdef MILLION_STACK_TRACE
+    if (config_.capture_stack) {
+        auto& worker = million_->worker_mgr().worker(worker_index);
+        stack = CaptureThreadStack(worker.native_handle());
+        // 抓取期间处理已结束，调用栈不再属于该处理函数
+        if (worker.watch_slot().seq.load(std::memory_order_acquire) != reported_seq_[worker_index]
+            || worker.watch_slot().begin_ns.load(std::memory_order_relaxed) == 0) {
+            stack.clear();
+        }
+    }
+#endif
+
+    auto& logger = million_->logger();
+    if (stack.empty()) {
+        logger.LOG_WARN("slow handler: worker {} has been processing for {}ms (budget {}ms), service: {} ({}), msg: {}, session: {}, times: {}.",
+            worker_index, elapsed_ns / 1000000, config_.budget_ms, service_type_name, service_id, msg_type_name, session_id, count);
+    }
+    else {
+        logger.LOG_WARN("slow handler: worker {} has been processing for {}ms (budget {}ms), service: {} ({}), msg: {}, session: {}, times: {}.\n[Stack trace]\n{}",
+            worker_index, elapsed_ns / 1000000, config_.budget_ms, service_type_name, service_id, msg_type_name, session_id, count, stack);
+    }
+}
+
+void HandlerWatchdog::CollectMetrics(MetricsSnapshot* snapshot) {
+    auto lock = std::lock_guard(offenders_mutex_);
+    for (auto& [key, count] : offenders_) {
+        MetricSample sample;
+        sample.name = "million_slow_handlers_total";
+        sample.help = "Handlers that exceeded the watchdog budget, by service type and message type.";
+        sample.type = MetricType::kCounter;
+        sample.labels = { { "service_type", key.first }, { "msg_type", key.second } };
+        sample.value = static_cast<double>(count);
+        snapshot->samples.emplace_back(std::move(sample));
+    }
+}
+
+} // namespace million
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <cstdint>
+
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <typeinfo>
+#include <utility>
+#include <vector>
+
+#include <million/noncopyable.h>
+#include <million/session_def.h>
+#include <million/service_handle.h>
+#include <million/message.h>
+
+namespace million {
+
+struct HandlerWatchdogConfig {
+    uint32_t budget_ms = 100;           // 单次处理消息允许的最长耗时
+    uint32_t check_interval_ms = 20;    // 检查周期
+    bool capture_stack = true;          // 超时时抓取worker线程的调用栈，需以MILLION_STACK_TRACE编译
+};
+
+// worker当前正在执行的处理函数，由worker线程写入，看门狗线程读取
+struct HandlerWatchSlot {
+    std::atomic<uint64_t> seq = 0;                  // 每次进入处理函数时递增，用于判断读取期间是否已切换
+    std::atomic<uint64_t> begin_ns = 0;             // 0表示当前未在处理
+    std::atomic<ServiceId> service_id = 0;
+    // 只记录类型，名称在报告时才解析，避免每条消息都查询类型名
+    std::atomic<const std::type_info*> service_type = nullptr;
+    std::atomic<MessageTypeKey> msg_type_key = 0;
+    std::atomic<bool> msg_is_proto = false;
+    std::atomic<SessionId> session_id = 0;
+
+    // 直接调用会在处理函数中嵌套处理其他服务的消息，耗时计入最外层
+    bool Enter(ServiceId service, const std::type_info* service_type_info, const MessagePointer& msg, SessionId session, uint64_t now_ns) {
+        if (begin_ns.load(std::memory_order_relaxed) != 0) {
+            return false;
+        }
+        seq.store(seq.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        service_id.store(service, std::memory_order_relaxed);
+        service_type.store(service_type_info, std::memory_order_relaxed);
+        msg_type_key.store(msg.GetTypeKey(), std::memory_order_relaxed);
+        msg_is_proto.store(msg.IsProtoMessage(), std::memory_order_relaxed);
+        session_id.store(session, std::memory_order_relaxed);
+        begin_ns.store(now_ns, std::memory_order_release);
+        return true;
+    }
+
+    void Exit() {
+        begin_ns.store(0, std::memory_order_release);
+    }
+};
+
+class Million;
+struct MetricsSnapshot;
+// 慢处理函数看门狗
+// 周期性检查各worker当前处理的消息，超过预算时输出服务类型、消息类型、会话id及worker的调用栈
+// 同一次处理只报告一次，按服务类型及消息类型累计次数并导出为指标，用于定位阻塞调用
+class HandlerWatchdog : noncopyable {
+public:
+    HandlerWatchdog(Million* million, const HandlerWatchdogConfig& config);
+    ~HandlerWatchdog();
+
+    void Start();
+    void Stop();
+
+    uint64_t budget_ns() const { return budget_ns_; }
+    uint64_t slow_count() const { return slow_count_.load(std::memory_order_relaxed); }
+    // 导出各(服务类型, 消息类型)的超时次数
+    void CollectMetrics(MetricsSnapshot* snapshot);
+
+private:
+    void Check();
+    void Report(size_t worker_index, uint64_t elapsed_ns, ServiceId service_id, const std::type_info* service_type, MessageTypeKey msg_type_key, bool msg_is_proto, SessionId session_id);
+
+private:
+    Million* million_;
+    HandlerWatchdogConfig config_;
+    uint64_t budget_ns_;
+    std::optional<std::jthread> thread_;
+
+    // 各worker最后一次报告的处理序号
+    std::vector<uint64_t> reported_seq_;
+
+    std::atomic<uint64_t> slow_count_ = 0;
+    std::mutex offenders_mutex_;
+    // (服务类型, 消息类型) -> 超时次数
+    std::map<std::pair<std::string, std::string>, uint64_t> offenders_;
+};
+
+} // namespace million
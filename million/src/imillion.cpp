@@ -1,6 +1,7 @@
 #include <million/imillion.h>
 
 #include "million.h"
+#include "tracer.h"
 
 namespace million {
 
@@ -21,8 +22,8 @@ void IMillion::Start() {
     impl_->Start();
 }
 
-std::optional<ServiceHandle> IMillion::AddService(std::unique_ptr<IService> iservice) {
-    auto shared = impl_->AddService(std::move(iservice));
+std::optional<ServiceHandle> IMillion::AddService(std::unique_ptr<IService> iservice, std::optional<size_t> shard_id) {
+    auto shared = impl_->AddService(std::move(iservice), shard_id);
     if (!shared) {
         return std::nullopt;
     }
@@ -73,7 +74,7 @@ SessionId IMillion::NewSession() {
     return impl_->NewSession();
 }
 
-std::optional<SessionId> IMillion::Send(const ServiceHandle& sender, const ServiceHandle& target, MessagePointer msg) {
+std::optional<SessionId> IMillion::Send(const ServiceHandle& sender, const ServiceHandle& target, MessagePointer msg, SessionDeadline deadline) {
     auto sender_lock = sender.lock();
     if (!sender_lock) {
         logger().LOG_WARN("Send failed: invalid sender.");
@@ -84,10 +85,10 @@ std::optional<SessionId> IMillion::Send(const ServiceHandle& sender, const Servi
         logger().LOG_WARN("Send failed: invalid target.");
         return std::nullopt;
     }
-    return impl_->Send(sender_lock, target_lock, std::move(msg));
+    return impl_->Send(sender_lock, target_lock, std::move(msg), deadline);
 }
 
-bool IMillion::SendTo(const ServiceHandle& sender, const ServiceHandle& target, SessionId session_id, MessagePointer msg) {
+bool IMillion::SendTo(const ServiceHandle& sender, const ServiceHandle& target, SessionId session_id, MessagePointer msg, SessionDeadline deadline) {
     auto sender_lock = sender.lock();
     if (!sender_lock) {
         logger().LOG_WARN("SendTo failed: invalid sender.");
@@ -98,7 +99,33 @@ bool IMillion::SendTo(const ServiceHandle& sender, const ServiceHandle& target,
         logger().LOG_WARN("SendTo failed: invalid target.");
         return false;
     }
-    return impl_->SendTo(sender_lock, target_lock, session_id, std::move(msg));
+    return impl_->SendTo(sender_lock, target_lock, session_id, std::move(msg), deadline);
+}
+
+MailboxPushResult IMillion::TrySendTo(const ServiceHandle& sender, const ServiceHandle& target, SessionId session_id, MessagePointer& msg) {
+    auto sender_lock = sender.lock();
+    if (!sender_lock) {
+        logger().LOG_WARN("TrySendTo failed: invalid sender.");
+        return MailboxPushResult::kClosed;
+    }
+    auto target_lock = target.lock();
+    if (!target_lock) {
+        logger().LOG_WARN("TrySendTo failed: invalid target.");
+        return MailboxPushResult::kClosed;
+    }
+    return impl_->TrySendTo(sender_lock, target_lock, session_id, msg);
+}
+
+bool IMillion::WaitMailboxWritable(const ServiceHandle& waiter, const ServiceHandle& target, SessionId wait_session_id) {
+    auto waiter_lock = waiter.lock();
+    if (!waiter_lock) {
+        return false;
+    }
+    auto target_lock = target.lock();
+    if (!target_lock) {
+        return false;
+    }
+    return impl_->WaitMailboxWritable(waiter_lock, target_lock, wait_session_id);
 }
 
 const YAML::Node& IMillion::YamlSettings() const {
@@ -130,6 +157,10 @@ ProtoMgr& IMillion::proto_mgr() {
     return impl_->proto_mgr();
 }
 
+CppMessageCodec& IMillion::cpp_codec() {
+    return impl_->cpp_codec();
+}
+
 void IMillion::EnableSeparateWorker(const ServiceHandle& handle) {
     auto lock = handle.lock();
     if (!lock) {
@@ -138,4 +169,75 @@ void IMillion::EnableSeparateWorker(const ServiceHandle& handle) {
     impl_->EnableSeparateWorker(lock);
 }
 
+void IMillion::EnableDirectDispatch(const ServiceHandle& handle) {
+    auto lock = handle.lock();
+    if (!lock) {
+        return;
+    }
+    impl_->EnableDirectDispatch(lock);
+}
+
+void IMillion::EnablePriorityLanes(const ServiceHandle& handle, bool enable) {
+    auto lock = handle.lock();
+    if (!lock) {
+        return;
+    }
+    impl_->EnablePriorityLanes(lock, enable);
+}
+
+void IMillion::SetMailboxCapacity(const ServiceHandle& handle, size_t capacity, MailboxFullPolicy policy) {
+    auto lock = handle.lock();
+    if (!lock) {
+        return;
+    }
+    impl_->SetMailboxCapacity(lock, capacity, policy);
+}
+
+std::optional<MailboxStats> IMillion::GetMailboxStats(const ServiceHandle& handle) {
+    auto lock = handle.lock();
+    if (!lock) {
+        return std::nullopt;
+    }
+    return impl_->GetMailboxStats(lock);
+}
+
+MetricsRegistry& IMillion::metrics() {
+    return impl_->metrics();
+}
+
+MetricsSnapshot IMillion::GetMetricsSnapshot() {
+    return impl_->metrics().Snapshot();
+}
+
+const std::optional<ServiceHandle>& IMillion::metrics_service() {
+    return impl_->metrics_service();
+}
+
+bool IMillion::DumpTrace(std::string_view path) {
+    return impl_->tracer().DumpChromeTrace(path, impl_->node_id());
+}
+
+bool IMillion::TraceEnabled() {
+    return impl_->tracer().enabled();
+}
+
+TraceContext IMillion::GetTraceContext() {
+    return Tracer::active_context();
+}
+
+void IMillion::SetTraceContext(const TraceContext& context) {
+    if (!impl_->tracer().enabled()) {
+        return;
+    }
+    Tracer::set_active_context(context);
+}
+
+void IMillion::RecordTraceSpan(const char* name, ServiceId service_id, const TraceContext& context, uint64_t begin_ns, uint64_t end_ns) {
+    auto& tracer = impl_->tracer();
+    if (!tracer.enabled() || !context.sampled) {
+        return;
+    }
+    tracer.RecordSpan(name, service_id, context, begin_ns, end_ns);
+}
+
 } //namespace million
\ No newline at end of file
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+#include <atomic>
+#include <memory>
+
+#include <million/noncopyable.h>
+
+namespace million {
+namespace internal {
+
+// 单生产者单消费者的无锁字节环形缓冲区，存放变长记录
+// 每条记录以4字节的总长度开头，按8字节对齐；尾部空间不足时写入填充记录并回绕到开头
+class SpscByteRing : noncopyable {
+public:
+    static constexpr size_t kAlignment = 8;
+    static constexpr uint32_t kPaddingFlag = 0x80000000;
+
+    // capacity会向上取整为2的幂
+    explicit SpscByteRing(size_t capacity) {
+        size_t size = 64;
+        while (size < capacity) {
+            size <<= 1;
+        }
+        mask_ = size - 1;
+        buffer_ = std::make_unique<uint8_t[]>(size);
+    }
+    ~SpscByteRing() = default;
+
+    size_t capacity() const { return mask_ + 1; }
+
+    // 单条记录的最大长度，避免一条记录占满缓冲区
+    size_t max_record_size() const { return capacity() / 4; }
+
+    // 仅生产者线程调用，预留size字节(含长度头)的连续空间，需调用Commit后才对消费者可见
+    uint8_t* Reserve(size_t size) {
+        size = (size + kAlignment - 1) & ~(kAlignment - 1);
+        if (size > max_record_size()) {
+            return nullptr;
+        }
+        auto tail = tail_.load(std::memory_order_relaxed);
+        auto offset = tail & mask_;
+        auto remain = capacity() - offset;
+        auto need = remain < size ? remain + size : size;
+        if (tail + need - cached_head_ > capacity()) {
+            cached_head_ = head_.load(std::memory_order_acquire);
+            if (tail + need - cached_head_ > capacity()) {
+                return nullptr;
+            }
+        }
+        if (remain < size) {
+            auto padding = static_cast<uint32_t>(remain) | kPaddingFlag;
+            std::memcpy(&buffer_[offset], &padding, sizeof(padding));
+            offset = 0;
+        }
+        auto record_size = static_cast<uint32_t>(size);
+        std::memcpy(&buffer_[offset], &record_size, sizeof(record_size));
+        pending_tail_ = tail + need;
+        return &buffer_[offset];
+    }
+
+    // 仅生产者线程调用
+    void Commit() {
+        tail_.store(pending_tail_, std::memory_order_release);
+    }
+
+    // 仅消费者线程调用，func(const uint8_t* record)，record指向长度头，返回处理的记录数
+    template <typename Func>
+    size_t Consume(Func&& func) {
+        auto head = head_.load(std::memory_order_relaxed);
+        auto tail = tail_.load(std::memory_order_acquire);
+        size_t count = 0;
+        while (head != tail) {
+            auto record = &buffer_[head & mask_];
+            uint32_t size;
+            std::memcpy(&size, record, sizeof(size));
+            if (!(size & kPaddingFlag)) {
+                func(static_cast<const uint8_t*>(record));
+                ++count;
+            }
+            head += size & ~kPaddingFlag;
+            // 逐条释放，尽早为生产者腾出空间
+            head_.store(head, std::memory_order_release);
+        }
+        return count;
+    }
+
+    // 可由任意线程调用，结果仅供参考
+    bool Empty() const {
+        return head_.load(std::memory_order_acquire) == tail_.load(std::memory_order_acquire);
+    }
+
+private:
+    static constexpr size_t kCacheLineSize = 64;
+
+    size_t mask_ = 0;
+    std::unique_ptr<uint8_t[]> buffer_;
+
+    alignas(kCacheLineSize) std::atomic<size_t> head_ = 0;
+
+    alignas(kCacheLineSize) std::atomic<size_t> tail_ = 0;
+    size_t cached_head_ = 0;    // 生产者缓存的head_
+    size_t pending_tail_ = 0;   // Reserve后待提交的tail
+};
+
+} // namespace internal
+} // namespace million
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstdint>
+#include <cassert>
+
+#include <atomic>
+#include <memory>
+#include <new>
+#include <optional>
+
+#include <million/noncopyable.h>
+
+namespace million {
+namespace internal {
+
+// 单生产者单消费者的无锁环形队列
+// 生产者与消费者各自缓存对方的下标，减少跨核读取
+template <typename T>
+class SpscRing : noncopyable {
+public:
+    // capacity会向上取整为2的幂
+    explicit SpscRing(size_t capacity) {
+        size_t size = 2;
+        while (size < capacity) {
+            size <<= 1;
+        }
+        mask_ = size - 1;
+        buffer_ = std::make_unique<std::optional<T>[]>(size);
+    }
+    ~SpscRing() = default;
+
+    // 仅生产者线程调用
+    bool TryPush(T&& value) {
+        auto tail = tail_.load(std::memory_order_relaxed);
+        if (tail - cached_head_ > mask_) {
+            cached_head_ = head_.load(std::memory_order_acquire);
+            if (tail - cached_head_ > mask_) {
+                return false;
+            }
+        }
+        buffer_[tail & mask_].emplace(std::move(value));
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // 仅消费者线程调用
+    std::optional<T> TryPop() {
+        auto head = head_.load(std::memory_order_relaxed);
+        if (head == cached_tail_) {
+            cached_tail_ = tail_.load(std::memory_order_acquire);
+            if (head == cached_tail_) {
+                return std::nullopt;
+            }
+        }
+        auto& slot = buffer_[head & mask_];
+        std::optional<T> value = std::move(slot);
+        slot.reset();
+        head_.store(head + 1, std::memory_order_release);
+        return value;
+    }
+
+    // 可由任意线程调用，结果仅供参考
+    bool Empty() const {
+        return head_.load(std::memory_order_acquire) == tail_.load(std::memory_order_acquire);
+    }
+
+private:
+    static constexpr size_t kCacheLineSize = 64;
+
+    size_t mask_ = 0;
+    std::unique_ptr<std::optional<T>[]> buffer_;
+
+    alignas(kCacheLineSize) std::atomic<size_t> head_ = 0;
+    size_t cached_tail_ = 0;    // 消费者缓存的tail_
+
+    alignas(kCacheLineSize) std::atomic<size_t> tail_ = 0;
+    size_t cached_head_ = 0;    // 生产者缓存的head_
+};
+
+} // namespace internal
+} // namespace million
@@ -2,6 +2,7 @@
 
 #include <cstdint>
 
+#include <atomic>
 #include <functional>
 #include <chrono>
 #include <array>
@@ -9,6 +10,8 @@
 #include <vector>
 #include <mutex>
 
+#include <million/profiled_mutex.h>
+
 namespace million {
 namespace internal {
 
@@ -51,6 +54,7 @@ public:
             // 拿到第0层待推进的slot，执行任务
             auto& slot = slots_[indexs_[0]];
             if (!slot.empty()) {
+                size_.fetch_sub(slot.size(), std::memory_order_relaxed);
                 for (auto&& task : slot) {
                     callback(std::move(task));
                 }
@@ -82,6 +86,12 @@ public:
     void AddTask(uint32_t tick, T&& data) {
         auto lock = std::lock_guard(adds_mutex_);
         adds_.emplace_back(tick, std::move(data));
+        size_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // 尚未到期的任务数，可由任意线程读取
+    size_t size() const {
+        return size_.load(std::memory_order_relaxed);
     }
 
 protected:
@@ -126,9 +136,11 @@ protected:
     std::array<TaskQueue, kSlotCount * kCircleCount> slots_;  // 多层时间轮
     std::array<uint16_t, kCircleCount> indexs_{ 0 };  // 每一层当前指向的slot
 
-    std::mutex adds_mutex_;
+    ProfiledMutex adds_mutex_{ "wheel_timer.adds" };
     TaskQueue adds_;
     TaskQueue backup_adds_;
+
+    std::atomic<size_t> size_ = 0;
 };
 
 } // namespace internal
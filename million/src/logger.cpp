@@ -1,4 +1,10 @@
 #include <iostream>
+#include <condition_variable>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <typeinfo>
+#include <vector>
 
 #include <million/imillion.h>
 
@@ -7,12 +13,311 @@
 #include <million/logger.h>
 
 #include "million.h"
+#include "service_core.h"
+#include "internal/spsc_byte_ring.hpp"
 
 namespace million {
+
+// 环形缓冲区中每条记录的头部，其后为编码后的参数
+struct LogRecordHeader {
+    uint32_t size;          // 由SpscByteRing写入，包含对齐填充
+    LogSiteId site_id;
+    int64_t time_ns;        // system_clock
+    ServiceId service_id;
+    const char* service_type;
+    uint32_t args_size;
+};
+
+// 当前线程正在处理消息的服务
+static void GetCurrentService(ServiceId* service_id, const char** service_type) {
+    auto service = ServiceCore::current();
+    if (service) {
+        *service_id = service->service_id();
+        *service_type = typeid(service->iservice()).name();
+    }
+    else {
+        *service_id = 0;
+        *service_type = nullptr;
+    }
+}
+
+static std::chrono::system_clock::time_point NsToTimePoint(int64_t time_ns) {
+    return std::chrono::system_clock::time_point(std::chrono::duration_cast<std::chrono::system_clock::duration>(std::chrono::nanoseconds(time_ns)));
+}
+
+// 日志位置在进程内全局注册，各模块的LOG_*宏共用
+class LogSiteRegistry {
+public:
+    static LogSiteRegistry& Instance() {
+        static LogSiteRegistry registry;
+        return registry;
+    }
+
+    LogSiteId Register(LogSite site) {
+        auto lock = std::lock_guard(mutex_);
+        sites_.emplace_back(std::make_unique<LogSite>(std::move(site)));
+        return static_cast<LogSiteId>(sites_.size());
+    }
+
+    const LogSite* Find(LogSiteId id) {
+        auto lock = std::lock_guard(mutex_);
+        if (id == kLogSiteIdInvalid || id > sites_.size()) {
+            return nullptr;
+        }
+        return sites_[id - 1].get();
+    }
+
+private:
+    std::mutex mutex_;
+    std::vector<std::unique_ptr<LogSite>> sites_;
+};
+
+// 被限流过的调用位置，位置的状态为静态变量，加入后不再移除
+class SuppressedSiteList {
+public:
+    static SuppressedSiteList& Instance() {
+        static SuppressedSiteList list;
+        return list;
+    }
+
+    void Add(LogSiteState* site, const std::source_location& source, Logger::LogLevel level) {
+        if (site->listed.exchange(true, std::memory_order_relaxed)) {
+            return;
+        }
+        auto lock = std::lock_guard(mutex_);
+        site->source = source;
+        site->level = level;
+        sites_.emplace_back(site);
+    }
+
+    template <typename Func>
+    void ForEach(Func&& func) {
+        auto lock = std::lock_guard(mutex_);
+        for (auto site : sites_) {
+            func(site);
+        }
+    }
+
+private:
+    std::mutex mutex_;
+    std::vector<LogSiteState*> sites_;
+};
+
+// 每个线程一个环形缓冲区，线程退出后由后台线程写完剩余记录再回收
+class LogRing {
+public:
+    LogRing(size_t capacity, size_t thread_id)
+        : ring(capacity)
+        , thread_id(thread_id) {}
+
+    internal::SpscByteRing ring;
+    size_t thread_id;
+    std::atomic<bool> retired = false;
+};
+
+// 线程首次写日志时创建缓冲区，generation区分不同的Logger及重新开启的异步日志
+struct LocalLogRing {
+    ~LocalLogRing() {
+        if (ring) ring->retired.store(true, std::memory_order_release);
+    }
+
+    uint64_t generation = 0;
+    std::shared_ptr<LogRing> ring;
+};
+
+static thread_local LocalLogRing t_local_ring;
+
+class Logger::AsyncLog {
+public:
+    AsyncLog(LogSink* sink, const AsyncLogOptions& options)
+        : sink_(sink)
+        , options_(options)
+        , generation_(next_generation_.fetch_add(1, std::memory_order_relaxed) + 1)
+        , dropped_site_(Logger::RegisterSite(std::source_location::current(), LogLevel::kWarn, "dropped {} log records, ring buffer is full.", LogArgTypes<uint64_t>(), &FormatLogArgs<uint64_t>)) {}
+
+    ~AsyncLog() {
+        Stop();
+    }
+
+    void Start() {
+        flusher_.emplace([this](std::stop_token st) {
+            FlushLoop(st);
+        });
+    }
+
+    void Stop() {
+        if (!flusher_) {
+            return;
+        }
+        flusher_.reset();
+        // 后台线程已退出，在调用线程写出所有缓冲区中剩余的记录
+        Drain();
+    }
+
+    uint8_t* BeginRecord(LogSiteId site_id, size_t args_size) {
+        auto ring = CurrentRing();
+        auto buf = ring->ring.Reserve(sizeof(LogRecordHeader) + args_size);
+        if (!buf) {
+            if (!options_.sync_on_overflow) {
+                dropped_.fetch_add(1, std::memory_order_relaxed);
+            }
+            return nullptr;
+        }
+        auto header = reinterpret_cast<LogRecordHeader*>(buf);
+        header->site_id = site_id;
+        header->time_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+        GetCurrentService(&header->service_id, &header->service_type);
+        header->args_size = static_cast<uint32_t>(args_size);
+        return buf + sizeof(LogRecordHeader);
+    }
+
+    void CommitRecord() {
+        t_local_ring.ring->ring.Commit();
+    }
+
+    LogSink* sink() const { return sink_; }
+    const AsyncLogOptions& options() const { return options_; }
+    uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+private:
+    LogRing* CurrentRing() {
+        auto& local = t_local_ring;
+        if (local.generation != generation_) {
+            if (local.ring) local.ring->retired.store(true, std::memory_order_release);
+            local.ring = std::make_shared<LogRing>(options_.ring_size, sink_->CurrentThreadId());
+            local.generation = generation_;
+            auto lock = std::lock_guard(rings_mutex_);
+            rings_.emplace_back(local.ring);
+        }
+        return local.ring.get();
+    }
+
+    void FlushLoop(std::stop_token st) {
+        std::mutex mutex;
+        std::condition_variable_any cv;
+        auto interval = std::chrono::milliseconds(options_.flush_interval_ms);
+        auto lock = std::unique_lock(mutex);
+        while (!st.stop_requested()) {
+            Drain();
+            cv.wait_for(lock, st, interval, [] { return false; });
+        }
+    }
+
+    void Drain() {
+        {
+            auto lock = std::lock_guard(rings_mutex_);
+            draining_ = rings_;
+        }
+        size_t count = 0;
+        for (auto& ring : draining_) {
+            // 先读取退出标记，消费后缓冲区为空即可安全移除
+            auto retired = ring->retired.load(std::memory_order_acquire);
+            count += ring->ring.Consume([&](const uint8_t* record) {
+                WriteRecord(*ring, record);
+            });
+            if (retired) {
+                auto lock = std::lock_guard(rings_mutex_);
+                std::erase(rings_, ring);
+            }
+        }
+        draining_.clear();
+
+        auto dropped = dropped_.load(std::memory_order_relaxed);
+        if (dropped != reported_dropped_) {
+            auto dropped_count = dropped - reported_dropped_;
+            reported_dropped_ = dropped;
+            auto site = FindSite(dropped_site_);
+            buffer_.clear();
+            site->format(&buffer_, site->fmt, reinterpret_cast<const uint8_t*>(&dropped_count));
+            sink_->Write(LogRecordInfo{
+                .site_id = dropped_site_,
+                .site = site,
+                .time = std::chrono::system_clock::now(),
+                .thread_id = 0,
+                .service_id = 0,
+                .service_type = nullptr,
+                .text_only = true,
+            }, buffer_);
+            ++count;
+        }
+        if (count > 0) {
+            sink_->Flush();
+        }
+    }
+
+    void WriteRecord(const LogRing& ring, const uint8_t* record) {
+        LogRecordHeader header;
+        std::memcpy(&header, record, sizeof(header));
+        auto site = FindSite(header.site_id);
+        if (!site) {
+            return;
+        }
+        auto args = record + sizeof(LogRecordHeader);
+        LogRecordInfo info{
+            .site_id = header.site_id,
+            .site = site,
+            .time = NsToTimePoint(header.time_ns),
+            .thread_id = ring.thread_id,
+            .service_id = header.service_id,
+            .service_type = header.service_type,
+            .text_only = false,
+        };
+        if (sink_->WantsArgs()) {
+            sink_->WriteArgs(info, std::span<const uint8_t>(args, header.args_size));
+        }
+        if (!sink_->WantsText(*site)) {
+            return;
+        }
+        buffer_.clear();
+        try {
+            site->format(&buffer_, site->fmt, args);
+        }
+        catch (const std::format_error& e) {
+            buffer_ = std::format("format error: {}, fmt: {}", e.what(), site->fmt);
+        }
+        sink_->Write(info, buffer_);
+    }
+
+    // 后台线程缓存已注册的位置，减少加锁
+    const LogSite* FindSite(LogSiteId id) {
+        if (id < sites_.size() && sites_[id]) {
+            return sites_[id];
+        }
+        auto site = LogSiteRegistry::Instance().Find(id);
+        if (site) {
+            if (id >= sites_.size()) sites_.resize(id + 1);
+            sites_[id] = site;
+        }
+        return site;
+    }
+
+private:
+    static inline std::atomic<uint64_t> next_generation_ = 0;
+
+    LogSink* sink_;
+    AsyncLogOptions options_;
+    uint64_t generation_;
+    LogSiteId dropped_site_;
+
+    std::mutex rings_mutex_;
+    std::vector<std::shared_ptr<LogRing>> rings_;
+    std::atomic<uint64_t> dropped_ = 0;
+
+    // 以下仅由后台线程访问
+    std::vector<std::shared_ptr<LogRing>> draining_;
+    std::vector<const LogSite*> sites_;
+    std::string buffer_;
+    uint64_t reported_dropped_ = 0;
+
+    std::optional<std::jthread> flusher_;
+};
+
 Logger::Logger(Million* million)
     : million_(million) {}
 
-Logger::~Logger() = default;
+Logger::~Logger() {
+    StopAsync();
+}
 
 bool Logger::Init() {
     return true;
@@ -66,4 +371,115 @@ void Logger::SetLevel(const ServiceHandle& sender, LogLevel level) {
     million_->imillion().Send<LoggerSetLevel>(sender, logger_svr_handle_, level);
 }
 
+bool Logger::StartAsync(LogSink* sink, const AsyncLogOptions& options) {
+    auto lock = std::lock_guard(async_mutex_);
+    if (async_) {
+        LOG_ERROR("async log is already started.");
+        return false;
+    }
+    if (options.ring_size == 0) {
+        LOG_ERROR("invalid async log ring_size: 0.");
+        return false;
+    }
+    async_ = std::make_unique<AsyncLog>(sink, options);
+    async_->Start();
+    async_running_.store(true, std::memory_order_release);
+    return true;
+}
+
+void Logger::StopAsync() {
+    auto lock = std::lock_guard(async_mutex_);
+    if (!async_running_.exchange(false, std::memory_order_seq_cst)) {
+        return;
+    }
+    // 之后开始的写入都会走同步路径，等待已经开始的写入完成
+    while (async_writers_.load(std::memory_order_acquire) > 0) {
+        std::this_thread::yield();
+    }
+    async_->Stop();
+    stopped_dropped_ += async_->dropped();
+    async_.reset();
+}
+
+uint64_t Logger::dropped() const {
+    auto lock = std::lock_guard(async_mutex_);
+    return stopped_dropped_ + (async_ ? async_->dropped() : 0);
+}
+
+void Logger::SetRateLimit(LogLevel level, const LogRateLimit& limit) {
+    auto& state = rate_limits_[static_cast<size_t>(level)];
+    if (limit.rate == 0) {
+        state.interval_ns.store(0, std::memory_order_relaxed);
+        return;
+    }
+    int64_t interval = std::max<int64_t>(1000000000 / limit.rate, 1);
+    state.tolerance_ns.store(interval * (std::max<uint32_t>(limit.burst, 1) - 1), std::memory_order_relaxed);
+    state.interval_ns.store(interval, std::memory_order_relaxed);
+}
+
+void Logger::AddSuppressedSite(LogSiteState* site, const std::source_location& source, LogLevel level) {
+    SuppressedSiteList::Instance().Add(site, source, level);
+}
+
+void Logger::ReportSuppressed() {
+    struct Summary {
+        std::source_location source;
+        LogLevel level;
+        uint64_t count;
+    };
+    std::vector<Summary> summaries;
+    SuppressedSiteList::Instance().ForEach([&](LogSiteState* site) {
+        auto count = site->suppressed.exchange(0, std::memory_order_relaxed);
+        if (count > 0) {
+            summaries.emplace_back(Summary{ site->source, site->level, count });
+        }
+    });
+    // 汇总使用原位置及级别输出，不受限流影响
+    for (auto& summary : summaries) {
+        suppressed_.fetch_add(summary.count, std::memory_order_relaxed);
+        Log(summary.source, summary.level, std::format("suppressed {} messages.", summary.count));
+    }
+}
+
+LogSiteId Logger::RegisterSite(const std::source_location& source, LogLevel level, std::string_view fmt, std::string_view arg_types, LogFormatFunc format) {
+    return LogSiteRegistry::Instance().Register(LogSite{
+        .level = level,
+        .file_name = source.file_name(),
+        .line = source.line(),
+        .function_name = ExtractFunctionName(source.function_name()),
+        .fmt = fmt,
+        .arg_types = arg_types,
+        .format = format,
+    });
+}
+
+uint8_t* Logger::BeginRecord(LogSiteId site_id, size_t args_size) {
+    return async_->BeginRecord(site_id, args_size);
+}
+
+void Logger::CommitRecord() {
+    async_->CommitRecord();
+}
+
+void Logger::WriteSync(LogSiteId site_id, std::string_view msg) {
+    auto site = LogSiteRegistry::Instance().Find(site_id);
+    if (!site) {
+        return;
+    }
+    auto sink = async_->sink();
+    LogRecordInfo info{
+        .site_id = site_id,
+        .site = site,
+        .time = std::chrono::system_clock::now(),
+        .thread_id = sink->CurrentThreadId(),
+        .text_only = true,
+    };
+    GetCurrentService(&info.service_id, &info.service_type);
+    sink->Write(info, msg);
+}
+
+bool Logger::sync_on_overflow() const {
+    return async_->options().sync_on_overflow;
+}
+
 } // namespace million
\ No newline at end of file
@@ -0,0 +1,349 @@
+#include <million/metrics.h>
+
+#include <algorithm>
+#include <format>
+#include <unordered_map>
+
+namespace million {
+
+struct MetricsRegistry::State {
+    struct MetricInfo {
+        std::string name;
+        std::string help;
+    };
+
+    // 读取时通过回调取值的计数器及仪表盘
+    struct CallbackInfo {
+        std::string name;
+        std::string help;
+        MetricType type;
+        std::function<double()> getter;
+    };
+
+    std::mutex mutex;
+    std::vector<MetricInfo> counters;
+    std::vector<MetricInfo> histograms;
+    std::vector<CallbackInfo> callbacks;
+    std::vector<Collector> collectors;
+
+    std::vector<Shard*> shards;
+    // 已退出线程的分片合并到这里
+    Shard retired_shard;
+};
+
+// 线程持有的分片，线程退出时合并回所属注册表
+struct MetricsThreadLocal {
+    struct Entry {
+        MetricsRegistry* registry;
+        std::shared_ptr<MetricsRegistry::State> state;
+        std::unique_ptr<MetricsRegistry::Shard> shard;
+    };
+
+    ~MetricsThreadLocal() {
+        for (auto& entry : entries) {
+            auto lock = std::lock_guard(entry.state->mutex);
+            auto& from = *entry.shard;
+            auto& to = entry.state->retired_shard;
+            for (size_t i = 0; i < MetricsRegistry::kMaxCounters; ++i) {
+                to.counters[i].fetch_add(from.counters[i].load(std::memory_order_relaxed), std::memory_order_relaxed);
+            }
+            for (size_t i = 0; i < MetricsRegistry::kMaxHistograms; ++i) {
+                auto* from_histogram = from.histograms[i].load(std::memory_order_acquire);
+                if (!from_histogram) continue;
+                auto& to_histogram = to.Histogram(static_cast<MetricId>(i));
+                for (size_t j = 0; j < HistogramBuckets::kBucketCount; ++j) {
+                    to_histogram.buckets[j].fetch_add(from_histogram->buckets[j].load(std::memory_order_relaxed), std::memory_order_relaxed);
+                }
+                to_histogram.count.fetch_add(from_histogram->count.load(std::memory_order_relaxed), std::memory_order_relaxed);
+                to_histogram.sum.fetch_add(from_histogram->sum.load(std::memory_order_relaxed), std::memory_order_relaxed);
+                auto max = from_histogram->max.load(std::memory_order_relaxed);
+                if (max > to_histogram.max.load(std::memory_order_relaxed)) {
+                    to_histogram.max.store(max, std::memory_order_relaxed);
+                }
+            }
+            std::erase(entry.state->shards, entry.shard.get());
+        }
+    }
+
+    MetricsRegistry* last_registry = nullptr;
+    MetricsRegistry::Shard* last_shard = nullptr;
+    std::vector<Entry> entries;
+};
+
+static thread_local MetricsThreadLocal tls_metrics;
+
+MetricsRegistry::Shard::~Shard() {
+    for (auto& histogram : histograms) {
+        delete histogram.load(std::memory_order_relaxed);
+    }
+}
+
+MetricsRegistry::HistogramData& MetricsRegistry::Shard::Histogram(MetricId id) {
+    auto* histogram = histograms[id].load(std::memory_order_relaxed);
+    if (!histogram) {
+        histogram = new HistogramData();
+        histograms[id].store(histogram, std::memory_order_release);
+    }
+    return *histogram;
+}
+
+MetricsRegistry::MetricsRegistry()
+    : state_(std::make_shared<State>()) {}
+
+MetricsRegistry::~MetricsRegistry() {
+    if (tls_metrics.last_registry == this) {
+        tls_metrics.last_registry = nullptr;
+        tls_metrics.last_shard = nullptr;
+    }
+}
+
+MetricId MetricsRegistry::RegisterCounter(std::string_view name, std::string_view help) {
+    auto lock = std::lock_guard(state_->mutex);
+    auto& counters = state_->counters;
+    for (size_t i = 0; i < counters.size(); ++i) {
+        if (counters[i].name == name) {
+            return static_cast<MetricId>(i);
+        }
+    }
+    if (counters.size() >= kMaxCounters) {
+        return kMetricIdInvalid;
+    }
+    counters.emplace_back(State::MetricInfo{ std::string(name), std::string(help) });
+    return static_cast<MetricId>(counters.size() - 1);
+}
+
+MetricId MetricsRegistry::RegisterHistogram(std::string_view name, std::string_view help) {
+    auto lock = std::lock_guard(state_->mutex);
+    auto& histograms = state_->histograms;
+    for (size_t i = 0; i < histograms.size(); ++i) {
+        if (histograms[i].name == name) {
+            return static_cast<MetricId>(i);
+        }
+    }
+    if (histograms.size() >= kMaxHistograms) {
+        return kMetricIdInvalid;
+    }
+    histograms.emplace_back(State::MetricInfo{ std::string(name), std::string(help) });
+    return static_cast<MetricId>(histograms.size() - 1);
+}
+
+void MetricsRegistry::RegisterCounter(std::string_view name, std::string_view help, std::function<double()> getter) {
+    auto lock = std::lock_guard(state_->mutex);
+    state_->callbacks.emplace_back(State::CallbackInfo{ std::string(name), std::string(help), MetricType::kCounter, std::move(getter) });
+}
+
+void MetricsRegistry::RegisterGauge(std::string_view name, std::string_view help, std::function<double()> getter) {
+    auto lock = std::lock_guard(state_->mutex);
+    state_->callbacks.emplace_back(State::CallbackInfo{ std::string(name), std::string(help), MetricType::kGauge, std::move(getter) });
+}
+
+void MetricsRegistry::AddCollector(Collector collector) {
+    auto lock = std::lock_guard(state_->mutex);
+    state_->collectors.emplace_back(std::move(collector));
+}
+
+MetricsRegistry::Shard& MetricsRegistry::LocalShard() {
+    if (tls_metrics.last_registry == this) {
+        return *tls_metrics.last_shard;
+    }
+    for (auto& entry : tls_metrics.entries) {
+        if (entry.registry == this && entry.state == state_) {
+            tls_metrics.last_registry = this;
+            tls_metrics.last_shard = entry.shard.get();
+            return *entry.shard;
+        }
+    }
+    auto shard = std::make_unique<Shard>();
+    {
+        auto lock = std::lock_guard(state_->mutex);
+        state_->shards.emplace_back(shard.get());
+    }
+    tls_metrics.last_registry = this;
+    tls_metrics.last_shard = shard.get();
+    tls_metrics.entries.emplace_back(MetricsThreadLocal::Entry{ this, state_, std::move(shard) });
+    return *tls_metrics.last_shard;
+}
+
+MetricsSnapshot MetricsRegistry::Snapshot() {
+    MetricsSnapshot snapshot;
+    std::vector<Collector> collectors;
+    {
+        auto lock = std::lock_guard(state_->mutex);
+        auto& counters = state_->counters;
+        auto& histograms = state_->histograms;
+
+        std::vector<uint64_t> counter_values(counters.size(), 0);
+        std::vector<HistogramSnapshot> histogram_values(histograms.size());
+        std::vector<std::array<uint64_t, HistogramBuckets::kBucketCount>> bucket_values(histograms.size());
+
+        auto merge = [&](const Shard& shard) {
+            for (size_t i = 0; i < counters.size(); ++i) {
+                counter_values[i] += shard.counters[i].load(std::memory_order_relaxed);
+            }
+            for (size_t i = 0; i < histograms.size(); ++i) {
+                auto* histogram = shard.histograms[i].load(std::memory_order_acquire);
+                if (!histogram) continue;
+                for (size_t j = 0; j < HistogramBuckets::kBucketCount; ++j) {
+                    bucket_values[i][j] += histogram->buckets[j].load(std::memory_order_relaxed);
+                }
+                histogram_values[i].count += histogram->count.load(std::memory_order_relaxed);
+                histogram_values[i].sum += histogram->sum.load(std::memory_order_relaxed);
+                histogram_values[i].max = std::max(histogram_values[i].max, histogram->max.load(std::memory_order_relaxed));
+            }
+        };
+        for (auto& values : bucket_values) {
+            values.fill(0);
+        }
+        merge(state_->retired_shard);
+        for (auto* shard : state_->shards) {
+            merge(*shard);
+        }
+
+        for (size_t i = 0; i < counters.size(); ++i) {
+            MetricSample sample;
+            sample.name = counters[i].name;
+            sample.help = counters[i].help;
+            sample.type = MetricType::kCounter;
+            sample.value = static_cast<double>(counter_values[i]);
+            snapshot.samples.emplace_back(std::move(sample));
+        }
+        for (size_t i = 0; i < histograms.size(); ++i) {
+            auto& histogram = histogram_values[i];
+            for (size_t j = 0; j < HistogramBuckets::kBucketCount; ++j) {
+                if (bucket_values[i][j] > 0) {
+                    histogram.buckets.emplace_back(HistogramBuckets::BucketUpperBound(j), bucket_values[i][j]);
+                }
+            }
+            MetricSample sample;
+            sample.name = histograms[i].name;
+            sample.help = histograms[i].help;
+            sample.type = MetricType::kHistogram;
+            sample.histogram = std::move(histogram);
+            snapshot.samples.emplace_back(std::move(sample));
+        }
+        for (auto& callback : state_->callbacks) {
+            MetricSample sample;
+            sample.name = callback.name;
+            sample.help = callback.help;
+            sample.type = callback.type;
+            sample.value = callback.getter();
+            snapshot.samples.emplace_back(std::move(sample));
+        }
+        collectors = state_->collectors;
+    }
+    // 采集回调可能需要获取其他锁，不在持有注册表锁时调用
+    for (auto& collector : collectors) {
+        collector(&snapshot);
+    }
+    return snapshot;
+}
+
+static void AppendEscaped(std::string* out, std::string_view str, bool escape_quote) {
+    for (auto c : str) {
+        switch (c) {
+        case '\\': out->append("\\\\"); break;
+        case '\n': out->append("\\n"); break;
+        case '"':
+            if (escape_quote) {
+                out->append("\\\"");
+                break;
+            }
+            [[fallthrough]];
+        default: out->push_back(c); break;
+        }
+    }
+}
+
+static void AppendLabels(std::string* out, const MetricLabels& labels, std::string_view extra_name = {}, std::string_view extra_value = {}) {
+    if (labels.empty() && extra_name.empty()) {
+        return;
+    }
+    out->push_back('{');
+    bool first = true;
+    for (auto& [name, value] : labels) {
+        if (!first) out->push_back(',');
+        first = false;
+        out->append(name);
+        out->append("=\"");
+        AppendEscaped(out, value, true);
+        out->push_back('"');
+    }
+    if (!extra_name.empty()) {
+        if (!first) out->push_back(',');
+        out->append(extra_name);
+        out->append("=\"");
+        out->append(extra_value);
+        out->push_back('"');
+    }
+    out->push_back('}');
+}
+
+std::string RenderPrometheusText(const MetricsSnapshot& snapshot) {
+    // 同名指标必须连续输出，按首次出现的顺序分组
+    std::vector<std::vector<const MetricSample*>> families;
+    std::unordered_map<std::string_view, size_t> family_index;
+    for (auto& sample : snapshot.samples) {
+        auto [iter, inserted] = family_index.emplace(sample.name, families.size());
+        if (inserted) {
+            families.emplace_back();
+        }
+        families[iter->second].emplace_back(&sample);
+    }
+
+    std::string out;
+    for (auto& family : families) {
+        auto& first = *family.front();
+        const char* type = "untyped";
+        switch (first.type) {
+        case MetricType::kCounter: type = "counter"; break;
+        case MetricType::kGauge: type = "gauge"; break;
+        case MetricType::kHistogram: type = "histogram"; break;
+        }
+        if (!first.help.empty()) {
+            out.append("# HELP ");
+            out.append(first.name);
+            out.push_back(' ');
+            AppendEscaped(&out, first.help, false);
+            out.push_back('\n');
+        }
+        out.append(std::format("# TYPE {} {}\n", first.name, type));
+
+        for (auto* sample : family) {
+            if (sample->type != MetricType::kHistogram) {
+                out.append(sample->name);
+                AppendLabels(&out, sample->labels);
+                out.append(std::format(" {}\n", sample->value));
+                continue;
+            }
+            auto& histogram = sample->histogram;
+            // 每次都输出完整的固定桶，否则抓取之间的桶集合会变化
+            uint64_t cumulative = 0;
+            auto iter = histogram.buckets.begin();
+            for (size_t i = 0; i < HistogramBuckets::kExportBucketCount; ++i) {
+                auto le = HistogramBuckets::ExportUpperBound(i);
+                for (; iter != histogram.buckets.end() && iter->first <= le; ++iter) {
+                    cumulative += iter->second;
+                }
+                out.append(sample->name);
+                out.append("_bucket");
+                AppendLabels(&out, sample->labels, "le", std::to_string(le));
+                out.append(std::format(" {}\n", cumulative));
+            }
+            out.append(sample->name);
+            out.append("_bucket");
+            AppendLabels(&out, sample->labels, "le", "+Inf");
+            out.append(std::format(" {}\n", histogram.count));
+            out.append(sample->name);
+            out.append("_sum");
+            AppendLabels(&out, sample->labels);
+            out.append(std::format(" {}\n", histogram.sum));
+            out.append(sample->name);
+            out.append("_count");
+            AppendLabels(&out, sample->labels);
+            out.append(std::format(" {}\n", histogram.count));
+        }
+    }
+    return out;
+}
+
+} // namespace million
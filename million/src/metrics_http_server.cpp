@@ -0,0 +1,106 @@
+#include "metrics_http_server.h"
+
+#include <format>
+
+#include <million/metrics.h>
+
+#include "million.h"
+#include "io_context.h"
+#include "io_context_mgr.h"
+
+namespace million {
+
+MetricsHttpServer::MetricsHttpServer(Million* million, std::string host, uint16_t port, std::string path)
+    : million_(million)
+    , host_(std::move(host))
+    , port_(port)
+    , path_(std::move(path)) {}
+
+MetricsHttpServer::~MetricsHttpServer() = default;
+
+bool MetricsHttpServer::Start() {
+    auto& io_context = million_->io_context_mgr().NextIoContext().io_context();
+    try {
+        auto endpoint = asio::ip::tcp::endpoint(asio::ip::make_address(host_), port_);
+        acceptor_.emplace(io_context, endpoint);
+    }
+    catch (const std::exception& e) {
+        million_->logger().LOG_ERROR("metrics http server listen on {}:{} failed: {}", host_, port_, e.what());
+        return false;
+    }
+    asio::co_spawn(io_context, Listen(), asio::detached);
+    million_->logger().LOG_INFO("metrics http server listen on {}:{}{}.", host_, port_, path_);
+    return true;
+}
+
+void MetricsHttpServer::Stop() {
+    if (!acceptor_) {
+        return;
+    }
+    asio::post(acceptor_->get_executor(), [this] {
+        asio::error_code ec;
+        acceptor_->close(ec);
+    });
+}
+
+asio::awaitable<void> MetricsHttpServer::Listen() {
+    while (acceptor_->is_open()) {
+        try {
+            auto socket = co_await acceptor_->async_accept(asio::use_awaitable);
+            auto executor = socket.get_executor();
+            asio::co_spawn(executor, HandleConnection(std::move(socket)), asio::detached);
+        }
+        catch (const asio::system_error& e) {
+            if (e.code() == asio::error::operation_aborted) {
+                break;
+            }
+            million_->logger().LOG_ERROR("metrics http server accept exception: {}", e.what());
+        }
+    }
+    co_return;
+}
+
+asio::awaitable<void> MetricsHttpServer::HandleConnection(asio::ip::tcp::socket socket) {
+    try {
+        asio::streambuf buffer(kMaxRequestSize);
+        auto size = co_await asio::async_read_until(socket, buffer, "\r\n\r\n", asio::use_awaitable);
+        auto request = std::string_view(static_cast<const char*>(buffer.data().data()), size);
+        auto response = HandleRequest(request);
+        co_await asio::async_write(socket, asio::buffer(response), asio::use_awaitable);
+        asio::error_code ec;
+        socket.shutdown(asio::ip::tcp::socket::shutdown_both, ec);
+    }
+    catch (const std::exception& e) {
+        million_->logger().LOG_DEBUG("metrics http connection closed: {}", e.what());
+    }
+    co_return;
+}
+
+std::string MetricsHttpServer::HandleRequest(std::string_view request) {
+    auto make_response = [](std::string_view status, std::string_view content_type, std::string_view body) {
+        return std::format("HTTP/1.1 {}\r\nContent-Type: {}\r\nContent-Length: {}\r\nConnection: close\r\n\r\n{}",
+            status, content_type, body.size(), body);
+    };
+
+    // 请求行: METHOD SP PATH SP VERSION
+    auto line = request.substr(0, request.find("\r\n"));
+    auto method_end = line.find(' ');
+    if (method_end == std::string_view::npos) {
+        return make_response("400 Bad Request", "text/plain", "bad request\n");
+    }
+    auto method = line.substr(0, method_end);
+    auto target = line.substr(method_end + 1);
+    target = target.substr(0, target.find(' '));
+    auto path = target.substr(0, target.find('?'));
+
+    if (method != "GET") {
+        return make_response("405 Method Not Allowed", "text/plain", "method not allowed\n");
+    }
+    if (path != path_) {
+        return make_response("404 Not Found", "text/plain", "not found\n");
+    }
+    auto body = RenderPrometheusText(million_->metrics().Snapshot());
+    return make_response("200 OK", "text/plain; version=0.0.4; charset=utf-8", body);
+}
+
+} // namespace million
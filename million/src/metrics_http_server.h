@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstdint>
+
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include <asio.hpp>
+
+#include <million/noncopyable.h>
+
+namespace million {
+
+class Million;
+// 指标抓取服务，仅支持 GET <path>，按Prometheus文本格式返回当前指标快照
+class MetricsHttpServer : noncopyable {
+public:
+    MetricsHttpServer(Million* million, std::string host, uint16_t port, std::string path);
+    ~MetricsHttpServer();
+
+    bool Start();
+    void Stop();
+
+private:
+    asio::awaitable<void> Listen();
+    asio::awaitable<void> HandleConnection(asio::ip::tcp::socket socket);
+    std::string HandleRequest(std::string_view request);
+
+private:
+    // 请求头最大长度，抓取请求只有几行，超出则直接断开
+    static constexpr size_t kMaxRequestSize = 8192;
+
+    Million* million_;
+    std::string host_;
+    uint16_t port_;
+    std::string path_;
+    std::optional<asio::ip::tcp::acceptor> acceptor_;
+};
+
+} // namespace million
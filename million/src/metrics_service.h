@@ -0,0 +1,27 @@
+#pragma once
+
+#include <million/imillion.h>
+#include <million/metrics.h>
+
+namespace million {
+
+// 指标快照服务，其他服务可以通过MetricsSnapshotReq获取当前指标
+class MetricsService : public IService {
+    MILLION_SERVICE_DEFINE(MetricsService);
+
+public:
+    using Base = IService;
+
+    MetricsService(IMillion* imillion, MetricsRegistry* metrics)
+        : Base(imillion)
+        , metrics_(metrics) {}
+
+    MILLION_MESSAGE_HANDLE(MetricsSnapshotReq, msg) {
+        co_return make_message<MetricsSnapshotResp>(metrics_->Snapshot());
+    }
+
+private:
+    MetricsRegistry* metrics_;
+};
+
+} // namespace million
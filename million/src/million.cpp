@@ -1,11 +1,18 @@
 #include "million.h"
 
 #include <cassert>
+#include <chrono>
+#include <condition_variable>
+#include <format>
+#include <mutex>
 #include <iostream>
+#include <typeinfo>
 
 #include <yaml-cpp/yaml.h>
 
 #include <million/seata_snowflake.hpp>
+#include <million/profiled_mutex.h>
+#include <million/proto_arena.h>
 
 #include "service_mgr.h"
 #include "session_mgr.h"
@@ -15,6 +22,11 @@
 #include "io_context.h"
 #include "io_context_mgr.h"
 #include "timer.h"
+#include "metrics_service.h"
+#include "metrics_http_server.h"
+#include "tracer.h"
+#include "handler_watchdog.h"
+#include "worker.h"
 
 #ifdef WIN32
 #undef StartService
@@ -40,8 +52,42 @@ extern "C" MILLION_API void MillionMemFree(void* ptr) {
 }
 
 
+// 初始化各阶段的耗时，在init success时一并输出
+struct InitPhaseTimer {
+    using Clock = std::chrono::steady_clock;
+
+    void Finish(std::string_view phase) {
+        auto now = Clock::now();
+        phases.emplace_back(phase, now - last);
+        last = now;
+    }
+
+    static double ToMs(Clock::duration duration) {
+        return std::chrono::duration<double, std::milli>(duration).count();
+    }
+
+    double total_ms() const { return ToMs(last - start); }
+
+    std::string Summary() const {
+        std::string summary;
+        for (const auto& [phase, duration] : phases) {
+            if (!summary.empty()) {
+                summary += ", ";
+            }
+            summary += std::format("{}: {:.3f}ms", phase, ToMs(duration));
+        }
+        return summary;
+    }
+
+    Clock::time_point start = Clock::now();
+    Clock::time_point last = start;
+    std::vector<std::pair<std::string_view, Clock::duration>> phases;
+};
+
 Million::Million(IMillion* imillion)
-    : imillion_(imillion) {
+    : imillion_(imillion)
+    , metrics_(std::make_unique<MetricsRegistry>())
+    , tracer_(std::make_unique<Tracer>()) {
 }
 
 Million::~Million() {
@@ -53,6 +99,7 @@ bool Million::Init(std::string_view settings_path) {
         throw std::runtime_error("Repeat initialization.");
     }
 
+    InitPhaseTimer phase_timer;
     try {
         do {
             logger_ = std::make_unique<Logger>(this);
@@ -60,6 +107,7 @@ bool Million::Init(std::string_view settings_path) {
                 std::cerr << "[million] logger init failed." << std::endl;
                 break;
             }
+            phase_timer.Finish("logger");
 
             logger().LOG_INFO("init start.");
 
@@ -80,6 +128,7 @@ bool Million::Init(std::string_view settings_path) {
 
             service_mgr_ = std::make_unique<ServiceMgr>(this);
             session_mgr_ = std::make_unique<SessionMgr>(this);
+            phase_timer.Finish("settings");
 
             logger().LOG_INFO("load 'worker_mgr' settings.");
 
@@ -93,7 +142,70 @@ bool Million::Init(std::string_view settings_path) {
                 return false;
             }
             auto worker_num = worker_mgr_settings["num"].as<size_t>();
-            worker_mgr_ = std::make_unique<WorkerMgr>(this, worker_num);
+            // shared: 所有worker共享全局服务队列; shard: 每个worker固定处理一组服务
+            bool shard_mode = false;
+            if (worker_mgr_settings["mode"]) {
+                auto mode = worker_mgr_settings["mode"].as<std::string>();
+                if (mode == "shard") {
+                    shard_mode = true;
+                }
+                else if (mode != "shared") {
+                    logger().LOG_ERROR("invalid 'worker_mgr.mode': {}.", mode);
+                    return false;
+                }
+            }
+            size_t shard_ring_size = 1024;
+            if (worker_mgr_settings["shard_ring_size"]) {
+                shard_ring_size = worker_mgr_settings["shard_ring_size"].as<size_t>();
+            }
+            worker_mgr_ = std::make_unique<WorkerMgr>(this, worker_num, shard_mode, shard_ring_size);
+
+            WorkerIdleStrategy idle_strategy;
+            const auto& idle_settings = worker_mgr_settings["idle"];
+            if (idle_settings) {
+                if (idle_settings["spin_min"]) {
+                    idle_strategy.spin_min = idle_settings["spin_min"].as<uint32_t>();
+                }
+                if (idle_settings["spin_max"]) {
+                    idle_strategy.spin_max = idle_settings["spin_max"].as<uint32_t>();
+                }
+                if (idle_settings["yield_count"]) {
+                    idle_strategy.yield_count = idle_settings["yield_count"].as<uint32_t>();
+                }
+                if (idle_strategy.spin_min > idle_strategy.spin_max) {
+                    logger().LOG_WARN("'worker_mgr.idle.spin_min' is greater than 'spin_max', use spin_max.");
+                    idle_strategy.spin_min = idle_strategy.spin_max;
+                }
+            }
+            service_mgr_->SetWorkerIdleStrategy(idle_strategy);
+
+            const auto& rebalance_settings = worker_mgr_settings["rebalance"];
+            if (rebalance_settings) {
+                if (!shard_mode) {
+                    logger().LOG_WARN("'worker_mgr.rebalance' only takes effect in shard mode.");
+                }
+                else {
+                    ShardRebalanceConfig rebalance_config;
+                    if (rebalance_settings["interval_ms"]) {
+                        rebalance_config.interval_ms = rebalance_settings["interval_ms"].as<uint32_t>();
+                    }
+                    if (rebalance_settings["imbalance_ratio"]) {
+                        rebalance_config.imbalance_ratio = rebalance_settings["imbalance_ratio"].as<double>();
+                    }
+                    if (rebalance_settings["min_busy_ratio"]) {
+                        rebalance_config.min_busy_ratio = rebalance_settings["min_busy_ratio"].as<double>();
+                    }
+                    if (rebalance_settings["cooldown_intervals"]) {
+                        rebalance_config.cooldown_intervals = rebalance_settings["cooldown_intervals"].as<uint32_t>();
+                    }
+                    if (rebalance_config.interval_ms == 0) {
+                        logger().LOG_ERROR("'worker_mgr.rebalance.interval_ms' cannot be 0.");
+                        return false;
+                    }
+                    worker_mgr_->EnableRebalance(rebalance_config);
+                }
+            }
+            phase_timer.Finish("worker_mgr");
 
 
             logger().LOG_INFO("load 'io_context_mgr' settings.");
@@ -109,6 +221,7 @@ bool Million::Init(std::string_view settings_path) {
             }
             auto io_context_num = io_context_mgr_settings["num"].as<size_t>();
             io_context_mgr_ = std::make_unique<IoContextMgr>(this, io_context_num);
+            phase_timer.Finish("io_context_mgr");
 
 
             logger().LOG_INFO("load 'session_monitor' settings.");
@@ -129,12 +242,15 @@ bool Million::Init(std::string_view settings_path) {
             }
             auto timeout_s = session_monitor_settings["timeout_tick"].as<uint32_t>();
             session_monitor_ = std::make_unique<SessionMonitor>(this, tick_s, timeout_s);
+            phase_timer.Finish("session_monitor");
 
 
             logger().LOG_INFO("load 'proto_mgr' settings.");
 
             proto_mgr_ = std::make_unique<ProtoMgr>();
             proto_mgr_->Init();
+            cpp_codec_ = std::make_unique<CppMessageCodec>();
+            phase_timer.Finish("proto_mgr");
 
 
             logger().LOG_INFO("load 'timer' settings.");
@@ -150,6 +266,34 @@ bool Million::Init(std::string_view settings_path) {
             }
             auto ms_per_tick = timer_settings["ms_per_tick"].as<uint32_t>();
             timer_ = std::make_unique<Timer>(this, ms_per_tick);
+            phase_timer.Finish("timer");
+
+            RegisterCoreMetrics();
+
+            if (!LoadMetricsSettings(settings)) {
+                break;
+            }
+
+            if (!LoadTracerSettings(settings)) {
+                break;
+            }
+
+            if (!LoadWatchdogSettings(settings)) {
+                break;
+            }
+
+            if (!LoadLockProfileSettings(settings)) {
+                break;
+            }
+
+            if (!LoadProtoArenaSettings(settings)) {
+                break;
+            }
+
+            if (!LoadProtoPoolSettings(settings)) {
+                break;
+            }
+            phase_timer.Finish("optional_settings");
 
             logger().LOG_INFO("load 'module_mgr' settings.");
 
@@ -176,13 +320,15 @@ bool Million::Init(std::string_view settings_path) {
                 }
                 for (const auto& name_settings : loads) {
                     auto name = name_settings.as<std::string>();
+                    auto load_begin = InitPhaseTimer::Clock::now();
                     if (!module_mgr_->Load(module_dir, name)) {
                         logger().LOG_ERROR("load module '{} -> {}' failed.", module_dir, name);
                         success = false;
                         break;
                     }
                     else {
-                        logger().LOG_INFO("load module '{} -> {}' success.", module_dir, name);
+                        logger().LOG_INFO("load module '{} -> {}' success, {:.3f}ms.", module_dir, name,
+                            InitPhaseTimer::ToMs(InitPhaseTimer::Clock::now() - load_begin));
                     }
                 }
                 if (!success) {
@@ -192,18 +338,27 @@ bool Million::Init(std::string_view settings_path) {
             if (!success) {
                 break;
             }
+            phase_timer.Finish("module_load");
             if (!module_mgr_->Init()) {
                 logger().LOG_ERROR("module mgr init failed.");
                 break;
             }
+            phase_timer.Finish("module_init");
+
+            metrics_service_ = imillion_->NewService<MetricsService>(metrics_.get());
+            if (!metrics_service_) {
+                logger().LOG_ERROR("create metrics service failed.");
+                break;
+            }
 
             stage_ = kReady;
 
             if (!imillion_->OnInit()) {
                 logger().LOG_ERROR("imillion OnInit failed.");
             }
+            phase_timer.Finish("on_init");
 
-            logger().LOG_INFO("init success.");
+            logger().LOG_INFO("init success, {:.3f}ms ({}).", phase_timer.total_ms(), phase_timer.Summary());
             return true;
 
         } while (false);
@@ -219,16 +374,25 @@ void Million::Start() {
     if (stage_ != kReady) {
         throw std::runtime_error("Not initialized.");
     }
+    // 显式配置了指标抓取服务时，监听失败视为启动失败，需在其他组件启动前检查
+    if (metrics_http_server_ && !metrics_http_server_->Start()) {
+        throw std::runtime_error("metrics http server start failed.");
+    }
     worker_mgr_->Start();
     io_context_mgr_->Start();
     session_monitor_->Start();
     timer_->Start();
+    if (handler_watchdog_) handler_watchdog_->Start();
+    if (lock_profile_log_interval_s_ > 0) StartLockProfileLog();
     module_mgr_->Start();
 }
 
 void Million::Stop() {
     if (module_mgr_) module_mgr_->Stop();
     if (timer_) timer_->Stop();
+    if (metrics_http_server_) metrics_http_server_->Stop();
+    if (handler_watchdog_) handler_watchdog_->Stop();
+    lock_profile_log_thread_.reset();
     if (service_mgr_) service_mgr_->Stop();
     if (session_monitor_) session_monitor_->Stop();
     if (io_context_mgr_) io_context_mgr_->Stop();
@@ -236,8 +400,8 @@ void Million::Stop() {
 }
 
 
-std::optional<ServiceShared> Million::AddService(std::unique_ptr<IService> iservice) {
-    return service_mgr_->AddService(std::move(iservice));
+std::optional<ServiceShared> Million::AddService(std::unique_ptr<IService> iservice, std::optional<size_t> shard_id) {
+    return service_mgr_->AddService(std::move(iservice), shard_id);
 }
 
 
@@ -267,18 +431,26 @@ SessionId Million::NewSession() {
 }
 
 
-bool Million::SendTo(const ServiceShared& sender, const ServiceShared& target, SessionId session_id, MessagePointer msg) {
-    return service_mgr_->Send(sender, target, session_id, std::move(msg));
+bool Million::SendTo(const ServiceShared& sender, const ServiceShared& target, SessionId session_id, MessagePointer msg, SessionDeadline deadline) {
+    return service_mgr_->Send(sender, target, session_id, std::move(msg), deadline);
 }
 
-std::optional<SessionId> Million::Send(const ServiceShared& sender, const ServiceShared& target, MessagePointer msg) {
+std::optional<SessionId> Million::Send(const ServiceShared& sender, const ServiceShared& target, MessagePointer msg, SessionDeadline deadline) {
     auto session_id = session_mgr_->NewSession();
-    if (SendTo(sender, target, session_id, std::move(msg))) {
+    if (SendTo(sender, target, session_id, std::move(msg), deadline)) {
         return session_id;
     }
     return std::nullopt;
 }
 
+MailboxPushResult Million::TrySendTo(const ServiceShared& sender, const ServiceShared& target, SessionId session_id, MessagePointer& msg) {
+    return service_mgr_->TrySend(sender, target, session_id, msg);
+}
+
+bool Million::WaitMailboxWritable(const ServiceShared& waiter, const ServiceShared& target, SessionId wait_session_id) {
+    return target->AddMailboxWaiter(waiter, wait_session_id);
+}
+
 
 const YAML::Node& Million::YamlSettings() const {
     return *settings_;
@@ -296,4 +468,308 @@ void Million::EnableSeparateWorker(const ServiceShared& service) {
     service->EnableSeparateWorker();
 }
 
+void Million::EnableDirectDispatch(const ServiceShared& service) {
+    service->EnableDirectDispatch();
+}
+
+void Million::EnablePriorityLanes(const ServiceShared& service, bool enable) {
+    service->EnablePriorityLanes(enable);
+}
+
+void Million::SetMailboxCapacity(const ServiceShared& service, size_t capacity, MailboxFullPolicy policy) {
+    service->SetMailboxCapacity(capacity, policy);
+}
+
+MailboxStats Million::GetMailboxStats(const ServiceShared& service) {
+    return service->GetMailboxStats();
+}
+
+bool Million::LoadMetricsSettings(const YAML::Node& settings) {
+    const auto& metrics_settings = settings["metrics"];
+    if (!metrics_settings) {
+        return true;
+    }
+    if (metrics_settings["enable"] && !metrics_settings["enable"].as<bool>()) {
+        return true;
+    }
+    logger().LOG_INFO("load 'metrics' settings.");
+    if (!kMetricsEnabled) {
+        logger().LOG_WARN("metrics instrumentation is compiled out, counters and histograms updated via MetricsRegistry::Add/Record (core and module) stay at zero, only gauges and collected samples are reported.");
+    }
+    if (!metrics_settings["port"]) {
+        logger().LOG_ERROR("cannot find 'metrics.port'.");
+        return false;
+    }
+    auto port = metrics_settings["port"].as<uint16_t>();
+    std::string host = "127.0.0.1";
+    if (metrics_settings["host"]) {
+        host = metrics_settings["host"].as<std::string>();
+    }
+    std::string path = "/metrics";
+    if (metrics_settings["path"]) {
+        path = metrics_settings["path"].as<std::string>();
+    }
+    metrics_http_server_ = std::make_unique<MetricsHttpServer>(this, std::move(host), port, std::move(path));
+    return true;
+}
+
+bool Million::LoadTracerSettings(const YAML::Node& settings) {
+    const auto& tracer_settings = settings["tracer"];
+    if (!tracer_settings) {
+        return true;
+    }
+    if (tracer_settings["enable"] && !tracer_settings["enable"].as<bool>()) {
+        return true;
+    }
+    logger().LOG_INFO("load 'tracer' settings.");
+    TracerConfig config;
+    if (tracer_settings["sample_rate"]) {
+        config.sample_rate = tracer_settings["sample_rate"].as<uint32_t>();
+        if (config.sample_rate == 0) {
+            logger().LOG_ERROR("invalid 'tracer.sample_rate': 0.");
+            return false;
+        }
+    }
+    if (tracer_settings["ring_size"]) {
+        config.ring_size = tracer_settings["ring_size"].as<size_t>();
+    }
+    tracer_->Enable(config);
+    return true;
+}
+
+bool Million::LoadWatchdogSettings(const YAML::Node& settings) {
+    const auto& watchdog_settings = settings["watchdog"];
+    if (!watchdog_settings) {
+        return true;
+    }
+    if (watchdog_settings["enable"] && !watchdog_settings["enable"].as<bool>()) {
+        return true;
+    }
+    logger().LOG_INFO("load 'watchdog' settings.");
+    HandlerWatchdogConfig config;
+    if (watchdog_settings["budget_ms"]) {
+        config.budget_ms = watchdog_settings["budget_ms"].as<uint32_t>();
+    }
+    if (watchdog_settings["check_interval_ms"]) {
+        config.check_interval_ms = watchdog_settings["check_interval_ms"].as<uint32_t>();
+    }
+    if (config.budget_ms == 0 || config.check_interval_ms == 0) {
+        logger().LOG_ERROR("invalid 'watchdog' settings, budget_ms and check_interval_ms must be greater than 0.");
+        return false;
+    }
+    if (watchdog_settings["capture_stack"]) {
+        config.capture_stack = watchdog_settings["capture_stack"].as<bool>();
+#ifndef MILLION_STACK_TRACE
+        if (config.capture_stack) {
+            logger().LOG_WARN("'watchdog.capture_stack' requires MILLION_STACK_TRACE, stack will not be captured.");
+        }
+#endif
+    }
+    handler_watchdog_ = std::make_unique<HandlerWatchdog>(this, config);
+    metrics_->AddCollector([this](MetricsSnapshot* snapshot) {
+        handler_watchdog_->CollectMetrics(snapshot);
+    });
+    return true;
+}
+
+bool Million::LoadLockProfileSettings(const YAML::Node& settings) {
+    const auto& lock_profile_settings = settings["lock_profile"];
+    if (!lock_profile_settings) {
+        return true;
+    }
+    if (lock_profile_settings["enable"] && !lock_profile_settings["enable"].as<bool>()) {
+        return true;
+    }
+    logger().LOG_INFO("load 'lock_profile' settings.");
+    if (!kLockProfileEnabled) {
+        logger().LOG_WARN("'lock_profile' requires MILLION_LOCK_PROFILE, lock contention will not be recorded.");
+        return true;
+    }
+    if (!lock_profile_settings["log_interval_s"]) {
+        logger().LOG_ERROR("cannot find 'lock_profile.log_interval_s'.");
+        return false;
+    }
+    lock_profile_log_interval_s_ = lock_profile_settings["log_interval_s"].as<uint32_t>();
+    return true;
+}
+
+bool Million::LoadProtoArenaSettings(const YAML::Node& settings) {
+    const auto& proto_arena_settings = settings["proto_arena"];
+    if (!proto_arena_settings) {
+        return true;
+    }
+    if (proto_arena_settings["enable"] && !proto_arena_settings["enable"].as<bool>()) {
+        return true;
+    }
+    logger().LOG_INFO("load 'proto_arena' settings.");
+    ProtoArenaOptions options;
+    if (proto_arena_settings["block_size"]) {
+        options.block_size = proto_arena_settings["block_size"].as<size_t>();
+    }
+    if (proto_arena_settings["pool_size"]) {
+        options.pool_size = proto_arena_settings["pool_size"].as<size_t>();
+    }
+    if (options.block_size == 0) {
+        logger().LOG_ERROR("invalid 'proto_arena' settings, block_size must be greater than 0.");
+        return false;
+    }
+    ProtoArenaPool::SetOptions(options);
+    proto_mgr_->codec().set_arena_decode(true);
+    metrics_->RegisterCounter("million_proto_arena_created_total", "Protobuf arenas created because the per-thread arena pool was empty.", [] {
+        return static_cast<double>(ProtoArenaPool::created());
+    });
+    return true;
+}
+
+bool Million::LoadProtoPoolSettings(const YAML::Node& settings) {
+    const auto& proto_pool_settings = settings["proto_pool"];
+    if (!proto_pool_settings) {
+        return true;
+    }
+    if (proto_pool_settings["enable"] && !proto_pool_settings["enable"].as<bool>()) {
+        return true;
+    }
+    logger().LOG_INFO("load 'proto_pool' settings.");
+    ProtoMessagePoolOptions options;
+    if (proto_pool_settings["max_per_type"]) {
+        options.max_per_type = proto_pool_settings["max_per_type"].as<size_t>();
+    }
+    ProtoMgr::EnableMessagePool(options);
+    metrics_->RegisterCounter("million_proto_pool_reused_total", "Protobuf messages reused from the per-thread free lists.", [] {
+        return static_cast<double>(ProtoMgr::message_pool_reused());
+    });
+    return true;
+}
+
+void Million::StartLockProfileLog() {
+    lock_profile_log_thread_.emplace([this](std::stop_token st) {
+        std::mutex mutex;
+        std::condition_variable_any cv;
+        auto interval = std::chrono::seconds(lock_profile_log_interval_s_);
+        auto lock = std::unique_lock(mutex);
+        // 等待期间可被Stop打断，避免间隔较长时阻塞退出
+        while (!cv.wait_for(lock, st, interval, [] { return false; }) && !st.stop_requested()) {
+            auto profile = GetLockProfile();
+            if (profile.empty()) {
+                continue;
+            }
+            logger().LOG_INFO("lock profile:\n{}", FormatLockProfile(profile));
+        }
+    });
+}
+
+void Million::RegisterCoreMetrics() {
+    auto& metrics = *metrics_;
+    core_metric_ids_.msg_pushed = metrics.RegisterCounter("million_messages_pushed_total", "Messages pushed into service mailboxes.");
+    core_metric_ids_.msg_processed = metrics.RegisterCounter("million_messages_processed_total", "Messages processed by services.");
+    core_metric_ids_.msg_queue_wait_ns = metrics.RegisterHistogram("million_message_queue_wait_ns", "Time a message waited in the mailbox before processing.");
+    core_metric_ids_.msg_handle_ns = metrics.RegisterHistogram("million_message_handle_ns", "Time spent processing a message, until the handler finished or first suspended.");
+
+    metrics.RegisterGauge("million_service_queue_size", "Services waiting in the global service queue.", [this] {
+        return static_cast<double>(service_mgr_->service_queue_size());
+    });
+    metrics.RegisterGauge("million_timer_pending_tasks", "Pending tasks in the timer wheel.", [this] {
+        return static_cast<double>(timer_->size());
+    });
+    metrics.RegisterGauge("million_session_monitor_pending_sessions", "Pending sessions in the session timeout wheel.", [this] {
+        return static_cast<double>(session_monitor_->size());
+    });
+    metrics.RegisterCounter("million_log_dropped_total", "Log records dropped because the async log ring buffer was full.", [this] {
+        return static_cast<double>(logger().dropped());
+    });
+    metrics.RegisterCounter("million_log_suppressed_total", "Log records suppressed by per call site rate limiting.", [this] {
+        return static_cast<double>(logger().suppressed());
+    });
+
+    // 工作线程的累计忙碌时间，忙碌率即rate(million_worker_busy_seconds_total)
+    metrics.AddCollector([this](MetricsSnapshot* snapshot) {
+        for (size_t i = 0; i < worker_mgr_->worker_num(); ++i) {
+            MetricSample sample;
+            sample.name = "million_worker_busy_seconds_total";
+            sample.help = "Time the worker spent processing services.";
+            sample.type = MetricType::kCounter;
+            sample.labels = { { "worker", std::to_string(i) } };
+            sample.value = static_cast<double>(worker_mgr_->worker(i).busy_ns()) / 1e9;
+            snapshot->samples.emplace_back(std::move(sample));
+        }
+    });
+
+    // 负载均衡器的迁移次数，按源分片、目标分片及原因划分
+    metrics.AddCollector([this](MetricsSnapshot* snapshot) {
+        auto rebalancer = worker_mgr_->rebalancer();
+        if (!rebalancer) {
+            return;
+        }
+        for (auto& count : rebalancer->migration_counts()) {
+            MetricSample sample;
+            sample.name = "million_shard_migrations_total";
+            sample.help = "Services migrated between shards by the rebalancer.";
+            sample.type = MetricType::kCounter;
+            sample.labels = {
+                { "from_shard", std::to_string(count.from_shard) },
+                { "to_shard", std::to_string(count.to_shard) },
+                { "reason", MigrationReasonName(count.reason) },
+            };
+            sample.value = static_cast<double>(count.count);
+            snapshot->samples.emplace_back(std::move(sample));
+        }
+    });
+
+    // 各加锁位置的竞争统计，需以MILLION_LOCK_PROFILE编译
+    if constexpr (kLockProfileEnabled) {
+        metrics.AddCollector([](MetricsSnapshot* snapshot) {
+            auto add_sample = [snapshot](const char* name, const char* help, const std::string& site, double value) {
+                MetricSample sample;
+                sample.name = name;
+                sample.help = help;
+                sample.type = MetricType::kCounter;
+                sample.labels = { { "site", site } };
+                sample.value = value;
+                snapshot->samples.emplace_back(std::move(sample));
+            };
+            for (auto& stats : GetLockProfile()) {
+                add_sample("million_lock_acquisitions_total", "Lock acquisitions, by lock site.", stats.name, static_cast<double>(stats.acquisitions));
+                add_sample("million_lock_contentions_total", "Lock acquisitions that had to wait, by lock site.", stats.name, static_cast<double>(stats.contentions));
+                add_sample("million_lock_wait_seconds_total", "Time spent waiting for contended locks, by lock site.", stats.name, static_cast<double>(stats.wait_ns) / 1e9);
+            }
+        });
+    }
+
+    // 按服务划分的指标，读取时遍历所有服务生成
+    metrics.AddCollector([this](MetricsSnapshot* snapshot) {
+        auto add_sample = [snapshot](const char* name, const char* help, MetricType type, const MetricLabels& labels, double value) {
+            MetricSample sample;
+            sample.name = name;
+            sample.help = help;
+            sample.type = type;
+            sample.labels = labels;
+            sample.value = value;
+            snapshot->samples.emplace_back(std::move(sample));
+        };
+        service_mgr_->ForeachService([&](const ServiceShared& service) {
+            auto stats = service->GetMailboxStats();
+            MetricLabels labels = {
+                { "service_id", std::to_string(service->service_id()) },
+                { "service_type", typeid(service->iservice()).name() },
+            };
+            add_sample("million_service_mailbox_size", "Messages in the service mailbox.", MetricType::kGauge, labels, static_cast<double>(stats.size));
+            if (stats.capacity != kMailboxUnbounded) {
+                // 仅对限制了容量的邮箱有意义，可与容量对比
+                add_sample("million_service_mailbox_high_water_mark", "Max messages ever in the bounded service mailbox.", MetricType::kGauge, labels, static_cast<double>(stats.high_water_mark));
+                add_sample("million_service_mailbox_capacity", "Capacity of the bounded service mailbox.", MetricType::kGauge, labels, static_cast<double>(stats.capacity));
+            }
+            add_sample("million_service_mailbox_rejected_total", "Messages rejected because the mailbox was full.", MetricType::kCounter, labels, static_cast<double>(stats.rejected_count));
+            add_sample("million_service_mailbox_suspended_total", "Sends suspended because the mailbox was full, retries included.", MetricType::kCounter, labels, static_cast<double>(stats.suspended_count));
+            add_sample("million_service_mailbox_dropped_total", "Messages dropped because the mailbox was full.", MetricType::kCounter, labels, static_cast<double>(stats.dropped_count));
+            add_sample("million_service_mailbox_shed_total", "Requests shed because their deadline had passed.", MetricType::kCounter, labels, static_cast<double>(stats.shed_count));
+            add_sample("million_service_processed_total", "Messages processed by the service.", MetricType::kCounter, labels, static_cast<double>(service->processed_count()));
+            if (worker_mgr_->rebalancer()) {
+                // 处理耗时仅在开启负载均衡时统计
+                add_sample("million_service_busy_seconds_total", "Time spent processing messages.", MetricType::kCounter, labels, static_cast<double>(service->busy_ns()) / 1e9);
+            }
+            add_sample("million_service_suspended_tasks", "Suspended coroutine tasks of the service.", MetricType::kGauge, labels, static_cast<double>(service->task_count()));
+        });
+    });
+}
+
 } //namespace million
\ No newline at end of file
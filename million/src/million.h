@@ -3,11 +3,22 @@
 #include <cstdint>
 
 #include <memory>
+#include <optional>
+#include <thread>
 
 #include <million/imillion.h>
+#include <million/metrics.h>
 
 namespace million {
 
+// 框架内置埋点使用的指标
+struct CoreMetricIds {
+    MetricId msg_pushed = kMetricIdInvalid;
+    MetricId msg_processed = kMetricIdInvalid;
+    MetricId msg_queue_wait_ns = kMetricIdInvalid;
+    MetricId msg_handle_ns = kMetricIdInvalid;
+};
+
 class SeataSnowflake;
 class ServiceMgr;
 class SessionMgr;
@@ -18,6 +29,9 @@ class WorkerMgr;
 class IoContextMgr;
 class Timer;
 class Logger;
+class MetricsHttpServer;
+class Tracer;
+class HandlerWatchdog;
 class Million {
 public:
     Million(IMillion* imillion);
@@ -27,7 +41,7 @@ public:
     void Start();
     void Stop();
 
-    std::optional<ServiceShared> AddService(std::unique_ptr<IService> iservice);
+    std::optional<ServiceShared> AddService(std::unique_ptr<IService> iservice, std::optional<size_t> shard_id = std::nullopt);
 
     std::optional<SessionId> StartService(const ServiceShared& service, MessagePointer with_msg);
     std::optional<SessionId> StopService(const ServiceShared& service, MessagePointer with_msg);
@@ -39,13 +53,19 @@ public:
 
     SessionId NewSession();
 
-    bool SendTo(const ServiceShared& sender, const ServiceShared& target, SessionId session_id, MessagePointer msg);
-    std::optional<SessionId> Send(const ServiceShared& sender, const ServiceShared& target, MessagePointer msg);
+    bool SendTo(const ServiceShared& sender, const ServiceShared& target, SessionId session_id, MessagePointer msg, SessionDeadline deadline = kSessionDeadlineNone);
+    std::optional<SessionId> Send(const ServiceShared& sender, const ServiceShared& target, MessagePointer msg, SessionDeadline deadline = kSessionDeadlineNone);
+    MailboxPushResult TrySendTo(const ServiceShared& sender, const ServiceShared& target, SessionId session_id, MessagePointer& msg);
+    bool WaitMailboxWritable(const ServiceShared& waiter, const ServiceShared& target, SessionId wait_session_id);
 
     const YAML::Node& YamlSettings() const;
     void Timeout(uint32_t tick, const ServiceShared& service, MessagePointer msg);
     asio::io_context& NextIoContext();
     void EnableSeparateWorker(const ServiceShared& service);
+    void EnableDirectDispatch(const ServiceShared& service);
+    void EnablePriorityLanes(const ServiceShared& service, bool enable);
+    void SetMailboxCapacity(const ServiceShared& service, size_t capacity, MailboxFullPolicy policy);
+    MailboxStats GetMailboxStats(const ServiceShared& service);
 
     auto& imillion() { assert(imillion_); return *imillion_; }
     auto& node_id() { return node_id_; }
@@ -55,10 +75,27 @@ public:
     auto& session_monitor() { assert(session_monitor_); return *session_monitor_; }
     auto& logger() { assert(logger_); return *logger_; }
     auto& proto_mgr() { assert(proto_mgr_); return *proto_mgr_; }
+    auto& cpp_codec() { assert(cpp_codec_); return *cpp_codec_; }
     auto& module_mgr() { assert(module_mgr_); return *module_mgr_; }
     auto& worker_mgr() { assert(worker_mgr_); return *worker_mgr_; }
     auto& io_context_mgr() { assert(io_context_mgr_); return *io_context_mgr_; }
     auto& timer() { assert(timer_); return *timer_; }
+    auto& metrics() { assert(metrics_); return *metrics_; }
+    auto& core_metric_ids() const { return core_metric_ids_; }
+    auto& metrics_service() const { return metrics_service_; }
+    auto& tracer() { assert(tracer_); return *tracer_; }
+    /** 未开启看门狗时返回nullptr */
+    HandlerWatchdog* handler_watchdog() { return handler_watchdog_.get(); }
+
+private:
+    void RegisterCoreMetrics();
+    bool LoadMetricsSettings(const YAML::Node& settings);
+    bool LoadTracerSettings(const YAML::Node& settings);
+    bool LoadWatchdogSettings(const YAML::Node& settings);
+    bool LoadLockProfileSettings(const YAML::Node& settings);
+    bool LoadProtoArenaSettings(const YAML::Node& settings);
+    bool LoadProtoPoolSettings(const YAML::Node& settings);
+    void StartLockProfileLog();
 
 private:
     IMillion* imillion_;
@@ -79,11 +116,24 @@ private:
     std::unique_ptr<SessionMonitor> session_monitor_;
     std::unique_ptr<Logger> logger_;
     std::unique_ptr<ProtoMgr> proto_mgr_;
+    std::unique_ptr<CppMessageCodec> cpp_codec_;
     std::unique_ptr<ModuleMgr> module_mgr_;
     std::unique_ptr<WorkerMgr> worker_mgr_;
     std::unique_ptr<IoContextMgr> io_context_mgr_;
     std::unique_ptr<Timer> timer_;
     std::unique_ptr<SeataSnowflake> seata_snowflake_;
+
+    std::unique_ptr<MetricsRegistry> metrics_;
+    CoreMetricIds core_metric_ids_;
+    std::optional<ServiceHandle> metrics_service_;
+    std::unique_ptr<MetricsHttpServer> metrics_http_server_;
+
+    std::unique_ptr<Tracer> tracer_;
+    std::unique_ptr<HandlerWatchdog> handler_watchdog_;
+
+    // 定期将锁竞争统计输出到日志，0表示不输出
+    uint32_t lock_profile_log_interval_s_ = 0;
+    std::optional<std::jthread> lock_profile_log_thread_;
 };
 
 } // namespace million
\ No newline at end of file
@@ -4,6 +4,10 @@
 namespace million {
 namespace net {
 
+// 回收的缓冲区数量及单个缓冲区容量的上限，避免突发的大包长期占用内存
+constexpr size_t kPacketPoolMaxCount = 32;
+constexpr size_t kPacketPoolMaxCapacity = 1024 * 64;
+
 TcpConnection::TcpConnection(
     TcpServer* server,
     asio::ip::tcp::socket&& socket,
@@ -115,10 +119,17 @@ void TcpConnection::Send(Packet&& packet, PacketSpan span, uint32_t total_size)
     auto self = shared_from_this();
     asio::co_spawn(executor_, [self = std::move(self)]() -> asio::awaitable<void> {
         std::queue<SendPacket> tmp_queue;
+        std::vector<Packet> sent_packets;
         try { 
             do {
                 {
                     auto lock = std::lock_guard(self->send_queue_mutex_);
+                    for (auto& sent_packet : sent_packets) {
+                        if (self->packet_pool_.size() >= kPacketPoolMaxCount) break;
+                        if (sent_packet.capacity() == 0 || sent_packet.capacity() > kPacketPoolMaxCapacity) continue;
+                        self->packet_pool_.emplace_back(std::move(sent_packet));
+                    }
+                    sent_packets.clear();
                     if (self->send_queue_.empty()) {
                         self->sending_ = false;
                         break;
@@ -133,6 +144,7 @@ void TcpConnection::Send(Packet&& packet, PacketSpan span, uint32_t total_size)
                         co_await asio::async_write(self->socket_, asio::buffer(&len, sizeof(len)), asio::use_awaitable);
                     }
                     co_await asio::async_write(self->socket_, asio::buffer(packet.span.data(), packet.span.size()), asio::use_awaitable);
+                    sent_packets.emplace_back(std::move(packet.packet));
                     tmp_queue.pop();
                 }
             } while (true);
@@ -144,6 +156,19 @@ void TcpConnection::Send(Packet&& packet, PacketSpan span, uint32_t total_size)
     }, asio::detached);
 }
 
+Packet TcpConnection::AcquirePacket(size_t size) {
+    Packet packet;
+    {
+        auto lock = std::lock_guard(send_queue_mutex_);
+        if (!packet_pool_.empty()) {
+            packet = std::move(packet_pool_.back());
+            packet_pool_.pop_back();
+        }
+    }
+    packet.resize(size);
+    return packet;
+}
+
 bool TcpConnection::Connected() const {
     return socket_.is_open();
 }
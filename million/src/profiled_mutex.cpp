@@ -0,0 +1,85 @@
+#include <million/profiled_mutex.h>
+
+#include <algorithm>
+#include <format>
+#include <map>
+#include <memory>
+
+namespace million {
+
+struct LockSiteRegistry {
+    std::mutex mutex;
+    std::map<std::string, std::unique_ptr<LockSite>, std::less<>> sites;
+};
+
+static LockSiteRegistry& GetLockSiteRegistry() {
+    // 不析构，避免静态对象析构顺序导致退出时访问已释放的统计
+    static auto registry = new LockSiteRegistry();
+    return *registry;
+}
+
+LockSite* LockSite::Get(std::string_view name) {
+    auto& registry = GetLockSiteRegistry();
+    auto lock = std::lock_guard(registry.mutex);
+    auto iter = registry.sites.find(name);
+    if (iter != registry.sites.end()) {
+        return iter->second.get();
+    }
+    auto res = registry.sites.emplace(std::string(name), std::make_unique<LockSite>(std::string(name)));
+    return res.first->second.get();
+}
+
+LockSiteStats LockSite::stats() const {
+    LockSiteStats stats;
+    stats.name = name_;
+    stats.acquisitions = acquisitions_.load(std::memory_order_relaxed);
+    stats.contentions = contentions_.load(std::memory_order_relaxed);
+    stats.wait_ns = wait_ns_.load(std::memory_order_relaxed);
+    stats.max_wait_ns = max_wait_ns_.load(std::memory_order_relaxed);
+    return stats;
+}
+
+void LockSite::Reset() {
+    acquisitions_.store(0, std::memory_order_relaxed);
+    contentions_.store(0, std::memory_order_relaxed);
+    wait_ns_.store(0, std::memory_order_relaxed);
+    max_wait_ns_.store(0, std::memory_order_relaxed);
+}
+
+std::vector<LockSiteStats> GetLockProfile() {
+    std::vector<LockSiteStats> profile;
+    {
+        auto& registry = GetLockSiteRegistry();
+        auto lock = std::lock_guard(registry.mutex);
+        profile.reserve(registry.sites.size());
+        for (auto& [name, site] : registry.sites) {
+            profile.emplace_back(site->stats());
+        }
+    }
+    std::sort(profile.begin(), profile.end(), [](const LockSiteStats& a, const LockSiteStats& b) {
+        return a.wait_ns > b.wait_ns;
+    });
+    return profile;
+}
+
+std::string FormatLockProfile(const std::vector<LockSiteStats>& profile) {
+    std::string out = std::format("{:<40} {:>14} {:>12} {:>8} {:>14} {:>12} {:>12}\n",
+        "site", "acquisitions", "contentions", "ratio", "wait_total_us", "wait_avg_ns", "wait_max_us");
+    for (auto& stats : profile) {
+        auto ratio = stats.acquisitions ? static_cast<double>(stats.contentions) / stats.acquisitions : 0.0;
+        auto avg_ns = stats.contentions ? stats.wait_ns / stats.contentions : 0;
+        out += std::format("{:<40} {:>14} {:>12} {:>7.2f}% {:>14} {:>12} {:>12}\n",
+            stats.name, stats.acquisitions, stats.contentions, ratio * 100, stats.wait_ns / 1000, avg_ns, stats.max_wait_ns / 1000);
+    }
+    return out;
+}
+
+void ResetLockProfile() {
+    auto& registry = GetLockSiteRegistry();
+    auto lock = std::lock_guard(registry.mutex);
+    for (auto& [name, site] : registry.sites) {
+        site->Reset();
+    }
+}
+
+} // namespace million
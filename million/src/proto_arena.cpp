@@ -0,0 +1,82 @@
+#include <million/proto_arena.h>
+
+#include <atomic>
+#include <vector>
+
+namespace million {
+
+// Arena及其初始块，初始块需在Arena之后析构
+struct ProtoArenaBlock {
+    explicit ProtoArenaBlock(size_t block_size)
+        : block(new char[block_size])
+        , arena(MakeOptions(block.get(), block_size)) {}
+
+    static protobuf::ArenaOptions MakeOptions(char* block, size_t block_size) {
+        protobuf::ArenaOptions options;
+        options.initial_block = block;
+        options.initial_block_size = block_size;
+        options.start_block_size = block_size;
+        return options;
+    }
+
+    std::unique_ptr<char[]> block;
+    protobuf::Arena arena;
+};
+
+static ProtoArenaOptions g_options;
+static std::atomic<uint64_t> g_created = 0;
+
+// 线程退出后仍可能有消息在该线程上释放，此时直接销毁
+struct ProtoArenaLocalPool {
+    ~ProtoArenaLocalPool() {
+        destroyed = true;
+    }
+
+    std::vector<std::unique_ptr<ProtoArenaBlock>> blocks;
+    bool destroyed = false;
+};
+
+static thread_local ProtoArenaLocalPool t_pool;
+
+static void ReleaseArenaBlock(ProtoArenaBlock* block) {
+    auto holder = std::unique_ptr<ProtoArenaBlock>(block);
+    if (t_pool.destroyed || t_pool.blocks.size() >= g_options.pool_size) {
+        return;
+    }
+    holder->arena.Reset();
+    t_pool.blocks.emplace_back(std::move(holder));
+}
+
+void ProtoArenaPool::SetOptions(const ProtoArenaOptions& options) {
+    g_options = options;
+}
+
+std::shared_ptr<protobuf::Arena> ProtoArenaPool::Acquire() {
+    std::unique_ptr<ProtoArenaBlock> block;
+    if (!t_pool.destroyed && !t_pool.blocks.empty()) {
+        block = std::move(t_pool.blocks.back());
+        t_pool.blocks.pop_back();
+    }
+    else {
+        block = std::make_unique<ProtoArenaBlock>(g_options.block_size);
+        g_created.fetch_add(1, std::memory_order_relaxed);
+    }
+    auto arena = &block->arena;
+    auto holder = std::shared_ptr<ProtoArenaBlock>(block.release(), &ReleaseArenaBlock);
+    return std::shared_ptr<protobuf::Arena>(std::move(holder), arena);
+}
+
+ProtoMessageArena ProtoArenaPool::NewMessage(const ProtoMessage& prototype) {
+    auto arena = Acquire();
+    auto msg = prototype.New(arena.get());
+    if (!msg) {
+        return nullptr;
+    }
+    return ProtoMessageArena(std::shared_ptr<ProtoMessage>(std::move(arena), msg));
+}
+
+uint64_t ProtoArenaPool::created() {
+    return g_created.load(std::memory_order_relaxed);
+}
+
+} // namespace million
@@ -1,6 +1,10 @@
 #include <million/proto_codec.h>
 
+#include <algorithm>
+#include <limits>
+
 #include <million/proto_mgr.h>
+#include <million/proto_arena.h>
 
 namespace million {
 
@@ -11,20 +15,29 @@ std::optional<std::pair<ModuleId, ProtoMessageId>> ProtoCodec::FindMessageId(con
 }
 
 std::optional<net::Packet> ProtoCodec::EncodeMessage(const protobuf::Message& message) const {
+    auto byte_size = message.ByteSizeLong();
+    auto packet = net::Packet(EncodedSize(byte_size));
+    if (!EncodeMessageTo(message, byte_size, packet.data())) {
+        return std::nullopt;
+    }
+    return packet;
+}
+
+bool ProtoCodec::EncodeMessageTo(const protobuf::Message& message, size_t byte_size, uint8_t* buffer) const {
     auto desc = message.GetDescriptor();
     auto msg_key_opt = FindMessageKey(desc);
     if (!msg_key_opt) {
-        return std::nullopt;
+        return false;
     }
-    
+
     auto msg_key = host_to_network_u32(*msg_key_opt);
-    auto packet = net::Packet(sizeof(msg_key) + message.ByteSize());
     size_t i = 0;
-    std::memcpy(packet.data() + i, &msg_key, sizeof(msg_key));
+    std::memcpy(buffer + i, &msg_key, sizeof(msg_key));
     i += sizeof(msg_key);
 
-    message.SerializeToArray(packet.data() + i, message.ByteSize());
-    return packet;
+    // 使用ByteSizeLong缓存的大小，避免再次遍历消息
+    auto end = message.SerializeWithCachedSizesToArray(buffer + i);
+    return static_cast<size_t>(end - (buffer + i)) == byte_size;
 }
 
 
@@ -45,13 +58,34 @@ std::optional<ProtoCodec::DecodeRes> ProtoCodec::DecodeMessage(net::PacketSpan p
     res.module_id = module_id;
     res.msg_id = msg_id;
 
-    auto msg_opt = NewMessage(res.module_id, res.msg_id);
-    if (!msg_opt) {
+    auto desc = FindMessageDesc(res.module_id, res.msg_id);
+    if (!desc) {
         return std::nullopt;
     }
-    res.msg = std::move(*msg_opt);
 
-    auto success = res.msg->ParseFromArray(packet.data() + i, packet.size() - i);
+    ProtoMessage* msg = nullptr;
+    if (arena_decode_) {
+        auto prototype = proto_mgr_.GetPrototype(*desc);
+        if (!prototype) {
+            return std::nullopt;
+        }
+        auto arena_msg = ProtoArenaPool::NewMessage(*prototype);
+        if (!arena_msg) {
+            return std::nullopt;
+        }
+        msg = arena_msg.get();
+        res.msg = std::move(arena_msg);
+    }
+    else {
+        auto heap_msg = proto_mgr_.NewMessage(*desc);
+        if (!heap_msg) {
+            return std::nullopt;
+        }
+        msg = heap_msg.get();
+        res.msg = std::move(heap_msg);
+    }
+
+    auto success = msg->ParseFromArray(packet.data() + i, packet.size() - i);
     if (!success) {
         return std::nullopt;
     }
@@ -59,29 +93,59 @@ std::optional<ProtoCodec::DecodeRes> ProtoCodec::DecodeMessage(net::PacketSpan p
 }
 
 
+bool ProtoCodec::RegisterIdTable(std::string_view proto_file_name, uint32_t module_id, std::span<const ProtoMessageIdEntry> msg_ids) {
+    if (module_id == kModuleIdInvalid || module_id > std::numeric_limits<ModuleId>::max()) {
+        return false;
+    }
+    auto file_desc = proto_mgr_.FindFileByName(std::string(proto_file_name));
+    if (!file_desc) {
+        return false;
+    }
+    for (const auto& [index, msg_id] : msg_ids) {
+        if (index < 0 || index >= file_desc->message_type_count() || msg_id > std::numeric_limits<ProtoMessageId>::max()) {
+            return false;
+        }
+        AddMessage(static_cast<ModuleId>(module_id), static_cast<ProtoMessageId>(msg_id), file_desc->message_type(index));
+    }
+    return true;
+}
+
 const protobuf::Descriptor* ProtoCodec::FindMessageDesc(ModuleId module_id, ProtoMessageId msg_id) const {
-    auto key = EncodeModuleCode(module_id, msg_id);
-    auto iter = msg_desc_map_.find(key);
-    if (iter == msg_desc_map_.end()) return nullptr;
-    return iter->second;
+    if (module_id >= msg_desc_table_.size()) return nullptr;
+    const auto& module_table = msg_desc_table_[module_id];
+    if (msg_id >= module_table.size()) return nullptr;
+    return module_table[msg_id];
 }
 
 std::optional<ProtoMessageKey> ProtoCodec::FindMessageKey(const protobuf::Descriptor* desc) const {
-    auto iter = msg_id_map_.find(desc);
-    if (iter == msg_id_map_.end()) return std::nullopt;
+    auto iter = std::lower_bound(msg_key_table_.begin(), msg_key_table_.end(), desc, [](const auto& entry, const protobuf::Descriptor* desc) {
+        return entry.first < desc;
+    });
+    if (iter == msg_key_table_.end() || iter->first != desc) return std::nullopt;
     return iter->second;
 }
 
-std::optional<ProtoMessageUnique> ProtoCodec::NewMessage(ModuleId module_id, ProtoMessageId msg_id) const {
-    auto desc = FindMessageDesc(module_id, msg_id);
-    if (!desc) {
-        return std::nullopt;
+void ProtoCodec::AddMessage(ModuleId module_id, ProtoMessageId msg_id, const protobuf::Descriptor* desc) {
+    if (module_id == kModuleIdInvalid || msg_id == kProtoMessageIdInvalid) {
+        return;
     }
-    auto msg = proto_mgr_.NewMessage(*desc);
-    if (!msg) {
-        return std::nullopt;
+    if (module_id >= msg_desc_table_.size()) {
+        msg_desc_table_.resize(module_id + 1);
+    }
+    auto& module_table = msg_desc_table_[module_id];
+    if (msg_id >= module_table.size()) {
+        module_table.resize(msg_id + 1, nullptr);
+    }
+    if (!module_table[msg_id]) {
+        module_table[msg_id] = desc;
+    }
+
+    auto iter = std::lower_bound(msg_key_table_.begin(), msg_key_table_.end(), desc, [](const auto& entry, const protobuf::Descriptor* desc) {
+        return entry.first < desc;
+    });
+    if (iter == msg_key_table_.end() || iter->first != desc) {
+        msg_key_table_.emplace(iter, desc, EncodeModuleCode(module_id, msg_id));
     }
-    return msg;
 }
 
 uint32_t ProtoCodec::host_to_network_u32(uint32_t value) const {
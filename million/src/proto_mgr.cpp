@@ -1,25 +1,67 @@
 #include <million/proto_mgr.h>
 
+#include <atomic>
+#include <unordered_map>
+#include <vector>
+
 namespace million {
 
+static bool g_msg_pool_enabled = false;
+static ProtoMessagePoolOptions g_msg_pool_options;
+static std::atomic<uint64_t> g_msg_pool_reused = 0;
+
+// 每个线程按Descriptor的空闲链表，线程退出后释放的消息直接delete
+struct ProtoMessageLocalPool {
+    ~ProtoMessageLocalPool() {
+        destroyed = true;
+        for (auto& [desc, msgs] : free_lists) {
+            for (auto msg : msgs) {
+                delete msg;
+            }
+        }
+    }
+
+    std::unordered_map<const protobuf::Descriptor*, std::vector<ProtoMessage*>> free_lists;
+    bool destroyed = false;
+};
+
+static thread_local ProtoMessageLocalPool t_msg_pool;
+
+void ProtoMessageDeleter::operator()(ProtoMessage* msg) const {
+    if (!g_msg_pool_enabled || t_msg_pool.destroyed) {
+        delete msg;
+        return;
+    }
+    auto& msgs = t_msg_pool.free_lists[msg->GetDescriptor()];
+    if (msgs.size() >= g_msg_pool_options.max_per_type) {
+        delete msg;
+        return;
+    }
+    msg->Clear();
+    msgs.emplace_back(msg);
+}
+
+ProtoMessageUnique NewProtoMessage(const ProtoMessage& prototype) {
+    if (g_msg_pool_enabled && !t_msg_pool.destroyed) {
+        auto iter = t_msg_pool.free_lists.find(prototype.GetDescriptor());
+        if (iter != t_msg_pool.free_lists.end() && !iter->second.empty()) {
+            auto msg = iter->second.back();
+            iter->second.pop_back();
+            g_msg_pool_reused.fetch_add(1, std::memory_order_relaxed);
+            return ProtoMessageUnique(msg);
+        }
+    }
+    return ProtoMessageUnique(prototype.New());
+}
+
 ProtoMgr::ProtoMgr()
     : codec_(*this) {}
 
 void ProtoMgr::Init() {
-    // 目前无意义，调试用，protogen dll可能延迟加载，所以这里没有定义属于正常现象
+    // 描述符按需构建，generated_pool在首次按名称查找或访问消息的descriptor()时才构建对应文件
     // 保证所有使用protobuf的模块，都通过dll加载同一个protobuf
     // 即可确保google::protobuf::DescriptorPool::generated_pool()等接口获取的都是同一个对象
-    std::vector<std::string> file_names;
-    desc_db().FindAllFileNames(&file_names);
-    for (const std::string& file_name : file_names) {
-        const protobuf::FileDescriptor* file_desc = desc_pool().FindFileByName(file_name);
-    }
-
-    std::vector<std::string> msg_names;
-    desc_db().FindAllMessageNames(&msg_names);
-    for (const std::string& msg_name : msg_names) {
-        const protobuf::Descriptor* desc = desc_pool().FindMessageTypeByName(msg_name);
-    }
+    desc_pool();
 }
 
 const google::protobuf::DescriptorPool& ProtoMgr::desc_pool() {
@@ -27,11 +69,6 @@ const google::protobuf::DescriptorPool& ProtoMgr::desc_pool() {
     return *desc_pool;
 }
 
-google::protobuf::DescriptorDatabase& ProtoMgr::desc_db() {
-    static auto desc_db = desc_pool().internal_generated_database();
-    return *desc_db;
-}
-
 google::protobuf::MessageFactory& ProtoMgr::msg_factory() {
     static auto msg_factory = google::protobuf::MessageFactory::generated_factory();
     return *msg_factory;
@@ -81,7 +118,16 @@ const google::protobuf::Message* ProtoMgr::GetPrototype(const google::protobuf::
 ProtoMessageUnique ProtoMgr::NewMessage(const google::protobuf::Descriptor& desc) const {
     auto prototype = GetPrototype(desc);
     if (!prototype) return nullptr;
-    return ProtoMessageUnique(prototype->New());
+    return NewProtoMessage(*prototype);
+}
+
+void ProtoMgr::EnableMessagePool(const ProtoMessagePoolOptions& options) {
+    g_msg_pool_options = options;
+    g_msg_pool_enabled = true;
+}
+
+uint64_t ProtoMgr::message_pool_reused() {
+    return g_msg_pool_reused.load(std::memory_order_relaxed);
 }
 
 } // namespace million
\ No newline at end of file
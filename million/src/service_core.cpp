@@ -1,15 +1,32 @@
 #include "service_core.h"
 
 #include <cassert>
+#include <chrono>
+#include <algorithm>
+#include <iterator>
+#include <utility>
+#include <typeinfo>
 
 #include <million/iservice.h>
+#include <million/metrics.h>
 
 #include "million.h"
 #include "service_mgr.h"
 #include "session_monitor.h"
+#include "tracer.h"
+#include "worker.h"
+#include "worker_mgr.h"
 
 namespace million {
 
+static thread_local ServiceCore* tls_current_service = nullptr;
+// 当前ProcessMsgs中，直接调用嵌套处理其他服务消息的耗时
+static thread_local uint64_t tls_nested_busy_ns = 0;
+
+ServiceCore* ServiceCore::current() {
+    return tls_current_service;
+}
+
 ServiceCore::ServiceCore(ServiceMgr* service_mgr, std::unique_ptr<IService> iservice)
     : service_mgr_(service_mgr)
     , iservice_(std::move(iservice))
@@ -18,30 +35,183 @@ ServiceCore::ServiceCore(ServiceMgr* service_mgr, std::unique_ptr<IService> iser
 ServiceCore::~ServiceCore() = default;
 
 
-bool ServiceCore::PushMsg(const ServiceShared& sender, SessionId session_id, MessagePointer msg) {
+MailboxPushResult ServiceCore::PushMsg(const ServiceShared& sender, SessionId session_id, MessagePointer& msg, SessionDeadline deadline) {
     assert(msg);
     {
         auto lock = std::lock_guard(msgs_mutex_);
         if (!IsReady() && !IsStarting() && !IsRunning() && !msg.IsType<ServiceExitMsg>()) {
-            return false;
+            return MailboxPushResult::kClosed;
+        }
+        bool bounded = MsgIsBounded(session_id, msg);
+        if (bounded && MailboxIsFullWithLock()) {
+            if (mailbox_full_policy_ == MailboxFullPolicy::kReject) {
+                ++mailbox_rejected_count_;
+                return MailboxPushResult::kFull;
+            }
+            if (mailbox_full_policy_ == MailboxFullPolicy::kSuspend) {
+                // 同一条消息挂起后会重试，单独计数，不计入拒绝数
+                ++mailbox_suspended_count_;
+                return MailboxPushResult::kWouldBlock;
+            }
+            // 丢弃最旧的一条请求消息，回复及控制类消息不丢弃
+            auto iter = std::find_if(msgs_.begin(), msgs_.end(), [this](const MessageElementWithStrongSender& ele) {
+                return MsgIsBounded(ele.session_id(), ele.message());
+            });
+            if (iter == msgs_.end()) {
+                ++mailbox_rejected_count_;
+                return MailboxPushResult::kFull;
+            }
+            msgs_.erase(iter);
+            --bounded_msg_count_;
+            ++mailbox_dropped_count_;
+        }
+        if (bounded) {
+            ++bounded_msg_count_;
+        }
+        bool high_priority = priority_lanes_ && !bounded;
+        auto ele = MessageElementWithStrongSender(sender, session_id, std::move(msg), deadline);
+        if constexpr (kMetricsEnabled) {
+            ele.set_enqueue_ns(MetricsNowNs());
+        }
+        auto& tracer = service_mgr_->million().tracer();
+        if (tracer.enabled()) {
+            // 沿用发送方正在处理的消息所属的链路，否则以本次会话开始新链路
+            auto context = Tracer::active_context();
+            if (!context.valid()) {
+                auto send_id = SessionReplyToSendId(session_id);
+                context = TraceContext{ send_id, kSpanIdInvalid, kSpanIdInvalid, tracer.IsSampled(send_id) };
+            }
+            ele.set_trace_context(context);
+            if (context.sampled) {
+                auto type = SessionIsReplyId(session_id) ? TraceEventType::kReply : TraceEventType::kSend;
+                tracer.Record(type, session_id, sender ? sender->service_id() : 0, service_id_, context, ele.message());
+            }
+        }
+        if (high_priority) {
+            high_msgs_.emplace_back(std::move(ele));
+        }
+        else {
+            msgs_.emplace_back(std::move(ele));
+        }
+        auto size = msgs_.size() + high_msgs_.size();
+        if (size > mailbox_high_water_mark_) {
+            mailbox_high_water_mark_ = size;
         }
-        auto ele = MessageElementWithStrongSender(sender, session_id, std::move(msg));
-        msgs_.emplace(std::move(ele));
+    }
+    if constexpr (kMetricsEnabled) {
+        auto& million = service_mgr_->million();
+        million.metrics().Add(million.core_metric_ids().msg_pushed);
     }
     if (HasSeparateWorker()) {
         separate_worker_->cv.notify_one();
     }
-    return true;
+    return MailboxPushResult::kSuccess;
 }
 
 std::optional<MessageElementWithStrongSender> ServiceCore::PopMsg() {
-    auto lock = std::lock_guard(msgs_mutex_);
-    return PopMsgWithLock();
+    std::optional<MessageElementWithStrongSender> msg;
+    std::vector<MailboxWaiter> waiters;
+    {
+        auto lock = std::lock_guard(msgs_mutex_);
+        msg = PopMsgWithLock();
+        if (msg) {
+            waiters = TakeMailboxWaitersWithLock(1);
+        }
+    }
+    WakeUpMailboxWaiters(std::move(waiters));
+    return msg;
 }
 
 bool ServiceCore::MsgQueueIsEmpty() {
     std::lock_guard guard(msgs_mutex_);
-    return msgs_.empty();
+    return msgs_.empty() && high_msgs_.empty();
+}
+
+void ServiceCore::EnablePriorityLanes(bool enable) {
+    auto lock = std::lock_guard(msgs_mutex_);
+    if (priority_lanes_ == enable) {
+        return;
+    }
+    priority_lanes_ = enable;
+    if (!enable) {
+        // 高优先级通道中的消息合并回普通队列头部，保持原有的先后顺序
+        msgs_.insert(msgs_.begin(), std::make_move_iterator(high_msgs_.begin()), std::make_move_iterator(high_msgs_.end()));
+        high_msgs_.clear();
+    }
+}
+
+void ServiceCore::SetMailboxCapacity(size_t capacity, MailboxFullPolicy policy) {
+    std::vector<MailboxWaiter> waiters;
+    {
+        auto lock = std::lock_guard(msgs_mutex_);
+        mailbox_capacity_ = capacity;
+        mailbox_full_policy_ = policy;
+        // 扩容后可能已有空位，按空位数唤醒
+        size_t free_count = mailbox_waiters_.size();
+        if (capacity != kMailboxUnbounded) {
+            free_count = capacity > bounded_msg_count_ ? capacity - bounded_msg_count_ : 0;
+        }
+        waiters = TakeMailboxWaitersWithLock(free_count);
+    }
+    WakeUpMailboxWaiters(std::move(waiters));
+}
+
+MailboxStats ServiceCore::GetMailboxStats() {
+    auto lock = std::lock_guard(msgs_mutex_);
+    MailboxStats stats;
+    stats.size = msgs_.size() + high_msgs_.size();
+    stats.capacity = mailbox_capacity_;
+    stats.policy = mailbox_full_policy_;
+    stats.high_water_mark = mailbox_high_water_mark_;
+    stats.rejected_count = mailbox_rejected_count_;
+    stats.suspended_count = mailbox_suspended_count_;
+    stats.dropped_count = mailbox_dropped_count_;
+    stats.shed_count = shed_count_.load(std::memory_order_relaxed);
+    return stats;
+}
+
+bool ServiceCore::AddMailboxWaiter(const ServiceShared& waiter, SessionId wait_session_id) {
+    auto lock = std::lock_guard(msgs_mutex_);
+    if (!MailboxIsFullWithLock()) {
+        return false;
+    }
+    mailbox_waiters_.emplace_back(MailboxWaiter{ waiter, wait_session_id });
+    return true;
+}
+
+bool ServiceCore::MsgIsBounded(SessionId session_id, const MessagePointer& msg) const {
+    if (!SessionIsSendId(session_id)) {
+        return false;
+    }
+    if (msg.IsType<ServiceStartMsg>() || msg.IsType<ServiceStopMsg>() || msg.IsType<ServiceExitMsg>()
+        || msg.IsType<SessionTimeoutMsg>()) {
+        return false;
+    }
+    return true;
+}
+
+bool ServiceCore::MailboxIsFullWithLock() const {
+    if (mailbox_capacity_ == kMailboxUnbounded) {
+        return false;
+    }
+    // 只有请求消息占用容量，关闭优先级通道时msgs_中也包含回复及控制类消息
+    return bounded_msg_count_ >= mailbox_capacity_;
+}
+
+std::vector<ServiceCore::MailboxWaiter> ServiceCore::TakeMailboxWaitersWithLock(size_t max_count) {
+    if (mailbox_waiters_.empty() || MailboxIsFullWithLock()) {
+        return {};
+    }
+    auto count = std::min(max_count, mailbox_waiters_.size());
+    std::vector<MailboxWaiter> waiters(std::make_move_iterator(mailbox_waiters_.begin()), std::make_move_iterator(mailbox_waiters_.begin() + count));
+    mailbox_waiters_.erase(mailbox_waiters_.begin(), mailbox_waiters_.begin() + count);
+    return waiters;
+}
+
+void ServiceCore::WakeUpMailboxWaiters(std::vector<MailboxWaiter>&& waiters) {
+    for (auto& waiter : waiters) {
+        service_mgr_->Send(*iter_, waiter.service, SessionSendToReplyId(waiter.session_id), make_message<ServiceMailboxWritableMsg>());
+    }
 }
 
 void ServiceCore::ProcessMsg(MessageElementWithStrongSender ele) {
@@ -184,6 +354,12 @@ void ServiceCore::ProcessMsg(MessageElementWithStrongSender ele) {
         ReplyMsg(&std::get<TaskElement>(res));
     }
     else if (SessionIsSendId(session_id)) {
+        if (SessionDeadlineExpired(ele.deadline())) {
+            // 请求方已超时放弃等待，不再处理
+            shed_count_.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        iservice_->set_msg_deadline(ele.deadline());
         auto task = iservice_->OnMsg(ServiceHandle(sender), session_id, std::move(msg));
         auto ele = excutor_.AddTask(TaskElement(std::move(sender), session_id, std::move(task)));
         if (!ele) {
@@ -195,13 +371,94 @@ void ServiceCore::ProcessMsg(MessageElementWithStrongSender ele) {
 }
 
 void ServiceCore::ProcessMsgs(size_t count) {
+    auto prev_service = tls_current_service;
+    tls_current_service = this;
+    // 处理耗时仅供负载均衡器使用，未开启时不读取时钟
+    bool measure_busy = service_mgr_->million().worker_mgr().rebalancer() != nullptr;
+    auto prev_nested_busy_ns = tls_nested_busy_ns;
+    std::chrono::steady_clock::time_point begin;
+    if (measure_busy) {
+        tls_nested_busy_ns = 0;
+        begin = std::chrono::steady_clock::now();
+    }
     // 如果处理了Exit，则直接抛弃所有消息及未完成的任务(包括未触发超时的任务)
-    for (size_t i = 0; i < count && !IsExited(); ++i) {
+    for (size_t i = 0; !IsExited(); ++i) {
+        if (i >= count) {
+            // 直接调用已经完成的回复，在本次调度中继续处理，避免再经过一次全局服务队列
+            if (direct_reply_count_ == 0) {
+                break;
+            }
+            --direct_reply_count_;
+        }
         auto msg_opt = PopMsg();
         if (!msg_opt) {
+            direct_reply_count_ = 0;
             break;
         }
-        ProcessMsg(std::move(*msg_opt));
+        ProcessMsgInstrumented(std::move(*msg_opt));
+    }
+    if (measure_busy) {
+        auto elapsed = std::chrono::steady_clock::now() - begin;
+        uint64_t elapsed_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+        // 嵌套处理的耗时已计入目标服务，不再重复计入
+        busy_ns_.fetch_add(elapsed_ns - std::min(elapsed_ns, tls_nested_busy_ns), std::memory_order_relaxed);
+        tls_nested_busy_ns = prev_nested_busy_ns + elapsed_ns;
+    }
+    tls_current_service = prev_service;
+}
+
+void ServiceCore::ProcessMsgInstrumented(MessageElementWithStrongSender ele) {
+    auto& tracer = service_mgr_->million().tracer();
+    auto session_id = ele.session_id();
+    bool tracing = tracer.enabled();
+    TraceContext prev_context;
+    TraceContext context;
+    const char* msg_type_name = nullptr;
+    ServiceId sender_id = 0;
+    if (tracing) {
+        // 直接调用时会嵌套处理其他服务的消息，结束后需要还原
+        prev_context = Tracer::active_context();
+        // 处理请求即开始一个新的span，回复则由等待的任务恢复执行时还原其所在的span
+        context = SessionIsSendId(session_id) ? ele.trace_context().ChildOf(session_id) : ele.trace_context();
+        Tracer::set_active_context(context);
+        if (context.sampled) {
+            msg_type_name = Tracer::MessageTypeName(ele.message());
+            sender_id = ele.sender() ? ele.sender()->service_id() : 0;
+            tracer.Record(TraceEventType::kProcessBegin, session_id, service_id_, sender_id, context, msg_type_name);
+        }
+    }
+    HandlerWatchSlot* watch_slot = nullptr;
+    if (service_mgr_->million().handler_watchdog()) {
+        auto worker = Worker::current();
+        if (worker && worker->watch_slot().Enter(service_id_, &typeid(*iservice_), ele.message(), session_id, MetricsNowNs())) {
+            watch_slot = &worker->watch_slot();
+        }
+    }
+    if constexpr (!kMetricsEnabled) {
+        ProcessMsg(std::move(ele));
+    }
+    else {
+        auto& million = service_mgr_->million();
+        auto& metrics = million.metrics();
+        auto& ids = million.core_metric_ids();
+        auto begin_ns = MetricsNowNs();
+        if (ele.enqueue_ns() != 0 && begin_ns > ele.enqueue_ns()) {
+            metrics.Record(ids.msg_queue_wait_ns, begin_ns - ele.enqueue_ns());
+        }
+        ProcessMsg(std::move(ele));
+        metrics.Record(ids.msg_handle_ns, MetricsNowNs() - begin_ns);
+        metrics.Add(ids.msg_processed);
+        processed_count_.fetch_add(1, std::memory_order_relaxed);
+        task_count_.store(excutor_.TaskCount(), std::memory_order_relaxed);
+    }
+    if (watch_slot) {
+        watch_slot->Exit();
+    }
+    if (tracing) {
+        if (msg_type_name) {
+            tracer.Record(TraceEventType::kProcessEnd, session_id, service_id_, sender_id, context, msg_type_name);
+        }
+        Tracer::set_active_context(prev_context);
     }
 }
 
@@ -222,15 +479,18 @@ bool ServiceCore::HasSeparateWorker() const {
 void ServiceCore::SeparateThreadHandle() {
     while (true) {
         std::optional<MessageElementWithStrongSender> msg;
+        std::vector<MailboxWaiter> waiters;
         {
-            auto lock = std::unique_lock(msgs_mutex_);
-            while (msgs_.empty()) {
+            auto lock = msgs_mutex_.unique_lock();
+            while (msgs_.empty() && high_msgs_.empty()) {
                 separate_worker_->cv.wait(lock);
             }
             msg = PopMsgWithLock();
+            waiters = TakeMailboxWaitersWithLock(1);
         }
+        WakeUpMailboxWaiters(std::move(waiters));
         do {
-            ProcessMsg(std::move(*msg));
+            ProcessMsgInstrumented(std::move(*msg));
             if (IsExited()) {
                 // 服务已退出，销毁
                 service_mgr_->DeleteService(this);
@@ -241,6 +501,13 @@ void ServiceCore::SeparateThreadHandle() {
 }
 
 std::optional<MessageElementWithStrongSender> ServiceCore::PopMsgWithLock() {
+    // 优先处理回复及服务控制类消息，避免已有协程的回复被积压的新请求阻塞
+    if (!high_msgs_.empty()) {
+        auto msg = std::move(high_msgs_.front());
+        high_msgs_.pop_front();
+        assert(msg.message());
+        return msg;
+    }
     if (msgs_.empty()) {
         return std::nullopt;
     }
@@ -251,8 +518,11 @@ std::optional<MessageElementWithStrongSender> ServiceCore::PopMsgWithLock() {
     //    return std::nullopt;
     //}
 
-    msgs_.pop();
+    msgs_.pop_front();
     assert(msg.message());
+    if (MsgIsBounded(msg.session_id(), msg.message())) {
+        --bounded_msg_count_;
+    }
     return msg;
 }
 
@@ -2,12 +2,16 @@
 
 #include <cstdint>
 
+#include <atomic>
 #include <functional>
 #include <memory>
 #include <mutex>
-#include <queue>
+#include <deque>
+#include <vector>
 
 #include <million/noncopyable.h>
+#include <million/mailbox_def.h>
+#include <million/profiled_mutex.h>
 #include <million/iservice.h>
 #include <million/service_handle.h>
 #include <million/message.h>
@@ -38,10 +42,11 @@ public:
     /** \brief 推送消息到服务的消息队列
      * \param sender 发送方服务共享指针
      * \param session_id 会话ID
-     * \param msg 消息指针
-     * \return 成功推送返回true，否则返回false
+     * \param msg 消息指针，仅在投递成功时被移走
+     * \param deadline 请求的截止时间，超过后不再处理该请求
+     * \return 投递结果，邮箱已满时根据策略返回kFull或丢弃旧消息后投递
      */
-    bool PushMsg(const ServiceShared& sender, SessionId session_id, MessagePointer msg);
+    MailboxPushResult PushMsg(const ServiceShared& sender, SessionId session_id, MessagePointer& msg, SessionDeadline deadline = kSessionDeadlineNone);
     /** \brief 从消息队列弹出一条消息
      * \return 包含消息元素的optional，如果队列为空则返回nullopt
      */
@@ -51,6 +56,30 @@ public:
      */
     bool MsgQueueIsEmpty();
 
+    /** \brief 开启/关闭优先级通道
+     * 
+     * 开启后回复及服务控制类消息进入高优先级通道，先于普通请求被处理
+     * 此时邮箱容量仅限制普通请求通道
+     */
+    void EnablePriorityLanes(bool enable);
+
+    /** \brief 设置邮箱容量及满时的处理策略
+     * \param capacity 邮箱容量，kMailboxUnbounded表示不限制
+     * \param policy 邮箱满时的处理策略
+     */
+    void SetMailboxCapacity(size_t capacity, MailboxFullPolicy policy);
+    /** \brief 获取邮箱统计信息
+     */
+    MailboxStats GetMailboxStats();
+    /** \brief 登记邮箱可写等待者
+     * 
+     * 邮箱出现空位时，会向waiter回复wait_session_id，唤醒挂起在SendAsync中的发送方
+     * \param waiter 等待方服务
+     * \param wait_session_id 等待方挂起的会话ID
+     * \return 邮箱已满且登记成功返回true，邮箱未满(可以直接重试投递)返回false
+     */
+    bool AddMailboxWaiter(const ServiceShared& waiter, SessionId wait_session_id);
+
     /** \brief 处理单条消息
      * \param msg 要处理的消息元素
      */
@@ -94,12 +123,47 @@ public:
      */
     void set_iter(std::list<std::shared_ptr<ServiceCore>>::iterator iter) { iter_ = iter; }
 
-    bool in_queue() const { return in_queue_; }
-    void set_in_queue(bool in_queue) { in_queue_ = in_queue; }
+    bool in_queue() const { return in_queue_.load(std::memory_order_acquire); }
+    void set_in_queue(bool in_queue) { in_queue_.store(in_queue, std::memory_order_release); }
+    /** \brief 原子地占有服务的处理权
+     * \return 服务原本不在队列中且未被处理时返回true，此后由调用方负责处理及释放
+     */
+    bool TryAcquireInQueue() {
+        bool expected = false;
+        return in_queue_.compare_exchange_strong(expected, true, std::memory_order_acq_rel);
+    }
+
+    /** \brief 开启直接调用
+     * 
+     * 开启后，工作线程中的其他服务向当前服务发送请求时，若当前服务空闲，
+     * 则由发送方所在的工作线程直接处理该请求，不经过全局服务队列
+     */
+    void EnableDirectDispatch() { direct_dispatch_ = true; }
+    bool direct_dispatch() const { return direct_dispatch_; }
+
+    /** \brief 直接调用完成后，发送方可以在本次调度中继续处理收到的回复
+     */
+    void AddDirectReply() { ++direct_reply_count_; }
+
+    /** \brief 获取当前工作线程正在处理的服务
+     * \return 不在ProcessMsgs中时返回nullptr
+     */
+    static ServiceCore* current();
 
     ServiceId service_id() { return service_id_; }
     void set_service_id(ServiceId service_id) { service_id_ = service_id; }
 
+    /** 分片模式下服务所属的worker，仅在持有处理权(in_queue_)时可以修改 */
+    size_t shard_id() const { return shard_id_.load(std::memory_order_acquire); }
+    void set_shard_id(size_t shard_id) { shard_id_.store(shard_id, std::memory_order_release); }
+
+    /** 累计处理消息的耗时(纳秒)，用于负载均衡采样 */
+    uint64_t busy_ns() const { return busy_ns_.load(std::memory_order_relaxed); }
+    /** 累计处理的消息数，仅在开启指标统计时记录 */
+    uint64_t processed_count() const { return processed_count_.load(std::memory_order_relaxed); }
+    /** 挂起中的协程任务数，每次处理完消息后更新，仅在开启指标统计时记录 */
+    size_t task_count() const { return task_count_.load(std::memory_order_relaxed); }
+
     /** \brief 获取服务接口引用
      * \return IService接口引用
      */
@@ -141,11 +205,33 @@ private:
      * 运行在独立工作线程中的消息循环和任务处理逻辑
      */
     void SeparateThreadHandle();
+    /** \brief 处理单条消息，开启指标统计时记录排队及处理耗时，会话被采样时记录追踪事件
+     * 在worker中处理时，向看门狗登记当前处理的消息
+     */
+    void ProcessMsgInstrumented(MessageElementWithStrongSender msg);
     /** \brief 带锁弹出消息
      * \return 包含消息元素的optional，队列为空时返回nullopt
      */
     std::optional<MessageElementWithStrongSender> PopMsgWithLock();
 
+    /** \brief 检查消息是否受邮箱容量限制
+     * 回复及服务控制类消息不受限制，避免已有协程无法完成
+     */
+    bool MsgIsBounded(SessionId session_id, const MessagePointer& msg) const;
+    bool MailboxIsFullWithLock() const;
+
+    struct MailboxWaiter {
+        ServiceShared service;
+        SessionId session_id;
+    };
+    /** \brief 邮箱出现空位时，按登记顺序取出最多max_count个等待者(需持有msgs_mutex_)
+     * 每个空位只唤醒一个等待者，避免所有等待者同时重试
+     */
+    std::vector<MailboxWaiter> TakeMailboxWaitersWithLock(size_t max_count);
+    /** \brief 唤醒邮箱可写等待者，不能在持有msgs_mutex_时调用
+     */
+    void WakeUpMailboxWaiters(std::vector<MailboxWaiter>&& waiters);
+
     /** \brief 回复消息给发送方
      * \param ele 任务元素指针，包含回复相关信息
      */
@@ -167,10 +253,28 @@ private:
     };
     ServiceStage stage_ = ServiceStage::kReady;
 
-    bool in_queue_ = false; ///< 标记服务是否在消息处理队列中
+    std::atomic<bool> in_queue_ = false; ///< 标记服务是否在消息处理队列中(或正在被处理)
+    bool direct_dispatch_ = false; ///< 是否允许直接调用
+    std::atomic<size_t> shard_id_ = 0; ///< 分片模式下服务所属的worker
+    std::atomic<uint64_t> busy_ns_ = 0; ///< 累计处理消息的耗时，仅开启负载均衡时统计
+    std::atomic<uint64_t> processed_count_ = 0; ///< 累计处理的消息数
+    std::atomic<size_t> task_count_ = 0; ///< 挂起中的协程任务数，供其他线程读取
+    size_t direct_reply_count_ = 0; ///< 直接调用产生的待处理回复数，仅由处理当前服务的线程访问
+
+    ProfiledMutex msgs_mutex_{ "service_core.msgs" };  ///< 消息队列互斥锁，保护msgs_的线程安全访问
+    std::deque<MessageElementWithStrongSender> msgs_; ///< 消息队列，存储待处理的消息元素
+    bool priority_lanes_ = false; ///< 是否开启优先级通道，受msgs_mutex_保护
+    std::deque<MessageElementWithStrongSender> high_msgs_; ///< 高优先级通道，存储回复及服务控制类消息
 
-    std::mutex msgs_mutex_;  ///< 消息队列互斥锁，保护msgs_的线程安全访问
-    std::queue<MessageElementWithStrongSender> msgs_; ///< 消息队列，存储待处理的消息元素
+    size_t mailbox_capacity_ = kMailboxUnbounded; ///< 邮箱容量，受msgs_mutex_保护
+    MailboxFullPolicy mailbox_full_policy_ = MailboxFullPolicy::kReject; ///< 邮箱满时的处理策略
+    size_t mailbox_high_water_mark_ = 0; ///< 邮箱历史最大消息数
+    uint64_t mailbox_rejected_count_ = 0; ///< 因邮箱满被拒绝的消息数
+    uint64_t mailbox_suspended_count_ = 0; ///< 因邮箱满(kSuspend)未投递的次数，包括重试
+    size_t bounded_msg_count_ = 0; ///< msgs_中占用容量的请求消息数
+    uint64_t mailbox_dropped_count_ = 0; ///< 因邮箱满被丢弃的消息数
+    std::deque<MailboxWaiter> mailbox_waiters_; ///< 等待邮箱出现空位的发送方，按登记顺序唤醒
+    std::atomic<uint64_t> shed_count_ = 0; ///< 因超过截止时间被丢弃的请求数
 
     // 允许指定某个任务执行完成之前，其他任务不允许并发执行
     // SessionId lock_task_ = kSessionIdInvalid;
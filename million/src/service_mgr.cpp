@@ -1,12 +1,45 @@
 #include <limits> 
+#include <algorithm>
+#include <optional>
+#include <thread>
+#include <utility>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
 
 #include "service_mgr.h"
 
 #include "million.h"
 #include "service_core.h"
+#include "worker_mgr.h"
 
 namespace million {
 
+static inline void CpuRelax() {
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    _mm_pause();
+#elif defined(_MSC_VER) && defined(_M_ARM64)
+    __yield();
+#elif defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield");
+#endif
+}
+
+// 直接调用的最大嵌套深度，避免调用链过长导致栈溢出
+constexpr size_t kMaxDirectDispatchDepth = 8;
+static thread_local size_t tls_direct_dispatch_depth = 0;
+
+// 直接调用期间等待的回复，目标在本次处理中回复时标记
+struct DirectReplyWatch {
+    ServiceCore* sender;
+    SessionId reply_session_id;
+    bool replied = false;
+};
+static thread_local DirectReplyWatch* tls_direct_reply_watch = nullptr;
+
 ServiceMgr::ServiceMgr(Million* million)
     : million_(million) {}
 
@@ -28,7 +61,7 @@ ServiceId ServiceMgr::AllocServiceId() {
     return million_->seata_snowflake().NextId();
 }
 
-std::optional<ServiceShared> ServiceMgr::AddService(std::unique_ptr<IService> iservice) {
+std::optional<ServiceShared> ServiceMgr::AddService(std::unique_ptr<IService> iservice, std::optional<size_t> shard_id) {
     decltype(services_)::iterator iter;
     auto service_shared = std::make_shared<ServiceCore>(this, std::move(iservice));
     auto handle = ServiceHandle(service_shared);
@@ -43,6 +76,15 @@ std::optional<ServiceShared> ServiceMgr::AddService(std::unique_ptr<IService> is
     }
     service_ptr->set_iter(iter);
     SetServiceId(service_shared, AllocServiceId());
+    auto& worker_mgr = million_->worker_mgr();
+    if (worker_mgr.shard_mode()) {
+        if (shard_id) {
+            service_ptr->set_shard_id(*shard_id % worker_mgr.worker_num());
+        }
+        else {
+            service_ptr->set_shard_id(worker_mgr.SelectShard(service_ptr->service_id()));
+        }
+    }
     try {
         success = service_shared->iservice().OnInit();
     }
@@ -90,34 +132,96 @@ void ServiceMgr::PushService(ServiceCore* service) {
     if (service->HasSeparateWorker()) {
         return;
     }
-    bool has_push = false;
+    // set为false的时机，在ProcessMsg完成后设置
+    // 避免当前Service同时被多个Work线程持有并ProcessMsg
+    if (!service->TryAcquireInQueue()) {
+        return;
+    }
+    auto& worker_mgr = million_->worker_mgr();
+    if (worker_mgr.shard_mode()) {
+        worker_mgr.PushService(service);
+        return;
+    }
+    bool need_notify = false;
     {
         auto lock = std::lock_guard(service_queue_mutex_);
-        if (!service->in_queue()) {
-            service_queue_.emplace(service);
-            // set为false的时机，在ProcessMsg完成后设置
-            // 避免当前Service同时被多个Work线程持有并ProcessMsg
-            service->set_in_queue(true);
-            has_push = true;
-        }
+        service_queue_.emplace(service);
+        auto size = service_queue_size_.fetch_add(1) + 1;
+        // 自旋中的工作线程足以取走队列中的服务时，无需唤醒休眠的工作线程
+        need_notify = sleeping_workers_ > 0 && size > spinning_workers_.load();
     }
-    if (has_push) {
+    if (need_notify) {
         service_queue_cv_.notify_one();
     }
 }
 
 ServiceCore* ServiceMgr::PopService() {
-    auto lock = std::unique_lock(service_queue_mutex_);
+    // 每个工作线程独立调整自旋次数：自旋期间等到了服务就增加，最终仍需休眠就减少
+    static thread_local uint32_t tls_spin_count = 0;
+    tls_spin_count = std::clamp(tls_spin_count, idle_strategy_.spin_min, idle_strategy_.spin_max);
+    if (idle_strategy_.spin_max > 0 || idle_strategy_.yield_count > 0) {
+        spinning_workers_.fetch_add(1);
+        for (uint32_t i = 0; i < tls_spin_count + idle_strategy_.yield_count && run_; ++i) {
+            if (auto service = TryPopService()) {
+                spinning_workers_.fetch_sub(1);
+                if (i > 0) {
+                    tls_spin_count = std::min(std::max(tls_spin_count * 2, 1u), idle_strategy_.spin_max);
+                }
+                return service;
+            }
+            if (i < tls_spin_count) {
+                CpuRelax();
+            }
+            else {
+                std::this_thread::yield();
+            }
+        }
+        spinning_workers_.fetch_sub(1);
+        tls_spin_count = std::max(tls_spin_count / 2, idle_strategy_.spin_min);
+    }
+
+    auto lock = service_queue_mutex_.unique_lock();
+    ++sleeping_workers_;
     while (run_ && service_queue_.empty()) {
         service_queue_cv_.wait(lock);
     }
+    --sleeping_workers_;
     if (!run_) return nullptr;
     auto* service = service_queue_.front();
     assert(service);
     service_queue_.pop();
+    service_queue_size_.fetch_sub(1);
+    return service;
+}
+
+ServiceCore* ServiceMgr::TryPopService() {
+    if (service_queue_size_.load(std::memory_order_relaxed) == 0) {
+        return nullptr;
+    }
+    auto lock = std::lock_guard(service_queue_mutex_);
+    if (service_queue_.empty()) {
+        return nullptr;
+    }
+    auto* service = service_queue_.front();
+    assert(service);
+    service_queue_.pop();
+    service_queue_size_.fetch_sub(1);
     return service;
 }
 
+void ServiceMgr::ReleaseService(ServiceCore* service) {
+    // 可以将service放到队列了
+    service->set_in_queue(false);
+    if (!service->MsgQueueIsEmpty()) {
+        PushService(service);
+        return;
+    }
+    if (service->IsExited()) {
+        // 服务已退出，销毁
+        DeleteService(service);
+    }
+}
+
 bool ServiceMgr::SetServiceId(const ServiceShared& service, ServiceId service_id) {
     auto lock = std::lock_guard(id_map_mutex_);
     auto res = id_map_.emplace(service_id, service->iter());
@@ -134,6 +238,13 @@ std::optional<ServiceShared> ServiceMgr::FindServiceById(ServiceId id) {
     return *iter->second;
 }
 
+void ServiceMgr::ForeachService(const std::function<void(const ServiceShared&)>& callback) {
+    auto lock = std::lock_guard(services_mutex_);
+    for (auto& service : services_) {
+        callback(service);
+    }
+}
+
 bool ServiceMgr::SetServiceNameId(const ServiceShared& service, ModuleCode name_id) {
     auto lock = std::lock_guard(name_map_mutex_);
     auto res = name_map_.emplace(name_id, service->iter());
@@ -150,12 +261,71 @@ std::optional<ServiceShared> ServiceMgr::FindServiceByNameId(ModuleCode name_id)
     return *iter->second;
 }
 
-bool ServiceMgr::Send(const ServiceShared& sender, const ServiceShared& target, SessionId session_id, MessagePointer msg) {
-    if (!target->PushMsg(sender, session_id, std::move(msg))) {
-        return false;
+bool ServiceMgr::Send(const ServiceShared& sender, const ServiceShared& target, SessionId session_id, MessagePointer msg, SessionDeadline deadline) {
+    return TrySend(sender, target, session_id, msg, deadline) == MailboxPushResult::kSuccess;
+}
+
+MailboxPushResult ServiceMgr::TrySend(const ServiceShared& sender, const ServiceShared& target, SessionId session_id, MessagePointer& msg, SessionDeadline deadline) {
+    if (target->direct_dispatch() && SessionIsSendId(session_id)) {
+        auto res = TryDirectDispatch(sender, target, session_id, msg, deadline);
+        if (res) {
+            return *res;
+        }
+    }
+    auto res = target->PushMsg(sender, session_id, msg, deadline);
+    if (res != MailboxPushResult::kSuccess) {
+        return res;
+    }
+    auto watch = tls_direct_reply_watch;
+    if (watch && watch->sender == target.get() && watch->reply_session_id == session_id) {
+        watch->replied = true;
     }
     PushService(target.get());
-    return true;
+    return res;
+}
+
+std::optional<MailboxPushResult> ServiceMgr::TryDirectDispatch(const ServiceShared& sender, const ServiceShared& target, SessionId session_id, MessagePointer& msg, SessionDeadline deadline) {
+    // 仅限工作线程中正在处理的发送方，发起的直接调用
+    auto current = ServiceCore::current();
+    if (!current || current != sender.get() || current == target.get()) {
+        return std::nullopt;
+    }
+    if (target->HasSeparateWorker() || tls_direct_dispatch_depth >= kMaxDirectDispatchDepth) {
+        return std::nullopt;
+    }
+    if (million_->worker_mgr().shard_mode() && target->shard_id() != sender->shard_id()) {
+        // 分片模式下，服务只能由所属分片的worker处理
+        return std::nullopt;
+    }
+    // 占有目标的处理权，保证目标服务同一时间只被一个线程处理
+    if (!target->TryAcquireInQueue()) {
+        return std::nullopt;
+    }
+    if (million_->worker_mgr().shard_mode() && target->shard_id() != sender->shard_id()) {
+        // 上面的检查与占有处理权之间，目标可能已被迁移到其他分片
+        ReleaseService(target.get());
+        return std::nullopt;
+    }
+    if (!target->MsgQueueIsEmpty()) {
+        // 目标还有积压的消息，直接处理会破坏消息顺序
+        ReleaseService(target.get());
+        return std::nullopt;
+    }
+    auto res = target->PushMsg(sender, session_id, msg, deadline);
+    if (res == MailboxPushResult::kSuccess) {
+        DirectReplyWatch watch{ sender.get(), SessionSendToReplyId(session_id) };
+        auto prev_watch = std::exchange(tls_direct_reply_watch, &watch);
+        ++tls_direct_dispatch_depth;
+        target->ProcessMsgs(1);
+        --tls_direct_dispatch_depth;
+        tls_direct_reply_watch = prev_watch;
+        if (watch.replied) {
+            // 目标已在本次处理中回复，发送方当前正被本线程处理，回复不会经过全局服务队列
+            sender->AddDirectReply();
+        }
+    }
+    ReleaseService(target.get());
+    return res;
 }
 
 } // namespace million
\ No newline at end of file
@@ -5,9 +5,11 @@
 #include <memory>
 #include <mutex>
 #include <list>
+#include <functional>
 #include <queue>
 
 #include <million/module_def.h>
+#include <million/profiled_mutex.h>
 
 #include "service_core.h"
 
@@ -16,6 +18,15 @@ namespace million {
 MILLION_MESSAGE_DEFINE_NONCOPYABLE(, ServiceStartMsg, (MessagePointer) with_msg);
 MILLION_MESSAGE_DEFINE_NONCOPYABLE(, ServiceStopMsg, (MessagePointer) with_msg);
 MILLION_MESSAGE_DEFINE_EMPTY(, ServiceExitMsg);
+// 目标服务邮箱出现空位，用于唤醒SendAsync中挂起的发送方
+MILLION_MESSAGE_DEFINE_EMPTY(, ServiceMailboxWritableMsg);
+
+// 工作线程空闲时的等待策略：先自旋，再让出时间片，最后休眠
+struct WorkerIdleStrategy {
+    uint32_t spin_min = 64;         // 自适应自旋次数的下限
+    uint32_t spin_max = 4096;       // 自适应自旋次数的上限，为0时不自旋
+    uint32_t yield_count = 16;      // 自旋结束后让出时间片的次数
+};
 
 class Million;
 class ServiceMgr {
@@ -25,7 +36,8 @@ public:
 
     void Stop();
 
-    std::optional<ServiceShared> AddService(std::unique_ptr<IService> service);
+    // shard_id为空时，分片模式下按服务id哈希选择分片
+    std::optional<ServiceShared> AddService(std::unique_ptr<IService> service, std::optional<size_t> shard_id = std::nullopt);
     void DeleteService(ServiceCore* service);
 
     std::optional<SessionId> StartService(const ServiceShared& service, MessagePointer with_msg);
@@ -34,36 +46,52 @@ public:
 
     void PushService(ServiceCore* service);
     ServiceCore* PopService();
+    void SetWorkerIdleStrategy(const WorkerIdleStrategy& strategy) { idle_strategy_ = strategy; }
+    size_t service_queue_size() const { return service_queue_size_.load(std::memory_order_relaxed); }
+    /** 服务处理完成，释放处理权，如果还有未处理的消息则重新推入队列 */
+    void ReleaseService(ServiceCore* service);
 
     std::optional<ServiceShared> FindServiceById(ServiceId id);
+    void ForeachService(const std::function<void(const ServiceShared&)>& callback);
 
     bool SetServiceNameId(const ServiceShared& handle, ModuleCode name_id);
     std::optional<ServiceShared> FindServiceByNameId(ModuleCode name_id);
 
-    bool Send(const ServiceShared& sender, const ServiceShared& target, SessionId session_id, MessagePointer msg);
+    bool Send(const ServiceShared& sender, const ServiceShared& target, SessionId session_id, MessagePointer msg, SessionDeadline deadline = kSessionDeadlineNone);
+    // 投递失败时不会移走msg
+    MailboxPushResult TrySend(const ServiceShared& sender, const ServiceShared& target, SessionId session_id, MessagePointer& msg, SessionDeadline deadline = kSessionDeadlineNone);
     
     Million& million() const { return *million_; }
 
 private:
+    // 尝试在发送方所在的工作线程直接处理请求，不满足条件时返回nullopt，走正常投递流程
+    std::optional<MailboxPushResult> TryDirectDispatch(const ServiceShared& sender, const ServiceShared& target, SessionId session_id, MessagePointer& msg, SessionDeadline deadline);
+
+    ServiceCore* TryPopService();
+
     ServiceId AllocServiceId();
     bool SetServiceId(const ServiceShared& handle, ServiceId id);
 
 private:
     Million* million_;
 
-    std::mutex services_mutex_;
+    ProfiledMutex services_mutex_{ "service_mgr.services" };
     std::list<ServiceShared> services_;
     
-    std::mutex name_map_mutex_;
+    ProfiledMutex name_map_mutex_{ "service_mgr.name_map" };
     std::unordered_map<ModuleCode, std::list<ServiceShared>::iterator> name_map_;
 
-    std::mutex id_map_mutex_;
+    ProfiledMutex id_map_mutex_{ "service_mgr.id_map" };
     std::unordered_map<ServiceId, std::list<ServiceShared>::iterator> id_map_;
 
-    std::mutex service_queue_mutex_;
-    bool run_ = true;
+    ProfiledMutex service_queue_mutex_{ "service_mgr.service_queue" };
+    std::atomic<bool> run_ = true;
     std::queue<ServiceCore*> service_queue_;
     std::condition_variable service_queue_cv_;
+    std::atomic<size_t> service_queue_size_ = 0;    // 供自旋的工作线程无锁探测
+    size_t sleeping_workers_ = 0;                   // 休眠中的工作线程数，受service_queue_mutex_保护
+    std::atomic<size_t> spinning_workers_ = 0;      // 自旋/让出时间片中的工作线程数
+    WorkerIdleStrategy idle_strategy_;
 };
 
 } // namespace million
\ No newline at end of file
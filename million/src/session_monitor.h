@@ -26,6 +26,7 @@ public:
     void Stop();
 
     void AddSession(const ServiceShared& service, SessionId session_id, uint32_t timeout_s);
+    size_t size() const { return tasks_.size(); }
 private:
     Million* million_;
     uint32_t timeout_tick_;
@@ -0,0 +1,170 @@
+#include "shard_rebalancer.h"
+
+#include <cassert>
+#include <chrono>
+
+#include "million.h"
+#include "service_mgr.h"
+#include "service_core.h"
+#include "worker_mgr.h"
+
+namespace million {
+
+ShardRebalancer::ShardRebalancer(Million* million, const ShardRebalanceConfig& config)
+    : million_(million)
+    , config_(config) {}
+
+ShardRebalancer::~ShardRebalancer() = default;
+
+void ShardRebalancer::Start() {
+    thread_.emplace([this](std::stop_token st) {
+        auto interval = std::chrono::milliseconds(config_.interval_ms);
+        auto next = std::chrono::steady_clock::now() + interval;
+        while (!st.stop_requested()) {
+            std::this_thread::sleep_until(next);
+            next += interval;
+            if (st.stop_requested()) {
+                break;
+            }
+            Rebalance();
+        }
+    });
+}
+
+void ShardRebalancer::Stop() {
+    thread_.reset();
+}
+
+void ShardRebalancer::Rebalance() {
+    auto& worker_mgr = million_->worker_mgr();
+    auto shard_num = worker_mgr.worker_num();
+    if (shard_num < 2) {
+        return;
+    }
+    ++round_;
+
+    struct Candidate {
+        ServiceShared service;
+        uint64_t busy_ns;
+        size_t mailbox_size;
+    };
+    std::vector<uint64_t> shard_busy_ns(shard_num, 0);
+    std::vector<size_t> shard_queue_depth(shard_num, 0);
+    std::vector<std::vector<Candidate>> shard_services(shard_num);
+
+    million_->service_mgr().ForeachService([&](const ServiceShared& service) {
+        if (service->HasSeparateWorker()) {
+            return;
+        }
+        auto& sample = samples_[service->service_id()];
+        auto busy_ns = service->busy_ns();
+        auto delta = busy_ns - sample.last_busy_ns;
+        sample.last_busy_ns = busy_ns;
+        sample.last_round = round_;
+        auto mailbox_size = service->GetMailboxStats().size;
+        auto shard_id = service->shard_id();
+        shard_busy_ns[shard_id] += delta;
+        shard_queue_depth[shard_id] += mailbox_size;
+        shard_services[shard_id].emplace_back(Candidate{ service, delta, mailbox_size });
+    });
+
+    // 清理已销毁服务的采样数据
+    std::erase_if(samples_, [this](const auto& pair) { return pair.second.last_round != round_; });
+
+    size_t hot = 0, cold = 0;
+    for (size_t i = 1; i < shard_num; ++i) {
+        if (shard_busy_ns[i] > shard_busy_ns[hot]) hot = i;
+        // 同样空闲时，选择积压更少的分片
+        if (shard_busy_ns[i] < shard_busy_ns[cold]
+            || (shard_busy_ns[i] == shard_busy_ns[cold] && shard_queue_depth[i] < shard_queue_depth[cold])) {
+            cold = i;
+        }
+    }
+
+    // 滞后区间：不够忙或差距不够大时不迁移，避免服务在分片间来回迁移
+    uint64_t interval_ns = static_cast<uint64_t>(config_.interval_ms) * 1000000;
+    if (shard_busy_ns[hot] < interval_ns * config_.min_busy_ratio) {
+        return;
+    }
+    if (shard_busy_ns[hot] < shard_busy_ns[cold] * config_.imbalance_ratio) {
+        return;
+    }
+    // 最忙分片上的消息积压不比最闲分片多，说明其仍能及时处理，无需迁移
+    if (shard_queue_depth[hot] <= shard_queue_depth[cold]) {
+        return;
+    }
+
+    // 选择负载最接近两分片差值一半的服务，迁移后两边尽量均衡，且不会使目标分片反而更忙
+    uint64_t gap = shard_busy_ns[hot] - shard_busy_ns[cold];
+    Candidate* best = nullptr;
+    for (auto& candidate : shard_services[hot]) {
+        if (candidate.busy_ns == 0 || candidate.busy_ns >= gap) {
+            continue;
+        }
+        auto& sample = samples_[candidate.service->service_id()];
+        if (sample.last_migrate_round && round_ - *sample.last_migrate_round < config_.cooldown_intervals) {
+            continue;
+        }
+        auto distance = [gap](uint64_t busy_ns) {
+            auto half = gap / 2;
+            return busy_ns > half ? busy_ns - half : half - busy_ns;
+        };
+        // 距离相同时优先迁移积压更多的服务，其积压的消息会随之到新分片处理
+        if (!best || distance(candidate.busy_ns) < distance(best->busy_ns)
+            || (distance(candidate.busy_ns) == distance(best->busy_ns) && candidate.mailbox_size > best->mailbox_size)) {
+            best = &candidate;
+        }
+    }
+    if (!best) {
+        return;
+    }
+
+    ServiceMigrationEvent event;
+    event.service_id = best->service->service_id();
+    event.from_shard = hot;
+    event.to_shard = cold;
+    event.service_busy_ns = best->busy_ns;
+    event.from_shard_busy_ns = shard_busy_ns[hot];
+    event.to_shard_busy_ns = shard_busy_ns[cold];
+    event.mailbox_size = best->mailbox_size;
+    event.from_shard_queue_depth = shard_queue_depth[hot];
+    event.to_shard_queue_depth = shard_queue_depth[cold];
+    event.reason = MigrationReason::kLoadImbalance;
+    if (!Migrate(best->service.get(), cold)) {
+        return;
+    }
+    samples_[event.service_id].last_migrate_round = round_;
+    migration_count_.fetch_add(1, std::memory_order_relaxed);
+    {
+        auto lock = std::lock_guard(migration_counts_mutex_);
+        ++migration_counts_[{ event.from_shard, event.to_shard, event.reason }];
+    }
+    million_->logger().LOG_INFO("Service migrated: service_id: {}, shard {} -> {}, reason: {}, service busy: {}us, shard busy: {}us -> {}us, mailbox: {}, shard queue depth: {} -> {}.",
+        event.service_id, event.from_shard, event.to_shard, MigrationReasonName(event.reason), event.service_busy_ns / 1000,
+        event.from_shard_busy_ns / 1000, event.to_shard_busy_ns / 1000, event.mailbox_size,
+        event.from_shard_queue_depth, event.to_shard_queue_depth);
+}
+
+std::vector<MigrationCount> ShardRebalancer::migration_counts() const {
+    auto lock = std::lock_guard(migration_counts_mutex_);
+    std::vector<MigrationCount> counts;
+    counts.reserve(migration_counts_.size());
+    for (auto& [key, count] : migration_counts_) {
+        auto& [from_shard, to_shard, reason] = key;
+        counts.emplace_back(MigrationCount{ from_shard, to_shard, reason, count });
+    }
+    return counts;
+}
+
+bool ShardRebalancer::Migrate(ServiceCore* service, size_t to_shard) {
+    // 占有处理权，确保服务既不在任何队列中，也没有被worker处理
+    if (!service->TryAcquireInQueue()) {
+        return false;
+    }
+    service->set_shard_id(to_shard);
+    // 释放处理权，若有待处理的消息，会投递到新分片
+    million_->service_mgr().ReleaseService(service);
+    return true;
+}
+
+} // namespace million
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstdint>
+
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+#include <million/noncopyable.h>
+#include <million/service_handle.h>
+
+namespace million {
+
+struct ShardRebalanceConfig {
+    uint32_t interval_ms = 1000;        // 采样周期
+    double imbalance_ratio = 1.5;       // 最忙分片负载超过最闲分片的倍数时才迁移
+    double min_busy_ratio = 0.1;        // 最忙分片在采样周期内的忙碌占比低于该值时不迁移
+    uint32_t cooldown_intervals = 10;   // 服务迁移后，至少间隔多少个采样周期才能再次迁移
+};
+
+enum class MigrationReason {
+    kLoadImbalance,     // 最忙分片负载及积压明显高于最闲分片
+};
+
+inline const char* MigrationReasonName(MigrationReason reason) {
+    switch (reason) {
+    case MigrationReason::kLoadImbalance: return "load_imbalance";
+    }
+    return "unknown";
+}
+
+// 按(源分片, 目标分片, 原因)统计的迁移次数
+struct MigrationCount {
+    size_t from_shard;
+    size_t to_shard;
+    MigrationReason reason;
+    uint64_t count;
+};
+
+struct ServiceMigrationEvent {
+    ServiceId service_id;
+    size_t from_shard;
+    size_t to_shard;
+    uint64_t service_busy_ns;       // 服务在本采样周期内的忙碌时间
+    uint64_t from_shard_busy_ns;
+    uint64_t to_shard_busy_ns;
+    size_t mailbox_size;
+    size_t from_shard_queue_depth;  // 分片上各服务邮箱中积压的消息数之和
+    size_t to_shard_queue_depth;
+    MigrationReason reason;
+};
+
+class Million;
+class ServiceCore;
+// 分片模式下的负载均衡器
+// 周期性采样各服务的处理耗时及邮箱积压，将最忙且有积压的分片上的服务迁移到最闲分片
+// 仅在服务不在队列中且未被处理时(成功占有in_queue_)迁移
+class ShardRebalancer : noncopyable {
+public:
+    ShardRebalancer(Million* million, const ShardRebalanceConfig& config);
+    ~ShardRebalancer();
+
+    void Start();
+    void Stop();
+
+    uint64_t migration_count() const { return migration_count_.load(std::memory_order_relaxed); }
+    std::vector<MigrationCount> migration_counts() const;
+
+private:
+    void Rebalance();
+    bool Migrate(ServiceCore* service, size_t to_shard);
+
+private:
+    struct ServiceSample {
+        uint64_t last_busy_ns = 0;
+        uint64_t last_round = 0;            // 最后一次采样的轮次
+        std::optional<uint64_t> last_migrate_round;
+    };
+
+    Million* million_;
+    ShardRebalanceConfig config_;
+    std::optional<std::jthread> thread_;
+
+    uint64_t round_ = 0;
+    std::unordered_map<ServiceId, ServiceSample> samples_;
+
+    std::atomic<uint64_t> migration_count_ = 0;
+    // 迁移很少发生，采集指标时才读取，直接加锁
+    mutable std::mutex migration_counts_mutex_;
+    std::map<std::tuple<size_t, size_t, MigrationReason>, uint64_t> migration_counts_;
+};
+
+} // namespace million
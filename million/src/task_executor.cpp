@@ -12,6 +12,7 @@
 #include "service_mgr.h"
 #include "session_monitor.h"
 #include "million.h"
+#include "tracer.h"
 
 namespace million {
 
@@ -60,6 +61,7 @@ std::optional<TaskElement> TaskExecutor::AddTask(TaskElement&& ele) {
     }
     if (!ele.task.coroutine.done()) {
         assert(ele.task.coroutine.promise().session_awaiter());
+        ele.trace_context = Tracer::active_context();
         Push(ele.task.coroutine.promise().session_awaiter()->waiting_session_id(), std::move(ele));
         return std::nullopt;
     }
@@ -70,6 +72,10 @@ bool TaskExecutor::TaskQueueIsEmpty() const {
     return tasks_.empty();
 }
 
+size_t TaskExecutor::TaskCount() const {
+    return tasks_.size();
+}
+
 std::pair<TaskElement*, bool> TaskExecutor::TaskTimeout(SessionId session_id) {
     auto iter = tasks_.find(session_id);
     if (iter == tasks_.end()) {
@@ -99,6 +105,7 @@ std::optional<MessagePointer> TaskExecutor::TrySchedule(TaskElement& ele, Sessio
         }
     }
     awaiter->set_result(std::move(msg));
+    Tracer::set_active_context(ele.trace_context);
     auto waiting_coroutine = awaiter->waiting_coroutine();
     waiting_coroutine.resume();
     if (ele.task.has_exception()) {
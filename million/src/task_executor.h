@@ -11,6 +11,7 @@
 
 #include <million/noncopyable.h>
 #include <million/session_def.h>
+#include <million/trace_def.h>
 #include <million/service_handle.h>
 #include <million/task.h>
 
@@ -25,6 +26,8 @@ struct TaskElement {
     ServiceShared sender;
     SessionId session_id;
     Task<MessagePointer> task;
+    // 任务所在的追踪上下文，恢复执行时还原
+    TraceContext trace_context;
 };
 
 class ServiceCore;
@@ -40,6 +43,7 @@ public:
     std::optional<TaskElement> AddTask(TaskElement&& ele);
 
     bool TaskQueueIsEmpty() const;
+    size_t TaskCount() const;
 
     std::pair<TaskElement*, bool> TaskTimeout(SessionId id);
 
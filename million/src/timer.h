@@ -25,6 +25,7 @@ public:
     void Stop();
 
     void AddTask(uint32_t tick, const ServiceShared& service, MessagePointer msg);
+    size_t size() const { return tasks_.size(); }
 
 private:
     Million* million_;
@@ -0,0 +1,332 @@
+#include "tracer.h"
+
+#include <algorithm>
+#include <format>
+#include <fstream>
+
+#include <million/metrics.h>
+
+namespace million {
+
+// 单写多读的覆盖式环形缓冲区，读取方通过槽位序号校验读到的事件是否完整
+struct Tracer::Ring {
+    struct Slot {
+        std::atomic<uint64_t> seq = 0;      // 写入中为0，写入完成后为事件序号+1
+        std::atomic<uint32_t> type = 0;
+        std::atomic<uint64_t> ts_ns = 0;
+        std::atomic<uint64_t> session_id = 0;
+        std::atomic<uint64_t> service_id = 0;
+        std::atomic<uint64_t> peer_service_id = 0;
+        std::atomic<const char*> msg_type_name = nullptr;
+        std::atomic<uint64_t> trace_id = 0;
+        std::atomic<uint64_t> span_id = 0;
+        std::atomic<uint64_t> parent_span_id = 0;
+        std::atomic<uint64_t> dur_ns = 0;
+    };
+
+    Ring(size_t capacity, uint32_t tid)
+        : tid(tid) {
+        size_t size = 2;
+        while (size < capacity) {
+            size <<= 1;
+        }
+        mask = size - 1;
+        slots = std::make_unique<Slot[]>(size);
+    }
+
+    // 仅所属线程调用
+    void Push(const TraceEvent& event) {
+        auto index = head.load(std::memory_order_relaxed);
+        auto& slot = slots[index & mask];
+        slot.seq.store(0, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        slot.type.store(static_cast<uint32_t>(event.type), std::memory_order_relaxed);
+        slot.ts_ns.store(event.ts_ns, std::memory_order_relaxed);
+        slot.session_id.store(event.session_id, std::memory_order_relaxed);
+        slot.service_id.store(event.service_id, std::memory_order_relaxed);
+        slot.peer_service_id.store(event.peer_service_id, std::memory_order_relaxed);
+        slot.msg_type_name.store(event.msg_type_name, std::memory_order_relaxed);
+        slot.trace_id.store(event.trace_id, std::memory_order_relaxed);
+        slot.span_id.store(event.span_id, std::memory_order_relaxed);
+        slot.parent_span_id.store(event.parent_span_id, std::memory_order_relaxed);
+        slot.dur_ns.store(event.dur_ns, std::memory_order_relaxed);
+        slot.seq.store(index + 1, std::memory_order_release);
+        head.store(index + 1, std::memory_order_release);
+    }
+
+    // 可由任意线程调用，跳过正在被覆盖的槽位
+    void Collect(std::vector<TraceEvent>* events) const {
+        auto end = head.load(std::memory_order_acquire);
+        auto begin = end > mask + 1 ? end - (mask + 1) : 0;
+        for (auto index = begin; index < end; ++index) {
+            auto& slot = slots[index & mask];
+            auto seq = slot.seq.load(std::memory_order_acquire);
+            if (seq != index + 1) {
+                continue;
+            }
+            TraceEvent event;
+            event.type = static_cast<TraceEventType>(slot.type.load(std::memory_order_relaxed));
+            event.ts_ns = slot.ts_ns.load(std::memory_order_relaxed);
+            event.session_id = slot.session_id.load(std::memory_order_relaxed);
+            event.service_id = slot.service_id.load(std::memory_order_relaxed);
+            event.peer_service_id = slot.peer_service_id.load(std::memory_order_relaxed);
+            event.msg_type_name = slot.msg_type_name.load(std::memory_order_relaxed);
+            event.trace_id = slot.trace_id.load(std::memory_order_relaxed);
+            event.span_id = slot.span_id.load(std::memory_order_relaxed);
+            event.parent_span_id = slot.parent_span_id.load(std::memory_order_relaxed);
+            event.dur_ns = slot.dur_ns.load(std::memory_order_relaxed);
+            event.tid = tid;
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (slot.seq.load(std::memory_order_relaxed) != seq) {
+                continue;
+            }
+            events->emplace_back(event);
+        }
+    }
+
+    const uint32_t tid;
+    std::string thread_name;        // 受State::mutex保护
+    size_t mask = 0;
+    std::unique_ptr<Slot[]> slots;
+    std::atomic<uint64_t> head = 0;
+};
+
+struct Tracer::State {
+    std::mutex mutex;
+    // 线程退出后缓冲区仍保留，以便导出其最近的事件
+    std::vector<std::shared_ptr<Ring>> rings;
+};
+
+struct TracerThreadLocal {
+    struct Entry {
+        Tracer* tracer;
+        std::shared_ptr<Tracer::State> state;
+        std::shared_ptr<Tracer::Ring> ring;
+    };
+
+    Tracer* last_tracer = nullptr;
+    Tracer::Ring* last_ring = nullptr;
+    std::vector<Entry> entries;
+};
+
+static thread_local TracerThreadLocal tls_tracer;
+static thread_local TraceContext tls_active_context;
+
+Tracer::Tracer()
+    : state_(std::make_shared<State>()) {}
+
+Tracer::~Tracer() {
+    if (tls_tracer.last_tracer == this) {
+        tls_tracer.last_tracer = nullptr;
+        tls_tracer.last_ring = nullptr;
+    }
+}
+
+void Tracer::Enable(const TracerConfig& config) {
+    sample_rate_ = config.sample_rate;
+    ring_size_ = config.ring_size;
+    enabled_.store(true, std::memory_order_relaxed);
+}
+
+Tracer::Ring& Tracer::LocalRing() {
+    if (tls_tracer.last_tracer == this) {
+        return *tls_tracer.last_ring;
+    }
+    for (auto& entry : tls_tracer.entries) {
+        if (entry.tracer == this && entry.state == state_) {
+            tls_tracer.last_tracer = this;
+            tls_tracer.last_ring = entry.ring.get();
+            return *entry.ring;
+        }
+    }
+    std::shared_ptr<Ring> ring;
+    {
+        auto lock = std::lock_guard(state_->mutex);
+        ring = std::make_shared<Ring>(ring_size_, static_cast<uint32_t>(state_->rings.size() + 1));
+        ring->thread_name = std::format("thread-{}", ring->tid);
+        state_->rings.emplace_back(ring);
+    }
+    tls_tracer.last_tracer = this;
+    tls_tracer.last_ring = ring.get();
+    tls_tracer.entries.emplace_back(TracerThreadLocal::Entry{ this, state_, std::move(ring) });
+    return *tls_tracer.last_ring;
+}
+
+void Tracer::Record(TraceEventType type, SessionId session_id, ServiceId service_id, ServiceId peer_service_id, const TraceContext& context, const char* msg_type_name) {
+    TraceEvent event{};
+    event.type = type;
+    event.ts_ns = MetricsNowNs();
+    event.session_id = session_id;
+    event.service_id = service_id;
+    event.peer_service_id = peer_service_id;
+    event.msg_type_name = msg_type_name;
+    event.trace_id = context.trace_id;
+    event.span_id = context.span_id;
+    event.parent_span_id = context.parent_span_id;
+    LocalRing().Push(event);
+}
+
+void Tracer::RecordSpan(const char* name, ServiceId service_id, const TraceContext& context, uint64_t begin_ns, uint64_t end_ns) {
+    TraceEvent event{};
+    event.type = TraceEventType::kSpan;
+    event.ts_ns = begin_ns;
+    event.service_id = service_id;
+    event.msg_type_name = name;
+    event.trace_id = context.trace_id;
+    event.span_id = context.span_id;
+    event.parent_span_id = context.parent_span_id;
+    event.dur_ns = end_ns > begin_ns ? end_ns - begin_ns : 0;
+    LocalRing().Push(event);
+}
+
+const TraceContext& Tracer::active_context() {
+    return tls_active_context;
+}
+
+void Tracer::set_active_context(const TraceContext& context) {
+    tls_active_context = context;
+}
+
+void Tracer::SetCurrentThreadName(std::string name) {
+    if (!enabled()) {
+        return;
+    }
+    auto& ring = LocalRing();
+    auto lock = std::lock_guard(state_->mutex);
+    ring.thread_name = std::move(name);
+}
+
+const char* Tracer::MessageTypeName(const MessagePointer& msg) {
+    if (msg.IsProtoMessage()) {
+        // 描述符的生命周期与进程一致
+        return msg.GetProtoMessage()->GetDescriptor()->full_name().c_str();
+    }
+    else if (msg.IsCppMessage()) {
+        return msg.GetCppMessage()->type().name();
+    }
+    return "unknown";
+}
+
+static void AppendJsonString(std::string* out, std::string_view str) {
+    out->push_back('"');
+    for (auto c : str) {
+        switch (c) {
+        case '"': out->append("\\\""); break;
+        case '\\': out->append("\\\\"); break;
+        case '\n': out->append("\\n"); break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20) {
+                out->append(std::format("\\u{:04x}", static_cast<unsigned char>(c)));
+            }
+            else {
+                out->push_back(c);
+            }
+            break;
+        }
+    }
+    out->push_back('"');
+}
+
+void Tracer::DumpChromeTrace(std::ostream& os, uint64_t pid) {
+    std::vector<TraceEvent> events;
+    std::vector<std::pair<uint32_t, std::string>> thread_names;
+    {
+        auto lock = std::lock_guard(state_->mutex);
+        for (auto& ring : state_->rings) {
+            ring->Collect(&events);
+            thread_names.emplace_back(ring->tid, ring->thread_name);
+        }
+    }
+    // 同一线程的事件已按写入顺序排列，稳定排序保证同一时刻的开始/结束顺序不变
+    std::stable_sort(events.begin(), events.end(), [](const TraceEvent& a, const TraceEvent& b) {
+        return a.ts_ns < b.ts_ns;
+    });
+    uint64_t base_ns = events.empty() ? 0 : events.front().ts_ns;
+
+    std::string out;
+    out.append("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+    bool first = true;
+    auto begin_event = [&] {
+        if (!first) out.append(",\n");
+        first = false;
+    };
+
+    for (auto& [tid, name] : thread_names) {
+        begin_event();
+        out.append(std::format("{{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":{},\"tid\":{},\"args\":{{\"name\":", pid, tid));
+        AppendJsonString(&out, name);
+        out.append("}}");
+    }
+
+    for (auto& event : events) {
+        // 时间单位为微秒
+        auto ts = std::format("{}.{:03}", (event.ts_ns - base_ns) / 1000, (event.ts_ns - base_ns) % 1000);
+        auto send_id = SessionReplyToSendId(event.session_id);
+        auto common = std::format("\"pid\":{},\"tid\":{},\"ts\":{}", pid, event.tid, ts);
+        auto args = std::format("\"args\":{{\"session_id\":\"{}\",\"service_id\":\"{}\",\"peer_service_id\":\"{}\",\"reply\":{}"
+            ",\"trace_id\":\"{}\",\"span_id\":\"{}\",\"parent_span_id\":\"{}\"}}",
+            send_id, event.service_id, event.peer_service_id, SessionIsReplyId(event.session_id) ? "true" : "false",
+            event.trace_id, event.span_id, event.parent_span_id);
+        // 连线事件绑定到所在线程当前正在执行的处理过程
+        auto flow = [&](std::string_view ph) {
+            begin_event();
+            out.append(std::format("{{\"name\":\"session\",\"cat\":\"million.flow\",\"ph\":\"{}\",\"id\":\"{}\",{}", ph, send_id, common));
+            if (ph != "s") out.append(",\"bp\":\"e\"");
+            out.append("}");
+        };
+
+        switch (event.type) {
+        case TraceEventType::kSend:
+        case TraceEventType::kReply: {
+            begin_event();
+            out.append("{\"name\":");
+            AppendJsonString(&out, std::format("{} {}", event.type == TraceEventType::kSend ? "Send" : "Reply", event.msg_type_name));
+            out.append(std::format(",\"cat\":\"million\",\"ph\":\"i\",\"s\":\"t\",{},{}}}", common, args));
+            // 请求发出时开始连线，回复发出时作为中间点
+            flow(event.type == TraceEventType::kSend ? "s" : "t");
+            break;
+        }
+        case TraceEventType::kProcessBegin: {
+            begin_event();
+            out.append("{\"name\":");
+            AppendJsonString(&out, event.msg_type_name);
+            out.append(std::format(",\"cat\":\"million\",\"ph\":\"B\",{},{}}}", common, args));
+            // 处理请求作为中间点，处理回复时结束连线
+            if (SessionIsReplyId(event.session_id)) {
+                flow("f");
+            }
+            else {
+                flow("t");
+            }
+            break;
+        }
+        case TraceEventType::kProcessEnd: {
+            begin_event();
+            out.append(std::format("{{\"ph\":\"E\",{}}}", common));
+            break;
+        }
+        case TraceEventType::kSpan: {
+            begin_event();
+            out.append("{\"name\":");
+            AppendJsonString(&out, event.msg_type_name);
+            out.append(std::format(",\"cat\":\"million.span\",\"ph\":\"X\",{},\"dur\":{}.{:03}"
+                ",\"args\":{{\"service_id\":\"{}\",\"trace_id\":\"{}\",\"span_id\":\"{}\",\"parent_span_id\":\"{}\"}}}}",
+                common, event.dur_ns / 1000, event.dur_ns % 1000, event.service_id, event.trace_id, event.span_id, event.parent_span_id));
+            break;
+        }
+        }
+    }
+    out.append("\n]}\n");
+    os << out;
+}
+
+bool Tracer::DumpChromeTrace(std::string_view path, uint64_t pid) {
+    std::ofstream file(std::string(path), std::ios::out | std::ios::trunc);
+    if (!file) {
+        return false;
+    }
+    DumpChromeTrace(file, pid);
+    return file.good();
+}
+
+} // namespace million
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <cstdint>
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <million/noncopyable.h>
+#include <million/session_def.h>
+#include <million/trace_def.h>
+#include <million/service_handle.h>
+#include <million/message.h>
+
+namespace million {
+
+struct TracerConfig {
+    uint32_t sample_rate = 1;       // 每sample_rate个会话采样1个，1表示全部采样
+    size_t ring_size = 16384;       // 每个线程保留的最近事件数，会向上取整为2的幂
+};
+
+enum class TraceEventType : uint32_t {
+    kSend,              // 发出请求
+    kProcessBegin,      // 开始处理消息
+    kProcessEnd,        // 处理消息结束(处理函数完成或首次挂起)
+    kReply,             // 发出回复
+    kSpan,              // 已结束的区间，如跨节点调用的一跳
+};
+
+struct TraceEvent {
+    TraceEventType type;
+    uint64_t ts_ns;
+    SessionId session_id;
+    ServiceId service_id;          // 事件发生的服务
+    ServiceId peer_service_id;     // 发送/回复的目标，或处理的消息的发送方
+    const char* msg_type_name;      // kSpan为区间名称
+    TraceId trace_id;
+    SpanId span_id;
+    SpanId parent_span_id;
+    uint64_t dur_ns;                // 仅kSpan有效
+    uint32_t tid;
+};
+
+// 消息流追踪，按会话采样，记录发送/处理/回复事件，可导出为Chrome trace(Perfetto)格式
+// 每个线程写入自己的环形缓冲区，写满后覆盖最旧的事件，导出时不阻塞写入
+class Tracer : noncopyable {
+public:
+    Tracer();
+    ~Tracer();
+
+    void Enable(const TracerConfig& config);
+    bool enabled() const { return enabled_.load(std::memory_order_relaxed); }
+
+    // 同一会话的请求与回复采样结果一致，仅在开始新链路时使用，链路中的消息沿用链路的采样结果
+    bool IsSampled(SessionId session_id) const {
+        if (!enabled()) return false;
+        if (sample_rate_ <= 1) return true;
+        auto x = SessionReplyToSendId(session_id);
+        x ^= x >> 33;
+        x *= 0xff51afd7ed558ccdULL;
+        x ^= x >> 33;
+        return x % sample_rate_ == 0;
+    }
+
+    void Record(TraceEventType type, SessionId session_id, ServiceId service_id, ServiceId peer_service_id, const TraceContext& context, const char* msg_type_name);
+    void Record(TraceEventType type, SessionId session_id, ServiceId service_id, ServiceId peer_service_id, const TraceContext& context, const MessagePointer& msg) {
+        Record(type, session_id, service_id, peer_service_id, context, MessageTypeName(msg));
+    }
+    // 记录已结束的区间，name需在进程生命周期内有效
+    void RecordSpan(const char* name, ServiceId service_id, const TraceContext& context, uint64_t begin_ns, uint64_t end_ns);
+
+    // 当前线程正在处理的消息的追踪上下文，发出的消息会携带该上下文
+    static const TraceContext& active_context();
+    static void set_active_context(const TraceContext& context);
+
+    // 设置当前线程在trace中显示的名称
+    void SetCurrentThreadName(std::string name);
+
+    // 输出Chrome trace JSON，可由chrome://tracing或ui.perfetto.dev打开
+    void DumpChromeTrace(std::ostream& os, uint64_t pid);
+    bool DumpChromeTrace(std::string_view path, uint64_t pid);
+
+    static const char* MessageTypeName(const MessagePointer& msg);
+
+private:
+    struct Ring;
+    struct State;
+    friend struct TracerThreadLocal;
+
+    Ring& LocalRing();
+
+private:
+    std::atomic<bool> enabled_ = false;
+    uint32_t sample_rate_ = 1;
+    size_t ring_size_ = 0;
+    std::shared_ptr<State> state_;
+};
+
+} // namespace million
@@ -1,44 +1,163 @@
 #include "worker.h"
 
 #include <iostream>
+#include <format>
+
+#include <million/metrics.h>
 
 #include "million.h"
 #include "service_mgr.h"
 #include "service_core.h"
+#include "worker_mgr.h"
+#include "tracer.h"
 
 namespace million {
 
-Worker::Worker(Million* million)
-    : million_(million) {}
+static thread_local Worker* tls_worker = nullptr;
+
+Worker::Worker(Million* million, size_t index)
+    : million_(million)
+    , index_(index) {}
 
 Worker::~Worker() = default;
 
+Worker* Worker::current() {
+    return tls_worker;
+}
+
 void Worker::Start() {
+    run_ = true;
     thread_.emplace([this]() {
-        run_ = true;
-        auto& service_mgr = million_->service_mgr();
-        while (run_) {
-            auto service = service_mgr.PopService();
-            if (!service) break;
-            // std::cout << "workid:" <<  std::this_thread::get_id() << std::endl;
-            service->ProcessMsgs(1);
-            // 可以将service放到队列了
-            service->set_in_queue(false);
-            if (!service->MsgQueueIsEmpty()) {
-                service_mgr.PushService(service);
-                continue;
-            }
-            if (service->IsExited()) {
-                // 服务已退出，销毁
-                service_mgr.DeleteService(service);
-            }
+        tls_worker = this;
+        million_->tracer().SetCurrentThreadName(std::format("worker-{}", index_));
+        if (million_->worker_mgr().shard_mode()) {
+            ShardLoop();
+        }
+        else {
+            SharedLoop();
         }
+        tls_worker = nullptr;
     });
 }
 
 void Worker::Stop() {
     run_ = false;
+    WakeUp();
     thread_.reset();
 }
 
-} // namespace million
\ No newline at end of file
+void Worker::ProcessService(ServiceCore* service) {
+    if constexpr (!kMetricsEnabled) {
+        service->ProcessMsgs(1);
+    }
+    else {
+        auto begin_ns = MetricsNowNs();
+        service->ProcessMsgs(1);
+        busy_ns_.fetch_add(MetricsNowNs() - begin_ns, std::memory_order_relaxed);
+    }
+}
+
+void Worker::SharedLoop() {
+    auto& service_mgr = million_->service_mgr();
+    while (run_) {
+        auto service = service_mgr.PopService();
+        if (!service) break;
+        // std::cout << "workid:" <<  std::this_thread::get_id() << std::endl;
+        ProcessService(service);
+        service_mgr.ReleaseService(service);
+    }
+}
+
+void Worker::ShardLoop() {
+    auto& service_mgr = million_->service_mgr();
+    while (run_) {
+        auto service = PopShardService();
+        if (!service) {
+            Park();
+            continue;
+        }
+        ProcessService(service);
+        // 服务固定属于当前分片，重新投递时会直接进入local_queue_
+        service_mgr.ReleaseService(service);
+    }
+}
+
+void Worker::PushService(ServiceCore* service) {
+    auto& worker_mgr = million_->worker_mgr();
+    auto* current = tls_worker;
+    if (current == this) {
+        // 分片内投递，无需同步
+        local_queue_.emplace_back(service);
+        return;
+    }
+    bool pushed = false;
+    if (current) {
+        // 跨分片投递，走发送方worker到当前worker的单生产者单消费者队列
+        pushed = worker_mgr.ring(current->index(), index_).TryPush(std::move(service));
+    }
+    if (!pushed) {
+        auto lock = std::lock_guard(external_queue_mutex_);
+        external_queue_.emplace_back(service);
+    }
+    // 投递与读取休眠标记之间需要全屏障，与Park中的屏障配对
+    // 否则环形队列的写入可能晚于休眠标记的读取，双方都看不到对方而丢失唤醒
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    // 仅在目标worker休眠时才需要唤醒
+    if (sleeping_.load(std::memory_order_relaxed)) {
+        WakeUp();
+    }
+}
+
+ServiceCore* Worker::PopShardService() {
+    if (local_queue_.empty()) {
+        // 收取其他分片投递过来的服务
+        auto& worker_mgr = million_->worker_mgr();
+        for (size_t i = 0; i < worker_mgr.worker_num(); ++i) {
+            if (i == index_) continue;
+            auto& ring = worker_mgr.ring(i, index_);
+            while (auto service = ring.TryPop()) {
+                local_queue_.emplace_back(*service);
+            }
+        }
+        {
+            auto lock = std::lock_guard(external_queue_mutex_);
+            std::swap(backup_external_queue_, external_queue_);
+        }
+        local_queue_.insert(local_queue_.end(), backup_external_queue_.begin(), backup_external_queue_.end());
+        backup_external_queue_.clear();
+    }
+    if (local_queue_.empty()) {
+        return nullptr;
+    }
+    auto service = local_queue_.front();
+    local_queue_.pop_front();
+    return service;
+}
+
+void Worker::Park() {
+    auto& worker_mgr = million_->worker_mgr();
+    auto lock = std::unique_lock(external_queue_mutex_);
+    // 先标记休眠再检查队列，与PushService中先投递再检查休眠标记配合，避免丢失唤醒
+    sleeping_.store(true, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    auto has_service = [&] {
+        if (!run_ || !external_queue_.empty()) {
+            return true;
+        }
+        for (size_t i = 0; i < worker_mgr.worker_num(); ++i) {
+            if (i != index_ && !worker_mgr.ring(i, index_).Empty()) {
+                return true;
+            }
+        }
+        return false;
+    };
+    external_queue_cv_.wait(lock, has_service);
+    sleeping_.store(false);
+}
+
+void Worker::WakeUp() {
+    auto lock = std::lock_guard(external_queue_mutex_);
+    external_queue_cv_.notify_one();
+}
+
+} // namespace million
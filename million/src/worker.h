@@ -3,24 +3,68 @@
 #include <memory>
 #include <thread>
 #include <optional>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <vector>
 
 #include <million/noncopyable.h>
 
+#include "handler_watchdog.h"
+
 namespace million {
 
 class Million;
+class ServiceCore;
 class Worker : noncopyable {
 public:
-    Worker(Million* million);
+    Worker(Million* million, size_t index);
     ~Worker();
 
     void Start();
     void Stop();
 
+    /** 分片模式下，将服务投递到当前worker，可由任意线程调用 */
+    void PushService(ServiceCore* service);
+
+    size_t index() const { return index_; }
+    /** 累计处理服务的耗时(纳秒)，仅在开启指标统计时记录 */
+    uint64_t busy_ns() const { return busy_ns_.load(std::memory_order_relaxed); }
+
+    /** 当前正在执行的处理函数，供看门狗检查 */
+    HandlerWatchSlot& watch_slot() { return watch_slot_; }
+    std::thread::native_handle_type native_handle() { return thread_->native_handle(); }
+
+    /** 获取当前线程所属的worker，非worker线程返回nullptr */
+    static Worker* current();
+
+private:
+    void SharedLoop();
+    void ShardLoop();
+
+    void ProcessService(ServiceCore* service);
+    ServiceCore* PopShardService();
+    void Park();
+    void WakeUp();
+
 private:
     Million* million_;
+    size_t index_;
     std::optional<std::jthread> thread_;
-    bool run_ = false;
+    std::atomic<bool> run_ = false;
+
+    // 分片模式下，本分片内投递的服务，仅由当前worker线程访问
+    std::deque<ServiceCore*> local_queue_;
+
+    // 分片模式下，来自非worker线程(io、定时器等)或跨分片环形队列已满时的投递
+    std::mutex external_queue_mutex_;
+    std::vector<ServiceCore*> external_queue_;
+    std::vector<ServiceCore*> backup_external_queue_;
+    std::condition_variable external_queue_cv_;
+    std::atomic<bool> sleeping_ = false;
+    std::atomic<uint64_t> busy_ns_ = 0;
+    HandlerWatchSlot watch_slot_;
 };
 
-} // namespace million
\ No newline at end of file
+} // namespace million
@@ -1,17 +1,28 @@
 #include "worker_mgr.h"
 
+#include <cassert>
+
 #include "worker.h"
+#include "service_core.h"
 
 namespace million {
 
-WorkerMgr::WorkerMgr(Million* million, size_t worker_num)
-    : million_(million) {
+WorkerMgr::WorkerMgr(Million* million, size_t worker_num, bool shard_mode, size_t shard_ring_size)
+    : million_(million)
+    , shard_mode_(shard_mode) {
     if (worker_num == 0) {
         worker_num = std::thread::hardware_concurrency();
     }
     workers_.reserve(worker_num);
     for (size_t i = 0; i < worker_num; ++i) {
-        workers_.emplace_back(std::make_unique<Worker>(million_));
+        workers_.emplace_back(std::make_unique<Worker>(million_, i));
+    }
+    if (shard_mode_) {
+        // 每对分片一条环形队列，from == to的位置不使用
+        rings_.reserve(worker_num * worker_num);
+        for (size_t i = 0; i < worker_num * worker_num; ++i) {
+            rings_.emplace_back(std::make_unique<internal::SpscRing<ServiceCore*>>(shard_ring_size));
+        }
     }
 }
 
@@ -21,12 +32,34 @@ void WorkerMgr::Start() {
     for (auto& worker : workers_) {
         worker->Start();
     }
+    if (rebalancer_) {
+        rebalancer_->Start();
+    }
 }
 
 void WorkerMgr::Stop() {
+    if (rebalancer_) {
+        rebalancer_->Stop();
+    }
     for (auto& worker : workers_) {
         worker->Stop();
     }
 }
 
-} // namespace million
\ No newline at end of file
+void WorkerMgr::EnableRebalance(const ShardRebalanceConfig& config) {
+    assert(shard_mode_);
+    rebalancer_ = std::make_unique<ShardRebalancer>(million_, config);
+}
+
+size_t WorkerMgr::SelectShard(ServiceId service_id) const {
+    return std::hash<ServiceId>()(service_id) % workers_.size();
+}
+
+void WorkerMgr::PushService(ServiceCore* service) {
+    assert(shard_mode_);
+    auto shard_id = service->shard_id();
+    assert(shard_id < workers_.size());
+    workers_[shard_id]->PushService(service);
+}
+
+} // namespace million
@@ -4,22 +4,54 @@
 #include <vector>
 
 #include <million/noncopyable.h>
+#include <million/service_handle.h>
+
+#include "internal/spsc_ring.hpp"
+#include "shard_rebalancer.h"
 
 namespace million {
 
 class Million;
 class Worker;
+class ServiceCore;
 class WorkerMgr : noncopyable {
 public:
-    WorkerMgr(Million* million, size_t worker_num);
+    /** 
+     * \param shard_mode 分片模式下，每个worker固定处理一组服务，分片间通过单生产者单消费者队列投递
+     * \param shard_ring_size 分片间环形队列的容量
+     */
+    WorkerMgr(Million* million, size_t worker_num, bool shard_mode = false, size_t shard_ring_size = 1024);
     ~WorkerMgr();
 
     void Start();
     void Stop();
 
+    bool shard_mode() const { return shard_mode_; }
+    size_t worker_num() const { return workers_.size(); }
+    Worker& worker(size_t index) { return *workers_[index]; }
+
+    /** 按服务id哈希选择分片 */
+    size_t SelectShard(ServiceId service_id) const;
+
+    /** 分片模式下，开启分片间的负载均衡 */
+    void EnableRebalance(const ShardRebalanceConfig& config);
+    /** 未开启负载均衡时返回nullptr */
+    ShardRebalancer* rebalancer() { return rebalancer_.get(); }
+
+    /** 分片模式下，将服务投递到其所属的worker */
+    void PushService(ServiceCore* service);
+
+    /** from分片投递到to分片的环形队列 */
+    internal::SpscRing<ServiceCore*>& ring(size_t from, size_t to) {
+        return *rings_[from * workers_.size() + to];
+    }
+
 private:
     Million* million_;
+    bool shard_mode_;
     std::vector<std::unique_ptr<Worker>> workers_;
+    std::vector<std::unique_ptr<internal::SpscRing<ServiceCore*>>> rings_;
+    std::unique_ptr<ShardRebalancer> rebalancer_;
 };
 
-} // namespace million
\ No newline at end of file
+} // namespace million
@@ -13,6 +13,11 @@ namespace cluster {
 
 MILLION_MESSAGE_DEFINE_NONCOPYABLE(MILLION_CLUSTER_API, ClusterSendMessage, (ModuleCode) target_service_name_id, (ProtoMessageUnique) proto_msg);
 MILLION_MESSAGE_DEFINE_NONCOPYABLE(MILLION_CLUSTER_API, ClusterCallMessage, (ModuleCode) target_service_name_id, (ProtoMessageUnique) proto_msg);
+// cpp_msg需在两端通过IMillion::cpp_codec()以相同的名称注册，目标的回复也可以是已注册的CppMessage
+MILLION_MESSAGE_DEFINE_NONCOPYABLE(MILLION_CLUSTER_API, ClusterSendCppMessage, (ModuleCode) target_service_name_id, (CppMessageUnique) cpp_msg);
+MILLION_MESSAGE_DEFINE_NONCOPYABLE(MILLION_CLUSTER_API, ClusterCallCppMessage, (ModuleCode) target_service_name_id, (CppMessageUnique) cpp_msg);
+// 目标节点无法将回复发回时(如回复类型未注册)，代替回复发给调用方
+MILLION_MESSAGE_DEFINE(MILLION_CLUSTER_API, ClusterCallErrorMessage, (std::string) error);
 
 // Cluster.Call返回一个Task<ProtoMsgUnique>，通过co_return 将proto_msg返回回来
 // Cluster.Call内部：
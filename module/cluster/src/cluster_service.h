@@ -1,5 +1,10 @@
 #pragma once
 
+#include <algorithm>
+#include <limits>
+#include <map>
+#include <optional>
+
 #include <yaml-cpp/yaml.h>
 
 #include <million/cluster/ss_cluster.pb.h>
@@ -16,6 +21,12 @@ MILLION_MESSAGE_DEFINE(, ClusterTcpRecvPacketMsg, (NodeSessionShared) node_sessi
 
 using NodeServiceSessionId = uint64_t;
 
+// 跨节点转发的消息体，protobuf消息由ProtoCodec编码，CppMessage由CppMessageCodec编码
+struct ClusterMessageBody {
+    const ProtoMessage* proto_msg = nullptr;
+    const CppMessage* cpp_msg = nullptr;
+};
+
 
 // 队列这里还有问题，如果目标一直没有回复，那么队列中的包还需要清理，需要添加定时任务来清理
 
@@ -88,6 +99,11 @@ public:
         // 加载服务配置
         LoadServicesFromConfig(cluster_settings);
 
+        auto& metrics = imillion().metrics();
+        bytes_sent_metric_ = metrics.RegisterCounter("million_cluster_bytes_sent_total", "Bytes sent to other nodes.");
+        bytes_received_metric_ = metrics.RegisterCounter("million_cluster_bytes_received_total", "Bytes received from other nodes.");
+        call_rtt_metric_ = metrics.RegisterHistogram("million_cluster_call_rtt_ns", "Round trip time of cross-node calls.");
+
         return true;
     }
 
@@ -113,6 +129,7 @@ public:
 
     MILLION_MESSAGE_HANDLE(ClusterTcpRecvPacketMsg, msg) {
         auto& node_session = *msg->node_session;
+        imillion().metrics().Add(bytes_received_metric_, msg->packet.size());
 
         auto& ep = node_session.remote_endpoint();
         auto ip = ep.address().to_string();
@@ -165,15 +182,29 @@ public:
 
     MILLION_MESSAGE_HANDLE(ClusterSendMessage, msg) {
         const auto& target_service_name = msg->target_service_name_id;
-        const auto& proto_msg = msg->proto_msg;
-        HandleClusterCallOrSendMessage(sender, session_id, std::move(msg_), target_service_name, proto_msg, &ClusterService::SendClusterSendNotify);
+        auto body = ClusterMessageBody{ .proto_msg = msg->proto_msg.get() };
+        HandleClusterCallOrSendMessage(sender, session_id, std::move(msg_), msg_deadline(), target_service_name, body, &ClusterService::SendClusterSendNotify);
         co_return nullptr;
     }
 
     MILLION_MESSAGE_HANDLE(ClusterCallMessage, msg) {
         const auto& target_service_name = msg->target_service_name_id;
-        const auto& proto_msg = msg->proto_msg;
-        HandleClusterCallOrSendMessage(sender, session_id, std::move(msg_), target_service_name, proto_msg, &ClusterService::SendClusterCallNotify);
+        auto body = ClusterMessageBody{ .proto_msg = msg->proto_msg.get() };
+        HandleClusterCallOrSendMessage(sender, session_id, std::move(msg_), msg_deadline(), target_service_name, body, &ClusterService::SendClusterCallNotify);
+        co_return nullptr;
+    }
+
+    MILLION_MESSAGE_HANDLE(ClusterSendCppMessage, msg) {
+        const auto& target_service_name = msg->target_service_name_id;
+        auto body = ClusterMessageBody{ .cpp_msg = msg->cpp_msg.get() };
+        HandleClusterCallOrSendMessage(sender, session_id, std::move(msg_), msg_deadline(), target_service_name, body, &ClusterService::SendClusterSendNotify);
+        co_return nullptr;
+    }
+
+    MILLION_MESSAGE_HANDLE(ClusterCallCppMessage, msg) {
+        const auto& target_service_name = msg->target_service_name_id;
+        auto body = ClusterMessageBody{ .cpp_msg = msg->cpp_msg.get() };
+        HandleClusterCallOrSendMessage(sender, session_id, std::move(msg_), msg_deadline(), target_service_name, body, &ClusterService::SendClusterCallNotify);
         co_return nullptr;
     }
 
@@ -230,6 +261,8 @@ private:
 
         auto& queue_vector = queue.vector();
         for (auto iter = queue_vector.begin(); iter != queue_vector.end(); ++iter) {
+            set_msg_deadline(iter->deadline());
+            imillion().SetTraceContext(iter->trace_context());
             co_await MessageDispatch(iter->sender(), iter->session_id(), std::move(iter->message()));
         }
 
@@ -249,17 +282,25 @@ private:
             co_return;
         }
 
+        auto trace_context = RestoreTraceContext(notify.has_trace(), notify.trace());
+        auto begin_ns = trace_context.sampled ? MetricsNowNs() : 0;
+
         auto span = net::PacketSpan(
            packet.begin() + sizeof(header_size) + header_size,
             packet.end());
 
         // 将消息转发给本机节点的其他服务
-        auto res = imillion().proto_mgr().codec().DecodeMessage(span);
-        if (!res) {
+        auto body_msg = DecodeMessageBody(notify.cpp_message(), span);
+        if (!body_msg) {
             co_return;
         }
 
-        imillion().SendTo(service_handle(), *target_service_handle, session_id, std::move(res->msg));
+        auto deadline = kSessionDeadlineNone;
+        if (notify.timeout_ms() > 0) {
+            deadline = SessionNowMs() + notify.timeout_ms();
+        }
+        imillion().SendTo(service_handle(), *target_service_handle, session_id, std::move(body_msg), deadline);
+        imillion().RecordTraceSpan("cluster.recv_send", service_id(), trace_context, begin_ns, MetricsNowNs());
         co_return;
     }
     
@@ -285,25 +326,34 @@ private:
             co_return;
         }
 
+        // 本节点处理该请求的一跳，从收到请求到发出回复
+        auto trace_context = RestoreTraceContext(notify.has_trace(), notify.trace());
+        auto begin_ns = trace_context.sampled ? MetricsNowNs() : 0;
+
         auto span = net::PacketSpan(
             packet.begin() + sizeof(header_size) + header_size,
             packet.end());
 
         // 将消息转发给本机节点的其他服务
-        auto res = imillion().proto_mgr().codec().DecodeMessage(span);
-        if (!res) {
+        auto body_msg = DecodeMessageBody(notify.cpp_message(), span);
+        if (!body_msg) {
             co_return;
         }
 
-        imillion().SendTo(service_handle(), *target_service_handle, session_id, std::move(res->msg));
+        // 按剩余处理时间恢复截止时间，不依赖节点间的时钟同步
+        auto deadline = kSessionDeadlineNone;
+        if (notify.timeout_ms() > 0) {
+            deadline = SessionNowMs() + notify.timeout_ms();
+        }
+        imillion().SendTo(service_handle(), *target_service_handle, session_id, std::move(body_msg), deadline);
 
         // 回包
         auto recv_msg = co_await Recv(session_id);
         logger().LOG_TRACE("Cluster Recv ProtoMessage: {}.", session_id);
 
-        auto proto_msg = std::move(recv_msg.GetProtoMessage());
         SendClusterReplyNotify(node_session.get(), target_service_handle->get_ptr(lock)->service_id()
-            , src_service_id, session_id, *proto_msg);
+            , src_service_id, session_id, ToMessageBody(recv_msg));
+        imillion().RecordTraceSpan("cluster.serve_call", service_id(), trace_context, begin_ns, MetricsNowNs());
         co_return;
     }
 
@@ -312,6 +362,21 @@ private:
         auto src_service_id = notify.src_service_id();
         auto target_service_id = notify.target_service_id();
         auto session_id = notify.session_id();
+        auto iter = pending_calls_.find(session_id);
+        if (iter != pending_calls_.end()) {
+            // 本节点发起调用的一跳，从发出请求到收到回复
+            auto now_ns = MetricsNowNs();
+            if constexpr (kMetricsEnabled) {
+                imillion().metrics().Record(call_rtt_metric_, now_ns - iter->second.send_ns);
+            }
+            imillion().RecordTraceSpan("cluster.call", service_id(), iter->second.trace_context, iter->second.send_ns, now_ns);
+            pending_call_order_.erase(iter->second.order_iter);
+            pending_calls_.erase(iter);
+        }
+        // 回复沿用对端的链路
+        if (notify.has_trace()) {
+            imillion().SetTraceContext(FromProtoTraceContext(notify.trace()));
+        }
         auto target_service_handle = imillion().FindServiceById(notify.target_service_id());
         if (!target_service_handle) {
             auto& ep = node_session->remote_endpoint();
@@ -325,20 +390,25 @@ private:
             packet.end());
 
         // 将消息转发给本机节点的其他服务
-        auto res = imillion().proto_mgr().codec().DecodeMessage(span);
-        if (!res) {
+        if (!notify.error().empty()) {
+            logger().LOG_WARN("Cluster call failed on the remote node, session_id:{}, error:{}", session_id, notify.error());
+            Reply(*target_service_handle, session_id, make_message<ClusterCallErrorMessage>(notify.error()));
+            co_return;
+        }
+        auto body_msg = DecodeMessageBody(notify.cpp_message(), span);
+        if (!body_msg) {
             co_return;
         }
 
-        Reply(*target_service_handle, session_id, std::move(res->msg));
+        Reply(*target_service_handle, session_id, std::move(body_msg));
         co_return;
     }
 
-    using SendNotifyFunction = void (ClusterService::*)(NodeSession*, ServiceId, ModuleCode, SessionId, const ProtoMessage&);
+    using SendNotifyFunction = void (ClusterService::*)(NodeSession*, ServiceId, ModuleCode, SessionId, SessionDeadline, const ClusterMessageBody&);
     
     // send_notify_function传入成员函数指针，选择性调用SendClusterSendNotify或者SendClusterCallNotify
-    Task<void> HandleClusterCallOrSendMessage(const ServiceHandle& sender, SessionId session_id, MessagePointer&& msg_,
-        ModuleCode target_service_name_id, const ProtoMessageUnique& proto_msg, SendNotifyFunction send_notify_function) {
+    Task<void> HandleClusterCallOrSendMessage(const ServiceHandle& sender, SessionId session_id, MessagePointer&& msg_, SessionDeadline deadline,
+        ModuleCode target_service_name_id, ClusterMessageBody body, SendNotifyFunction send_notify_function) {
         auto sender_lock = sender.lock();
         if (!sender_lock) {
             co_return;
@@ -349,7 +419,7 @@ private:
         auto node_session_iter = service_name_to_node_session_.find(target_service_name_id);
         if (node_session_iter != service_name_to_node_session_.end()) {
             auto node_session = node_session_iter->second;
-            (this->*send_notify_function)(node_session, sender_ptr->service_id(), target_service_name_id, session_id, *proto_msg);
+            (this->*send_notify_function)(node_session, sender_ptr->service_id(), target_service_name_id, session_id, deadline, body);
             co_return;
         }
 
@@ -398,7 +468,7 @@ private:
         }
 
         // 把正处于握手状态的需要send的所有包放到队列里，在握手完成时统一发包
-        res.first->second.vector().emplace_back(sender, session_id, std::move(msg_));
+        res.first->second.vector().emplace_back(sender, session_id, std::move(msg_), deadline, imillion().GetTraceContext());
         co_return;
     }
 
@@ -529,6 +599,67 @@ private:
     }
 
 
+    static void ToProtoTraceContext(const TraceContext& context, ss::TraceContext* proto) {
+        proto->set_trace_id(context.trace_id);
+        proto->set_parent_span_id(context.span_id);
+        proto->set_sampled(context.sampled);
+    }
+
+    // 对端发送方所在的span，作为本节点span的父span
+    static TraceContext FromProtoTraceContext(const ss::TraceContext& proto) {
+        return TraceContext{ proto.trace_id(), proto.parent_span_id(), kSpanIdInvalid, proto.sampled() };
+    }
+
+    // 以对端的span为父span开始本节点的一跳，并设为当前上下文，之后转发的消息都归属于这一跳
+    TraceContext RestoreTraceContext(bool has_trace, const ss::TraceContext& proto) {
+        if (!has_trace || !imillion().TraceEnabled()) {
+            return TraceContext();
+        }
+        auto context = FromProtoTraceContext(proto).ChildOf(imillion().NewSession());
+        imillion().SetTraceContext(context);
+        return context;
+    }
+
+    static ClusterMessageBody ToMessageBody(const MessagePointer& msg) {
+        if (msg.IsProtoMessage()) {
+            return ClusterMessageBody{ .proto_msg = msg.GetProtoMessage() };
+        }
+        if (msg.IsCppMessage()) {
+            return ClusterMessageBody{ .cpp_msg = msg.GetCppMessage() };
+        }
+        return ClusterMessageBody();
+    }
+
+    std::optional<net::Packet> EncodeMessageBody(const ClusterMessageBody& body) {
+        if (body.proto_msg) {
+            return imillion().proto_mgr().codec().EncodeMessage(*body.proto_msg);
+        }
+        if (body.cpp_msg) {
+            auto packet = imillion().cpp_codec().EncodeMessage(*body.cpp_msg);
+            if (!packet) {
+                logger().LOG_ERROR("Unregistered cpp message: {}.", body.cpp_msg->type().name());
+            }
+            return packet;
+        }
+        return std::nullopt;
+    }
+
+    MessagePointer DecodeMessageBody(bool cpp_message, net::PacketSpan span) {
+        if (cpp_message) {
+            auto msg = imillion().cpp_codec().DecodeMessage(span);
+            if (!msg) {
+                logger().LOG_WARN("Invalid cpp message, size: {}.", span.size());
+                return nullptr;
+            }
+            return MessagePointer(std::move(msg));
+        }
+        auto res = imillion().proto_mgr().codec().DecodeMessage(span);
+        if (!res) {
+            return nullptr;
+        }
+        return std::move(res->msg);
+    }
+
     void PacketHeaderInit(NodeSession* node_session, const net::Packet& header_packet, const net::Packet& forward_packet) {
         uint32_t header_size = header_packet.size();
         header_size = asio::detail::socket_ops::host_to_network_long(header_size);
@@ -538,13 +669,32 @@ private:
 
         auto size_span = net::PacketSpan(size_packet);
         auto total_size = sizeof(header_size) + header_packet.size() + forward_packet.size();
+        imillion().metrics().Add(bytes_sent_metric_, total_size);
 
         node_session->Send(std::move(size_packet), size_span, total_size);
     }
 
 
-    void SendClusterSendNotify(NodeSession* node_session, ServiceId src_service_id, ModuleCode target_service_name_id, SessionId session_id, const ProtoMessage& msg) {
-        auto packet_opt = imillion().proto_mgr().codec().EncodeMessage(msg);
+    // 截止时间换算为剩余的处理时间，已超时返回nullopt，0表示无截止时间
+    static std::optional<uint32_t> RemainingTimeoutMs(SessionDeadline deadline) {
+        if (deadline == kSessionDeadlineNone) {
+            return 0;
+        }
+        auto now = SessionNowMs();
+        if (now >= deadline) {
+            return std::nullopt;
+        }
+        return static_cast<uint32_t>(std::min<SessionDeadline>(deadline - now, std::numeric_limits<uint32_t>::max()));
+    }
+
+    void SendClusterSendNotify(NodeSession* node_session, ServiceId src_service_id, ModuleCode target_service_name_id, SessionId session_id, SessionDeadline deadline, const ClusterMessageBody& body) {
+        auto timeout_ms = RemainingTimeoutMs(deadline);
+        if (!timeout_ms) {
+            // 已超过截止时间，无需再发往目标节点
+            return;
+        }
+
+        auto packet_opt = EncodeMessageBody(body);
         if (!packet_opt) {
             return;
         }
@@ -556,6 +706,12 @@ private:
         header->set_src_service_id(src_service_id);
         header->set_target_service_name_id(target_service_name_id);
         header->set_session_id(session_id);
+        header->set_timeout_ms(*timeout_ms);
+        header->set_cpp_message(body.cpp_msg != nullptr);
+        auto trace_context = imillion().GetTraceContext();
+        if (trace_context.valid()) {
+            ToProtoTraceContext(trace_context, header->mutable_trace());
+        }
         auto header_packet = ProtoMsgToPacket(msg_body);
         
         PacketHeaderInit(node_session, header_packet, packet);
@@ -567,8 +723,14 @@ private:
         node_session->Send(std::move(packet), span, 0);
     }
     
-    void SendClusterCallNotify(NodeSession* node_session, ServiceId src_service_id, ModuleCode target_service_name_id, SessionId session_id, const ProtoMessage& msg) {
-        auto packet_opt = imillion().proto_mgr().codec().EncodeMessage(msg);
+    void SendClusterCallNotify(NodeSession* node_session, ServiceId src_service_id, ModuleCode target_service_name_id, SessionId session_id, SessionDeadline deadline, const ClusterMessageBody& body) {
+        auto timeout_ms = RemainingTimeoutMs(deadline);
+        if (!timeout_ms) {
+            // 请求方已超时，无需再发往目标节点
+            return;
+        }
+
+        auto packet_opt = EncodeMessageBody(body);
         if (!packet_opt) {
             return;
         }
@@ -580,8 +742,31 @@ private:
         header->set_src_service_id(src_service_id);
         header->set_target_service_name_id(target_service_name_id);
         header->set_session_id(session_id);
+        header->set_timeout_ms(*timeout_ms);
+        header->set_cpp_message(body.cpp_msg != nullptr);
+        auto trace_context = imillion().GetTraceContext();
+        if (trace_context.valid()) {
+            ToProtoTraceContext(trace_context, header->mutable_trace());
+        }
         auto header_packet = ProtoMsgToPacket(msg_body);
 
+        if (kMetricsEnabled || trace_context.sampled) {
+            auto send_ns = MetricsNowNs();
+            auto iter = pending_calls_.find(session_id);
+            if (iter != pending_calls_.end()) {
+                pending_call_order_.erase(iter->second.order_iter);
+                pending_calls_.erase(iter);
+            }
+            // 对端不回复时记录会残留，超过上限淘汰最早发出的，只影响这些长时间未回复的采样
+            while (pending_calls_.size() >= kMaxPendingCallSamples) {
+                auto oldest = pending_call_order_.begin();
+                pending_calls_.erase(oldest->second);
+                pending_call_order_.erase(oldest);
+            }
+            auto order_iter = pending_call_order_.emplace(send_ns, session_id);
+            pending_calls_.emplace(session_id, PendingCall{ send_ns, trace_context, order_iter });
+        }
+
         PacketHeaderInit(node_session, header_packet, packet);
 
         auto header_span = net::PacketSpan(header_packet);
@@ -591,10 +776,21 @@ private:
         node_session->Send(std::move(packet), span, 0);
     }
 
-    void SendClusterReplyNotify(NodeSession* node_session, ServiceId src_service_id, ServiceId target_service_id, SessionId session_id, const ProtoMessage& msg) {
-        auto packet_opt = imillion().proto_mgr().codec().EncodeMessage(msg);
+    void SendClusterReplyNotify(NodeSession* node_session, ServiceId src_service_id, ServiceId target_service_id, SessionId session_id, const ClusterMessageBody& body) {
+        // 回复无法编码时，改为回复错误，避免调用方一直等到超时
+        std::string error;
+        auto packet_opt = EncodeMessageBody(body);
         if (!packet_opt) {
-            return;
+            if (body.cpp_msg) {
+                error = std::format("unregistered reply message: {}.", body.cpp_msg->type().name());
+            }
+            else if (body.proto_msg) {
+                error = std::format("cannot encode reply message: {}.", body.proto_msg->GetDescriptor()->full_name());
+            }
+            else {
+                error = "empty reply message.";
+            }
+            packet_opt.emplace();
         }
         auto packet = std::move(*packet_opt);
 
@@ -604,6 +800,12 @@ private:
         header->set_src_service_id(src_service_id);
         header->set_target_service_id(target_service_id);
         header->set_session_id(session_id);
+        header->set_cpp_message(body.cpp_msg != nullptr);
+        header->set_error(std::move(error));
+        auto trace_context = imillion().GetTraceContext();
+        if (trace_context.valid()) {
+            ToProtoTraceContext(trace_context, header->mutable_trace());
+        }
         auto header_packet = ProtoMsgToPacket(msg_body);
 
         PacketHeaderInit(node_session, header_packet, packet);
@@ -611,6 +813,9 @@ private:
         auto header_span = net::PacketSpan(header_packet);
         node_session->Send(std::move(header_packet), header_span, 0);
 
+        if (packet.empty()) {
+            return;
+        }
         auto span = net::PacketSpan(packet);
         node_session->Send(std::move(packet), span, 0);
     }
@@ -624,8 +829,23 @@ private:
     std::unordered_map<NodeId, NodeSessionShared> nodes_;
 
     // 握手阶段，待发送的消息队列
-    std::mutex node_session_message_queue_map_mutex_;
+    ProfiledMutex node_session_message_queue_map_mutex_{ "cluster.node_session_message_queue_map" };
     std::unordered_map<std::string, NodeSessionMessageQueue> node_session_message_queue_map_;
+
+    MetricId bytes_sent_metric_ = kMetricIdInvalid;
+    MetricId bytes_received_metric_ = kMetricIdInvalid;
+    MetricId call_rtt_metric_ = kMetricIdInvalid;
+    // 跨节点调用的发出时间及所在链路，用于统计往返耗时
+    using PendingCallOrder = std::multimap<uint64_t, SessionId>;
+    struct PendingCall {
+        uint64_t send_ns;
+        TraceContext trace_context;
+        PendingCallOrder::iterator order_iter;
+    };
+    static constexpr size_t kMaxPendingCallSamples = 65536;
+    std::unordered_map<SessionId, PendingCall> pending_calls_;
+    // 按发出时间排序，超过上限时从最早的开始淘汰
+    PendingCallOrder pending_call_order_;
 };
 
 } // namespace cluster
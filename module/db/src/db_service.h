@@ -75,6 +75,9 @@ public:
         }
         cache_service_ = *handle;
 
+        cache_hit_metric_ = imillion().metrics().RegisterCounter("million_db_row_cache_hits_total", "Primary key queries served from the local row cache.");
+        cache_miss_metric_ = imillion().metrics().RegisterCounter("million_db_row_cache_misses_total", "Primary key queries that missed the local row cache.");
+
         return true;
     }
 
@@ -182,6 +185,7 @@ private:
         // 如果是主键查询，可以走本地缓存
         if (key_field_number == options.primary_key()) {
             auto db_row_cache = LocalQueryDBRow(desc, key_field_number, key);
+            imillion().metrics().Add(db_row_cache ? cache_hit_metric_ : cache_miss_metric_);
             if (db_row_cache) {
                 // 如果找到了，就直接返回
                 if (!db_row_cache->tick) {
@@ -289,6 +293,9 @@ private:
     ServiceHandle cache_service_;
     ServiceHandle sql_service_;
 
+    MetricId cache_hit_metric_ = kMetricIdInvalid;
+    MetricId cache_miss_metric_ = kMetricIdInvalid;
+
     // 回写可以负载均衡，避免出现多个回写挤在同一秒进行
 };
 
@@ -70,6 +70,11 @@ public:
         user = db_user.as<std::string>();
         password = db_password.as<std::string>();
 
+        auto& metrics = imillion().metrics();
+        query_latency_metric_ = metrics.RegisterHistogram("million_db_sql_query_latency_ns", "Latency of SQL SELECT statements.");
+        insert_latency_metric_ = metrics.RegisterHistogram("million_db_sql_insert_latency_ns", "Latency of SQL INSERT statements.");
+        update_latency_metric_ = metrics.RegisterHistogram("million_db_sql_update_latency_ns", "Latency of SQL UPDATE statements.");
+
         return true;
     }
 
@@ -306,7 +311,9 @@ public:
 
         // Prepare SQL statement and bind primary key value
         auto key = msg->key.ToString();
+        auto begin_ns = MetricsNowNs();
         soci::rowset<soci::row> rs = (sql_.prepare << sql, soci::use(key, key_field_desc->name()));
+        imillion().metrics().Record(query_latency_metric_, MetricsNowNs() - begin_ns);
 
         auto it = rs.begin();
         if (it == rs.end()) {
@@ -455,7 +462,9 @@ public:
         BindValuesToStatement(db_row, &values, stmt);
         stmt.define_and_bind();
 
+        auto begin_ns = MetricsNowNs();
         stmt.execute(true);
+        imillion().metrics().Record(insert_latency_metric_, MetricsNowNs() - begin_ns);
         auto rows = stmt.get_affected_rows();
         msg->success = rows > 0;
 
@@ -516,7 +525,9 @@ public:
         BindValuesToStatement(db_row, &values, stmt);
         stmt.define_and_bind();
 
+        auto begin_ns = MetricsNowNs();
         stmt.execute(true);
+        imillion().metrics().Record(update_latency_metric_, MetricsNowNs() - begin_ns);
         auto rows = stmt.get_affected_rows();
 
         co_return make_message<SqlUpdateResp>(rows > 0);
@@ -704,6 +715,10 @@ private:
 
 private:
     soci::session sql_;
+
+    MetricId query_latency_metric_ = kMetricIdInvalid;
+    MetricId insert_latency_metric_ = kMetricIdInvalid;
+    MetricId update_latency_metric_ = kMetricIdInvalid;
 };
 
 } // namespace db
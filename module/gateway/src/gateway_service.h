@@ -32,6 +32,11 @@ public:
         , server_(imillion) { }
 
     virtual bool OnInit() override {
+        // 指标注册表的生命周期长于服务，计数单独共享
+        imillion().metrics().RegisterGauge("million_gateway_connections", "Established gateway connections.", [connection_count = connection_count_] {
+            return static_cast<double>(connection_count->load(std::memory_order_relaxed));
+        });
+        connection_total_metric_ = imillion().metrics().RegisterCounter("million_gateway_connections_total", "Gateway connections accepted.");
         return imillion().SetServiceNameId(service_handle(), module::module_id, ss::ServiceNameId_descriptor(), ss::SERVICE_NAME_ID_GATEWAY);
     }
 
@@ -71,18 +76,22 @@ public:
             // imillion().SendTo(sender, service_handle(), session_id, std::move(recv_msg));
             if (recv_msg.IsProtoMessage()) {
                 logger().LOG_TRACE("Gateway Recv ProtoMessage: {}.", session_id);
-                auto header_packet = net::Packet(kGatewayHeaderSize);
-
                 auto proto_msg = std::move(recv_msg.GetProtoMessage());
-                auto packet = imillion().proto_mgr().codec().EncodeMessage(*proto_msg);
-                if (!packet) {
+
+                // 长度、头部、消息键及消息体写入同一个缓冲区
+                auto& codec = imillion().proto_mgr().codec();
+                auto byte_size = proto_msg->ByteSizeLong();
+                uint32_t total_size = kGatewayHeaderSize + ProtoCodec::EncodedSize(byte_size);
+                auto packet = user_session.AcquirePacket(sizeof(total_size) + total_size);
+                auto len = asio::detail::socket_ops::host_to_network_long(total_size);
+                std::memcpy(packet.data(), &len, sizeof(len));
+                std::memset(packet.data() + sizeof(len), 0, kGatewayHeaderSize);
+                if (!codec.EncodeMessageTo(*proto_msg, byte_size, packet.data() + sizeof(len) + kGatewayHeaderSize)) {
                     logger().LOG_ERROR("Gateway Recv ProtoMessage EncodeMessage failed: {}.", session_id);
                     continue;
                 }
-                auto span = net::PacketSpan(header_packet);
-                user_session.Send(std::move(header_packet), span, header_packet.size() + packet->size());
-                span = net::PacketSpan(*packet);
-                user_session.Send(std::move(*packet), span, 0);
+                auto span = net::PacketSpan(packet);
+                user_session.Send(std::move(packet), span, 0);
             }
             else if (recv_msg.IsType<GatewaySendPacket>()) {
                 logger().LOG_TRACE("GatewaySendPacket: {}.", session_id);
@@ -121,12 +130,15 @@ public:
             // 开启持久会话，这里设计上，Send 创建的 session_id，则视作 agent_id
             auto agent_id = Send<GatewayPersistentUserSession>(service_handle(), std::move(msg->user_session));
             user_session.set_agent_id(agent_id.value());
+            connection_count_->fetch_add(1, std::memory_order_relaxed);
+            imillion().metrics().Add(connection_total_metric_);
 
             logger().LOG_DEBUG("Gateway connection establishment, agent_id:{}, ip: {}, port: {}", user_session.agent_id(), ip, port);
         }
         else {
             // 停止持久会话
             Reply<GatewayPersistentUserSession>(service_handle(), user_session.agent_id(), std::move(msg->user_session));
+            connection_count_->fetch_sub(1, std::memory_order_relaxed);
 
             logger().LOG_DEBUG("Gateway Disconnection: ip: {}, port: {}", ip, port);
         }
@@ -187,6 +199,9 @@ private:
     TokenGenerator token_generator_;
     ServiceHandle user_service_;
 
+    std::shared_ptr<std::atomic<int64_t>> connection_count_ = std::make_shared<std::atomic<int64_t>>(0);
+    MetricId connection_total_metric_ = kMetricIdInvalid;
+
     static constexpr uint32_t kGatewayHeaderSize = 8;
 };
 
@@ -0,0 +1,379 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+#include <format>
+#include <istream>
+#include <iterator>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <variant>
+#include <vector>
+
+namespace million {
+namespace logger {
+namespace binlog {
+
+// 二进制日志文件格式(小端)
+// 文件头: "MLOG" + u32版本，之后为连续的块: u8类型 + u32长度 + 内容
+// 字符串为u32长度 + 内容
+//
+// kStart:   进程开始写入该文件，之前的字典作废(同一文件可被多次启动追加)
+// kSite:    u32 site_id, u8 level, u32 line, str file, str function, str fmt, str arg_types
+// kService: u64 service_id, str type
+// kRecord:  u32 site_id, i64 time_ns, u64 thread_id, u64 service_id, 编码后的参数(见million/log_record.h)
+// kText:    u8 level, i64 time_ns, u64 thread_id, u64 service_id, u32 line, str file, str function, str msg
+//
+// 日志位置及服务在首次出现时写入字典，记录只保存id及未格式化的参数
+constexpr char kMagic[4] = { 'M', 'L', 'O', 'G' };
+constexpr uint32_t kVersion = 1;
+
+enum class ChunkType : uint8_t {
+    kStart = 1,
+    kSite = 2,
+    kService = 3,
+    kRecord = 4,
+    kText = 5,
+};
+
+constexpr size_t kChunkHeaderSize = sizeof(uint8_t) + sizeof(uint32_t);
+
+// 与文本日志(spdlog)的级别名称一致
+constexpr std::string_view kLevelNames[] = { "trace", "debug", "info", "warning", "error", "critical", "off" };
+
+inline std::string_view LevelName(uint8_t level) {
+    return level < std::size(kLevelNames) ? kLevelNames[level] : "unknown";
+}
+
+inline std::optional<uint8_t> LevelFromName(std::string_view name) {
+    for (uint8_t i = 0; i < std::size(kLevelNames); ++i) {
+        if (kLevelNames[i] == name) return i;
+    }
+    // 兼容简写
+    if (name == "warn") return LevelFromName("warning");
+    return std::nullopt;
+}
+
+struct Site {
+    uint8_t level = 0;
+    uint32_t line = 0;
+    std::string file;
+    std::string function;
+    std::string fmt;
+    std::string arg_types;
+};
+
+// 解码后的一条日志
+struct Entry {
+    uint8_t level = 0;
+    int64_t time_ns = 0;
+    uint64_t thread_id = 0;
+    uint64_t service_id = 0;
+    std::string_view service_type;
+    std::string_view file;
+    uint32_t line = 0;
+    std::string_view function;
+    std::string msg;
+};
+
+// 按arg_types解码参数，再按fmt逐个替换字段
+// 仅支持自动及手动编号的替换字段，格式说明中的嵌套替换字段(如动态宽度)原样输出
+class ArgFormatter {
+public:
+    using Arg = std::variant<bool, char, int64_t, uint64_t, double, const void*, std::nullptr_t, std::string_view>;
+
+    static bool DecodeArgs(std::string_view arg_types, const uint8_t* data, size_t size, std::vector<Arg>* args) {
+        args->clear();
+        size_t pos = 0;
+        auto read = [&](void* out, size_t len) {
+            if (pos + len > size) return false;
+            std::memcpy(out, data + pos, len);
+            pos += len;
+            return true;
+        };
+        for (size_t i = 0; i + 1 < arg_types.size(); i += 2) {
+            auto kind = arg_types[i];
+            size_t len = static_cast<uint8_t>(arg_types[i + 1] - '0');
+            switch (kind) {
+            case 'b': {
+                bool value;
+                if (!read(&value, sizeof(value))) return false;
+                args->emplace_back(value);
+                break;
+            }
+            case 'c': {
+                char value;
+                if (!read(&value, sizeof(value))) return false;
+                args->emplace_back(value);
+                break;
+            }
+            case 'i': {
+                if (len > sizeof(int64_t)) return false;
+                uint64_t raw = 0;
+                if (!read(&raw, len)) return false;
+                // 符号扩展
+                auto shift = (sizeof(uint64_t) - len) * 8;
+                args->emplace_back(static_cast<int64_t>(raw << shift) >> shift);
+                break;
+            }
+            case 'u': {
+                if (len > sizeof(uint64_t)) return false;
+                uint64_t value = 0;
+                if (!read(&value, len)) return false;
+                args->emplace_back(value);
+                break;
+            }
+            case 'f': {
+                if (len == sizeof(float)) {
+                    float value;
+                    if (!read(&value, len)) return false;
+                    args->emplace_back(static_cast<double>(value));
+                }
+                else if (len == sizeof(double)) {
+                    double value;
+                    if (!read(&value, len)) return false;
+                    args->emplace_back(value);
+                }
+                else {
+                    // long double的表示与平台相关，无法离线解码
+                    pos += len;
+                    args->emplace_back(std::string_view("<long double>"));
+                }
+                break;
+            }
+            case 'p': {
+                uint64_t raw = 0;
+                if (len > sizeof(raw) || !read(&raw, len)) return false;
+                args->emplace_back(reinterpret_cast<const void*>(static_cast<uintptr_t>(raw)));
+                break;
+            }
+            case 'n': {
+                pos += len;
+                args->emplace_back(nullptr);
+                break;
+            }
+            case 's': {
+                uint32_t str_len;
+                if (!read(&str_len, sizeof(str_len)) || pos + str_len > size) return false;
+                args->emplace_back(std::string_view(reinterpret_cast<const char*>(data + pos), str_len));
+                pos += str_len;
+                break;
+            }
+            default:
+                return false;
+            }
+        }
+        return true;
+    }
+
+    static std::string Format(std::string_view fmt, const std::vector<Arg>& args) {
+        std::string out;
+        size_t next_index = 0;
+        for (size_t i = 0; i < fmt.size(); ++i) {
+            auto c = fmt[i];
+            if (c == '}' && i + 1 < fmt.size() && fmt[i + 1] == '}') {
+                out.push_back('}');
+                ++i;
+                continue;
+            }
+            if (c != '{') {
+                out.push_back(c);
+                continue;
+            }
+            if (i + 1 < fmt.size() && fmt[i + 1] == '{') {
+                out.push_back('{');
+                ++i;
+                continue;
+            }
+            auto end = fmt.find('}', i);
+            if (end == std::string_view::npos) {
+                out.append(fmt.substr(i));
+                break;
+            }
+            auto field = fmt.substr(i + 1, end - i - 1);
+            auto colon = field.find(':');
+            auto id = field.substr(0, colon);
+            auto spec = colon == std::string_view::npos ? std::string_view() : field.substr(colon);
+            size_t index = next_index++;
+            if (!id.empty()) {
+                index = 0;
+                for (auto d : id) {
+                    if (d < '0' || d > '9') {
+                        index = args.size();
+                        break;
+                    }
+                    index = index * 10 + (d - '0');
+                }
+            }
+            if (index >= args.size() || spec.find('{') != std::string_view::npos) {
+                out.append(fmt.substr(i, end - i + 1));
+            }
+            else {
+                FormatArg(&out, spec, args[index]);
+            }
+            i = end;
+        }
+        return out;
+    }
+
+private:
+    static void FormatArg(std::string* out, std::string_view spec, const Arg& arg) {
+        auto arg_fmt = std::string("{") + std::string(spec) + "}";
+        try {
+            std::visit([&](const auto& value) {
+                std::vformat_to(std::back_inserter(*out), arg_fmt, std::make_format_args(value));
+            }, arg);
+        }
+        catch (const std::format_error&) {
+            out->append(arg_fmt);
+        }
+    }
+};
+
+// 顺序读取二进制日志文件
+class Reader {
+public:
+    explicit Reader(std::istream* in)
+        : in_(in) {}
+
+    // 返回false表示文件头不正确
+    bool ReadHeader() {
+        char magic[sizeof(kMagic)];
+        uint32_t version;
+        if (!in_->read(magic, sizeof(magic)) || std::memcmp(magic, kMagic, sizeof(kMagic)) != 0) {
+            return false;
+        }
+        if (!in_->read(reinterpret_cast<char*>(&version), sizeof(version)) || version != kVersion) {
+            return false;
+        }
+        return true;
+    }
+
+    // 读取下一条日志，到达文件末尾或文件损坏时返回false，可通过error()区分
+    bool Next(Entry* entry) {
+        while (true) {
+            uint8_t type;
+            uint32_t size;
+            if (!in_->read(reinterpret_cast<char*>(&type), sizeof(type))) {
+                return false;
+            }
+            if (!in_->read(reinterpret_cast<char*>(&size), sizeof(size))) {
+                return Fail("truncated chunk header");
+            }
+            chunk_.resize(size);
+            if (!in_->read(reinterpret_cast<char*>(chunk_.data()), size)) {
+                // 进程退出时可能未写完最后一块
+                return Fail("truncated chunk");
+            }
+            pos_ = 0;
+            switch (static_cast<ChunkType>(type)) {
+            case ChunkType::kStart:
+                sites_.clear();
+                services_.clear();
+                break;
+            case ChunkType::kSite: {
+                uint32_t site_id;
+                Site site;
+                if (!Read(&site_id) || !Read(&site.level) || !Read(&site.line) || !ReadString(&site.file)
+                    || !ReadString(&site.function) || !ReadString(&site.fmt) || !ReadString(&site.arg_types)) {
+                    return Fail("bad site chunk");
+                }
+                sites_[site_id] = std::move(site);
+                break;
+            }
+            case ChunkType::kService: {
+                uint64_t service_id;
+                std::string service_type;
+                if (!Read(&service_id) || !ReadString(&service_type)) {
+                    return Fail("bad service chunk");
+                }
+                services_[service_id] = std::move(service_type);
+                break;
+            }
+            case ChunkType::kRecord: {
+                uint32_t site_id;
+                if (!Read(&site_id) || !Read(&entry->time_ns) || !Read(&entry->thread_id) || !Read(&entry->service_id)) {
+                    return Fail("bad record chunk");
+                }
+                auto iter = sites_.find(site_id);
+                if (iter == sites_.end()) {
+                    return Fail(std::format("unknown site id: {}", site_id));
+                }
+                auto& site = iter->second;
+                entry->level = site.level;
+                entry->file = site.file;
+                entry->line = site.line;
+                entry->function = site.function;
+                entry->service_type = ServiceType(entry->service_id);
+                if (ArgFormatter::DecodeArgs(site.arg_types, chunk_.data() + pos_, chunk_.size() - pos_, &args_)) {
+                    entry->msg = ArgFormatter::Format(site.fmt, args_);
+                }
+                else {
+                    entry->msg = std::format("<bad args, fmt: {}>", site.fmt);
+                }
+                return true;
+            }
+            case ChunkType::kText: {
+                if (!Read(&entry->level) || !Read(&entry->time_ns) || !Read(&entry->thread_id) || !Read(&entry->service_id)
+                    || !Read(&entry->line) || !ReadString(&text_file_) || !ReadString(&text_function_) || !ReadString(&entry->msg)) {
+                    return Fail("bad text chunk");
+                }
+                entry->file = text_file_;
+                entry->function = text_function_;
+                entry->service_type = ServiceType(entry->service_id);
+                return true;
+            }
+            default:
+                // 跳过未知类型的块，便于向后兼容
+                break;
+            }
+        }
+    }
+
+    const std::string& error() const { return error_; }
+
+private:
+    template <typename T>
+    bool Read(T* value) {
+        if (pos_ + sizeof(T) > chunk_.size()) return false;
+        std::memcpy(value, chunk_.data() + pos_, sizeof(T));
+        pos_ += sizeof(T);
+        return true;
+    }
+
+    bool ReadString(std::string* value) {
+        uint32_t size;
+        if (!Read(&size) || pos_ + size > chunk_.size()) return false;
+        value->assign(reinterpret_cast<const char*>(chunk_.data() + pos_), size);
+        pos_ += size;
+        return true;
+    }
+
+    std::string_view ServiceType(uint64_t service_id) const {
+        auto iter = services_.find(service_id);
+        return iter == services_.end() ? std::string_view() : std::string_view(iter->second);
+    }
+
+    bool Fail(std::string error) {
+        error_ = std::move(error);
+        return false;
+    }
+
+private:
+    std::istream* in_;
+    std::vector<uint8_t> chunk_;
+    size_t pos_ = 0;
+    std::unordered_map<uint32_t, Site> sites_;
+    std::unordered_map<uint64_t, std::string> services_;
+    std::vector<ArgFormatter::Arg> args_;
+    std::string text_file_;
+    std::string text_function_;
+    std::string error_;
+};
+
+} // namespace binlog
+} // namespace logger
+} // namespace million
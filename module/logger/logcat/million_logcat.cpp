@@ -0,0 +1,189 @@
+#include <cstdint>
+
+#include <chrono>
+#include <ctime>
+#include <format>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+#include <million/logger/binary_log.h>
+
+namespace binlog = million::logger::binlog;
+
+struct Filter {
+    uint8_t min_level = 0;
+    std::optional<int64_t> since_ns;
+    std::optional<int64_t> until_ns;
+    // 服务id或服务类型名的子串
+    std::string service;
+};
+
+static void PrintUsage() {
+    std::cout << "usage: million_logcat [--json] [--level <trace|debug|info|warning|error|critical>]" << std::endl
+        << "                      [--service <id|type>] [--since <time>] [--until <time>] <file>..." << std::endl
+        << "time: 'YYYY-MM-DD HH:MM:SS' or 'YYYY-MM-DDTHH:MM:SS' in local time, or seconds since epoch" << std::endl;
+}
+
+static std::optional<int64_t> ParseTime(const std::string& str) {
+    if (!str.empty() && str.find_first_not_of("0123456789") == std::string::npos) {
+        return std::stoll(str) * 1000000000;
+    }
+    std::tm tm = {};
+    std::istringstream in(str);
+    in >> std::get_time(&tm, str.find('T') != std::string::npos ? "%Y-%m-%dT%H:%M:%S" : "%Y-%m-%d %H:%M:%S");
+    if (in.fail()) {
+        return std::nullopt;
+    }
+    tm.tm_isdst = -1;
+    return static_cast<int64_t>(std::mktime(&tm)) * 1000000000;
+}
+
+static std::string FormatTime(int64_t time_ns) {
+    auto time = static_cast<std::time_t>(time_ns / 1000000000);
+    std::tm tm;
+#ifdef _WIN32
+    localtime_s(&tm, &time);
+#else
+    localtime_r(&time, &tm);
+#endif
+    return std::format("{:04}-{:02}-{:02} {:02}:{:02}:{:02}.{:03}", tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday
+        , tm.tm_hour, tm.tm_min, tm.tm_sec, (time_ns / 1000000) % 1000);
+}
+
+static bool Match(const Filter& filter, const binlog::Entry& entry) {
+    if (entry.level < filter.min_level) return false;
+    if (filter.since_ns && entry.time_ns < *filter.since_ns) return false;
+    if (filter.until_ns && entry.time_ns > *filter.until_ns) return false;
+    if (!filter.service.empty()) {
+        if (std::to_string(entry.service_id) != filter.service && entry.service_type.find(filter.service) == std::string_view::npos) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static std::string_view FileName(std::string_view path) {
+    auto pos = path.find_last_of("/\\");
+    return pos == std::string_view::npos ? path : path.substr(pos + 1);
+}
+
+// 与日志服务默认的文本格式一致，附加服务信息
+static void PrintText(const binlog::Entry& entry) {
+    std::string service;
+    if (entry.service_id != 0) {
+        service = std::format(" [{}#{}]", entry.service_type, entry.service_id);
+    }
+    std::cout << std::format("[{}] [tid {}] [{}] [{}:{}] [{}]{} {}\n", FormatTime(entry.time_ns), entry.thread_id
+        , binlog::LevelName(entry.level), FileName(entry.file), entry.line, entry.function, service, entry.msg);
+}
+
+static void PrintJson(const binlog::Entry& entry) {
+    nlohmann::json json;
+    json["time"] = FormatTime(entry.time_ns);
+    json["time_ns"] = entry.time_ns;
+    json["tid"] = entry.thread_id;
+    json["level"] = binlog::LevelName(entry.level);
+    json["file"] = entry.file;
+    json["line"] = entry.line;
+    json["function"] = entry.function;
+    if (entry.service_id != 0) {
+        json["service_id"] = entry.service_id;
+        json["service_type"] = entry.service_type;
+    }
+    // 参数中的字符串可能不是合法的utf-8
+    json["msg"] = entry.msg;
+    std::cout << json.dump(-1, ' ', false, nlohmann::json::error_handler_t::replace) << '\n';
+}
+
+static bool Decode(const std::string& path, const Filter& filter, bool json) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        std::cerr << "open '" << path << "' failed." << std::endl;
+        return false;
+    }
+    binlog::Reader reader(&file);
+    if (!reader.ReadHeader()) {
+        std::cerr << "'" << path << "' is not a million binary log." << std::endl;
+        return false;
+    }
+    binlog::Entry entry;
+    while (reader.Next(&entry)) {
+        if (!Match(filter, entry)) {
+            continue;
+        }
+        if (json) {
+            PrintJson(entry);
+        }
+        else {
+            PrintText(entry);
+        }
+    }
+    if (!reader.error().empty()) {
+        std::cerr << "'" << path << "': " << reader.error() << std::endl;
+    }
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    Filter filter;
+    bool json = false;
+    std::vector<std::string> files;
+    for (int i = 1; i < argc; ++i) {
+        std::string_view arg = argv[i];
+        if (arg == "--json") {
+            json = true;
+            continue;
+        }
+        if (!arg.starts_with("--")) {
+            files.emplace_back(arg);
+            continue;
+        }
+        if (i + 1 >= argc) {
+            PrintUsage();
+            return 1;
+        }
+        std::string value = argv[++i];
+        if (arg == "--level") {
+            auto level = binlog::LevelFromName(value);
+            if (!level) {
+                std::cerr << "invalid level: " << value << std::endl;
+                return 1;
+            }
+            filter.min_level = *level;
+        }
+        else if (arg == "--service") {
+            filter.service = std::move(value);
+        }
+        else if (arg == "--since" || arg == "--until") {
+            auto time = ParseTime(value);
+            if (!time) {
+                std::cerr << "invalid time: " << value << std::endl;
+                return 1;
+            }
+            (arg == "--since" ? filter.since_ns : filter.until_ns) = time;
+        }
+        else {
+            PrintUsage();
+            return 1;
+        }
+    }
+    if (files.empty()) {
+        PrintUsage();
+        return 1;
+    }
+
+    bool ok = true;
+    for (auto& path : files) {
+        ok = Decode(path, filter, json) && ok;
+    }
+    std::cout.flush();
+    return ok ? 0 : 1;
+}
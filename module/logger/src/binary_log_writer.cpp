@@ -0,0 +1,176 @@
+#include "binary_log_writer.h"
+
+#include <cstring>
+#include <ctime>
+#include <filesystem>
+#include <format>
+
+namespace million {
+namespace logger {
+
+// 缓冲超过该大小时立即写入文件
+constexpr size_t kFlushThreshold = 64 * 1024;
+
+static int64_t ToNs(std::chrono::system_clock::time_point time) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count();
+}
+
+BinaryLogWriter::BinaryLogWriter(std::string base_path)
+    : base_path_(std::move(base_path)) {}
+
+BinaryLogWriter::~BinaryLogWriter() {
+    Flush();
+}
+
+void BinaryLogWriter::WriteRecord(const LogRecordInfo& record, std::span<const uint8_t> args) {
+    auto lock = std::lock_guard(mutex_);
+    Prepare(&record);
+    BeginChunk(binlog::ChunkType::kRecord);
+    Put(record.site_id);
+    Put(ToNs(record.time));
+    Put(static_cast<uint64_t>(record.thread_id));
+    Put(static_cast<uint64_t>(record.service_id));
+    buffer_.insert(buffer_.end(), args.begin(), args.end());
+    EndChunk();
+}
+
+void BinaryLogWriter::WriteText(const LogRecordInfo& record, std::string_view msg) {
+    auto lock = std::lock_guard(mutex_);
+    Prepare(&record);
+    BeginChunk(binlog::ChunkType::kText);
+    Put(static_cast<uint8_t>(record.site->level));
+    Put(ToNs(record.time));
+    Put(static_cast<uint64_t>(record.thread_id));
+    Put(static_cast<uint64_t>(record.service_id));
+    Put(record.site->line);
+    PutString(record.site->file_name);
+    PutString(record.site->function_name);
+    PutString(msg);
+    EndChunk();
+}
+
+void BinaryLogWriter::WriteText(Logger::LogLevel level, std::chrono::system_clock::time_point time, size_t thread_id
+    , std::string_view file, uint32_t line, std::string_view function, std::string_view msg)
+{
+    auto lock = std::lock_guard(mutex_);
+    Prepare(nullptr);
+    BeginChunk(binlog::ChunkType::kText);
+    Put(static_cast<uint8_t>(level));
+    Put(ToNs(time));
+    Put(static_cast<uint64_t>(thread_id));
+    Put(uint64_t(0));
+    Put(line);
+    PutString(file);
+    PutString(function);
+    PutString(msg);
+    EndChunk();
+}
+
+void BinaryLogWriter::Flush() {
+    auto lock = std::lock_guard(mutex_);
+    FlushLocked();
+    if (file_.is_open()) {
+        file_.flush();
+    }
+}
+
+void BinaryLogWriter::Prepare(const LogRecordInfo* record) {
+    // 按写入时的时间切分，各线程的记录时间在整点附近可能交错
+    auto hour = std::chrono::duration_cast<std::chrono::hours>(std::chrono::system_clock::now().time_since_epoch()).count();
+    if (hour != hour_) {
+        Rotate(hour);
+    }
+    if (!record) {
+        return;
+    }
+    // 首次出现的位置及服务先写入字典
+    if (record->site_id >= written_sites_.size()) {
+        written_sites_.resize(record->site_id + 1);
+    }
+    if (!written_sites_[record->site_id]) {
+        written_sites_[record->site_id] = true;
+        auto& site = *record->site;
+        BeginChunk(binlog::ChunkType::kSite);
+        Put(record->site_id);
+        Put(static_cast<uint8_t>(site.level));
+        Put(site.line);
+        PutString(site.file_name);
+        PutString(site.function_name);
+        PutString(site.fmt);
+        PutString(site.arg_types);
+        EndChunk();
+    }
+    if (record->service_type && written_services_.insert(record->service_id).second) {
+        BeginChunk(binlog::ChunkType::kService);
+        Put(static_cast<uint64_t>(record->service_id));
+        PutString(record->service_type);
+        EndChunk();
+    }
+}
+
+void BinaryLogWriter::Rotate(int64_t hour) {
+    FlushLocked();
+    file_.close();
+    hour_ = hour;
+    written_sites_.clear();
+    written_services_.clear();
+
+    // 与spdlog的hourly_file_sink一致，按本地时间命名
+    auto time = static_cast<std::time_t>(hour * 3600);
+    std::tm tm;
+#ifdef _WIN32
+    localtime_s(&tm, &time);
+#else
+    localtime_r(&time, &tm);
+#endif
+    std::filesystem::path path(base_path_);
+    auto file_name = std::format("{}_{:04}-{:02}-{:02}_{:02}{}", path.stem().string()
+        , tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday, tm.tm_hour, path.extension().string());
+    path.replace_filename(file_name);
+    if (path.has_parent_path()) {
+        std::error_code ec;
+        std::filesystem::create_directories(path.parent_path(), ec);
+    }
+
+    bool exists = std::filesystem::exists(path) && std::filesystem::file_size(path) > 0;
+    file_.open(path, std::ios::binary | std::ios::app);
+    if (!exists) {
+        buffer_.insert(buffer_.end(), std::begin(binlog::kMagic), std::end(binlog::kMagic));
+        Put(binlog::kVersion);
+    }
+    // 追加到已有文件时，之前写入的字典由kStart作废
+    BeginChunk(binlog::ChunkType::kStart);
+    EndChunk();
+}
+
+void BinaryLogWriter::FlushLocked() {
+    if (buffer_.empty()) {
+        return;
+    }
+    if (file_.is_open()) {
+        file_.write(reinterpret_cast<const char*>(buffer_.data()), buffer_.size());
+    }
+    buffer_.clear();
+}
+
+void BinaryLogWriter::BeginChunk(binlog::ChunkType type) {
+    Put(static_cast<uint8_t>(type));
+    chunk_begin_ = buffer_.size();
+    Put(uint32_t(0));
+}
+
+void BinaryLogWriter::EndChunk() {
+    auto size = static_cast<uint32_t>(buffer_.size() - chunk_begin_ - sizeof(uint32_t));
+    std::memcpy(&buffer_[chunk_begin_], &size, sizeof(size));
+    if (buffer_.size() >= kFlushThreshold) {
+        FlushLocked();
+    }
+}
+
+void BinaryLogWriter::PutString(std::string_view value) {
+    Put(static_cast<uint32_t>(value.size()));
+    buffer_.insert(buffer_.end(), value.begin(), value.end());
+}
+
+} // namespace logger
+} // namespace million
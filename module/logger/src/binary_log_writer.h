@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstdint>
+
+#include <chrono>
+#include <fstream>
+#include <mutex>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+#include <million/logger.h>
+#include <million/logger/binary_log.h>
+
+namespace million {
+namespace logger {
+
+// 二进制日志文件，按小时切分，文件名为<base>_YYYY-MM-DD_HH<ext>
+// 后台线程、溢出时的同步写入及日志服务会并发写入，内部加锁
+class BinaryLogWriter {
+public:
+    explicit BinaryLogWriter(std::string base_path);
+    ~BinaryLogWriter();
+
+    void WriteRecord(const LogRecordInfo& record, std::span<const uint8_t> args);
+    void WriteText(const LogRecordInfo& record, std::string_view msg);
+    void WriteText(Logger::LogLevel level, std::chrono::system_clock::time_point time, size_t thread_id
+        , std::string_view file, uint32_t line, std::string_view function, std::string_view msg);
+
+    // 将缓冲的数据写入文件
+    void Flush();
+
+private:
+    // 按需切分文件，并写入记录引用的字典
+    void Prepare(const LogRecordInfo* record);
+    void Rotate(int64_t hour);
+    void FlushLocked();
+
+    void BeginChunk(binlog::ChunkType type);
+    void EndChunk();
+
+    template <typename T>
+    void Put(const T& value) {
+        auto begin = reinterpret_cast<const uint8_t*>(&value);
+        buffer_.insert(buffer_.end(), begin, begin + sizeof(T));
+    }
+    void PutString(std::string_view value);
+
+private:
+    std::mutex mutex_;
+    std::string base_path_;
+    std::ofstream file_;
+    int64_t hour_ = -1;
+    std::vector<uint8_t> buffer_;
+    size_t chunk_begin_ = 0;
+    // 当前文件中已写入字典的位置及服务
+    std::vector<bool> written_sites_;
+    std::unordered_set<ServiceId> written_services_;
+};
+
+} // namespace logger
+} // namespace million
@@ -1,6 +1,7 @@
 #include <iostream>
 #include <fstream>
 #include <filesystem>
+#include <optional>
 
 #include <yaml-cpp/yaml.h>
 
@@ -12,6 +13,8 @@
 #include <million/imillion.h>
 #include <million/logger/api.h>
 
+#include "binary_log_writer.h"
+
 MILLION_MODULE_INIT();
 
 namespace million {
@@ -25,6 +28,72 @@ static_assert(static_cast<uint32_t>(Logger::LogLevel::kError) == spdlog::level::
 static_assert(static_cast<uint32_t>(Logger::LogLevel::kCritical) == spdlog::level::level_enum::critical);
 static_assert(static_cast<uint32_t>(Logger::LogLevel::kOff) == spdlog::level::level_enum::off);
 
+// 异步日志的后台线程、溢出时的同步写入、日志服务及spdlog的定时flush会并发访问，logger及sink均使用_mt版本
+// 开启二进制日志时，文件只写入未格式化的参数，spdlog只保留控制台输出
+class LoggerSink : public LogSink {
+public:
+    void Init(std::shared_ptr<spdlog::logger> logger, BinaryLogWriter* binary) {
+        logger_ = std::move(logger);
+        binary_ = binary;
+    }
+
+    virtual void Write(const LogRecordInfo& record, std::string_view msg) override {
+        if (binary_ && record.text_only) {
+            binary_->WriteText(record, msg);
+        }
+        auto& site = *record.site;
+        auto level = static_cast<spdlog::level::level_enum>(site.level);
+        if (!logger_->should_log(level)) {
+            return;
+        }
+        spdlog::details::log_msg log_msg(record.time, spdlog::source_loc(site.file_name, site.line, site.function_name.c_str())
+            , logger_->name(), level, spdlog::string_view_t(msg.data(), msg.size()));
+        log_msg.thread_id = record.thread_id;
+        // 保留写日志线程的id及时间，直接写入各sink
+        for (auto& sink : logger_->sinks()) {
+            if (sink->should_log(level)) {
+                sink->log(log_msg);
+            }
+        }
+    }
+
+    virtual bool WantsArgs() const override {
+        return binary_ != nullptr;
+    }
+
+    virtual void WriteArgs(const LogRecordInfo& record, std::span<const uint8_t> args) override {
+        binary_->WriteRecord(record, args);
+    }
+
+    // 没有sink需要该级别的文本时跳过格式化
+    virtual bool WantsText(const LogSite& site) const override {
+        auto level = static_cast<spdlog::level::level_enum>(site.level);
+        if (!logger_->should_log(level)) {
+            return false;
+        }
+        for (auto& sink : logger_->sinks()) {
+            if (sink->should_log(level)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    virtual void Flush() override {
+        if (binary_) binary_->Flush();
+    }
+
+    virtual size_t CurrentThreadId() override {
+        return spdlog::details::os::thread_id();
+    }
+
+private:
+    std::shared_ptr<spdlog::logger> logger_;
+    BinaryLogWriter* binary_ = nullptr;
+};
+
+MILLION_MESSAGE_DEFINE(, LoggerSuppressTick, (uint32_t) tick);
+
 class LoggerService : public IService {
     MILLION_SERVICE_DEFINE(LoggerService);
 
@@ -32,6 +101,11 @@ public:
     using Base = IService;
     using Base::Base;
 
+    virtual ~LoggerService() override {
+        // 后台线程会回调sink，需在服务销毁前停止
+        logger().StopAsync();
+    }
+
     virtual bool OnInit() override {
         auto& settings = imillion().YamlSettings();
 
@@ -71,11 +145,28 @@ public:
             console_level = spdlog::level::from_str(level_str);;
         }
 
-        logger_ = spdlog::hourly_logger_st("logger", log_file, 0, 0);
+        if (!LoadAsyncSettings(logger_settings)) {
+            return false;
+        }
+        if (!LoadBinarySettings(logger_settings)) {
+            return false;
+        }
+        if (!LoadRateLimitSettings(logger_settings)) {
+            return false;
+        }
+
+        if (binary_) {
+            logger_ = std::make_shared<spdlog::logger>("logger");
+            spdlog::register_logger(logger_);
+        }
+        else {
+            logger_ = spdlog::hourly_logger_mt("logger", log_file, 0, 0);
+        }
         logger_->set_level(level);
         logger_->set_pattern(pattern);
+        logger().UpdateLevel(static_cast<Logger::LogLevel>(level));
 
-        auto console_sink = std::make_shared<spdlog::sinks::stdout_color_sink_st>();
+        auto console_sink = std::make_shared<spdlog::sinks::stdout_color_sink_mt>();
         console_sink->set_level(console_level);
         console_sink->set_pattern(pattern);
 
@@ -83,16 +174,26 @@ public:
 
         spdlog::flush_every(std::chrono::seconds(flush_every));
 
+        sink_.Init(logger_, binary_.get());
+
         return true;
     }
 
     virtual Task<MessagePointer> OnStart(ServiceHandle sender, SessionId session_id, MessagePointer with_msg) override {
         logger().BindService(service_handle());
+        if (async_options_) {
+            logger().StartAsync(&sink_, *async_options_);
+        }
+        if (summary_interval_tick_ > 0) {
+            Timeout<LoggerSuppressTick>(summary_interval_tick_, summary_interval_tick_);
+        }
         co_return nullptr;
     }
 
     virtual Task<MessagePointer> OnStop(ServiceHandle sender, SessionId session_id, MessagePointer with_msg) override {
+        logger().StopAsync();
         logger_->flush();
+        if (binary_) binary_->Flush();
         co_return nullptr;
     }
 
@@ -101,6 +202,10 @@ public:
         auto level = static_cast<spdlog::level::level_enum>(msg->level);
         std::string short_func = logger().ExtractFunctionName(msg->source.function_name());
         logger_->log(spdlog::source_loc(msg->source.file_name(), msg->source.line(), short_func.c_str()), level, msg->msg);
+        if (binary_ && logger_->should_log(level)) {
+            binary_->WriteText(msg->level, std::chrono::system_clock::now(), spdlog::details::os::thread_id()
+                , msg->source.file_name(), msg->source.line(), short_func, msg->msg);
+        }
         co_return nullptr;
     }
 
@@ -108,17 +213,125 @@ public:
         auto level = static_cast<spdlog::level::level_enum>(msg->level);
         std::string short_func = logger().ExtractFunctionName(msg->source.function_name);
         logger_->log(spdlog::source_loc(msg->source.file_name.c_str(), msg->source.line, short_func.c_str()), level, msg->msg);
+        if (binary_ && logger_->should_log(level)) {
+            binary_->WriteText(msg->level, std::chrono::system_clock::now(), spdlog::details::os::thread_id()
+                , msg->source.file_name, msg->source.line, short_func, msg->msg);
+        }
+        co_return nullptr;
+    }
+
+    MILLION_MESSAGE_HANDLE(LoggerSuppressTick, msg) {
+        logger().ReportSuppressed();
+        Timeout<LoggerSuppressTick>(msg->tick, msg->tick);
         co_return nullptr;
     }
 
     MILLION_MESSAGE_HANDLE(LoggerSetLevel, msg) {
         auto new_level = static_cast<spdlog::level::level_enum>(msg->new_level);
         logger_->set_level(new_level);
+        logger().UpdateLevel(msg->new_level);
         co_return nullptr;
     }
 
+private:
+    bool LoadAsyncSettings(const YAML::Node& logger_settings) {
+        const auto& async_settings = logger_settings["async"];
+        if (!async_settings || !async_settings["enable"] || !async_settings["enable"].as<bool>()) {
+            return true;
+        }
+        AsyncLogOptions options;
+        if (async_settings["ring_size"]) {
+            options.ring_size = async_settings["ring_size"].as<uint32_t>();
+        }
+        if (async_settings["flush_interval_ms"]) {
+            options.flush_interval_ms = async_settings["flush_interval_ms"].as<uint32_t>();
+        }
+        if (async_settings["overflow"]) {
+            auto overflow = async_settings["overflow"].as<std::string>();
+            if (overflow == "sync") {
+                options.sync_on_overflow = true;
+            }
+            else if (overflow != "drop") {
+                logger().LOG_ERROR("invalid 'logger.async.overflow': {}.", overflow);
+                return false;
+            }
+        }
+        async_options_ = options;
+        return true;
+    }
+
+    bool LoadBinarySettings(const YAML::Node& logger_settings) {
+        const auto& binary_settings = logger_settings["binary"];
+        if (!binary_settings || !binary_settings["enable"] || !binary_settings["enable"].as<bool>()) {
+            return true;
+        }
+        // 未格式化的参数只能从异步日志的缓冲区中取得
+        if (!async_options_) {
+            logger().LOG_ERROR("'logger.binary' requires 'logger.async'.");
+            return false;
+        }
+        if (!binary_settings["log_file"]) {
+            logger().LOG_ERROR("cannot find 'logger.binary.log_file'.");
+            return false;
+        }
+        binary_ = std::make_unique<BinaryLogWriter>(binary_settings["log_file"].as<std::string>());
+        return true;
+    }
+
+    bool LoadRateLimitSettings(const YAML::Node& logger_settings) {
+        const auto& rate_limit_settings = logger_settings["rate_limit"];
+        if (!rate_limit_settings || !rate_limit_settings["enable"] || !rate_limit_settings["enable"].as<bool>()) {
+            return true;
+        }
+        LogRateLimit limit;
+        if (!rate_limit_settings["rate"]) {
+            logger().LOG_ERROR("cannot find 'logger.rate_limit.rate'.");
+            return false;
+        }
+        limit.rate = rate_limit_settings["rate"].as<uint32_t>();
+        limit.burst = limit.rate;
+        if (rate_limit_settings["burst"]) {
+            limit.burst = rate_limit_settings["burst"].as<uint32_t>();
+        }
+        for (uint32_t i = 0; i < static_cast<uint32_t>(Logger::LogLevel::kOff); ++i) {
+            logger().SetRateLimit(static_cast<Logger::LogLevel>(i), limit);
+        }
+
+        // 按级别覆盖全局配置
+        if (const auto& levels_settings = rate_limit_settings["levels"]) {
+            for (const auto& level_settings : levels_settings) {
+                auto level_str = level_settings.first.as<std::string>();
+                auto level = spdlog::level::from_str(level_str);
+                if (level == spdlog::level::level_enum::off) {
+                    logger().LOG_ERROR("invalid level in 'logger.rate_limit.levels': {}.", level_str);
+                    return false;
+                }
+                LogRateLimit level_limit = limit;
+                if (level_settings.second["rate"]) {
+                    level_limit.rate = level_settings.second["rate"].as<uint32_t>();
+                    level_limit.burst = level_limit.rate;
+                }
+                if (level_settings.second["burst"]) {
+                    level_limit.burst = level_settings.second["burst"].as<uint32_t>();
+                }
+                logger().SetRateLimit(static_cast<Logger::LogLevel>(level), level_limit);
+            }
+        }
+
+        summary_interval_tick_ = 100;
+        if (rate_limit_settings["summary_interval_tick"]) {
+            summary_interval_tick_ = rate_limit_settings["summary_interval_tick"].as<uint32_t>();
+        }
+        return true;
+    }
+
 private:
     std::shared_ptr<spdlog::logger> logger_;
+    std::unique_ptr<BinaryLogWriter> binary_;
+    LoggerSink sink_;
+    std::optional<AsyncLogOptions> async_options_;
+    // 为0时不输出限流汇总
+    uint32_t summary_interval_tick_ = 0;
 };
 
 extern "C" MILLION_LOGGER_API bool MillionModuleInit(IMillion* imillion) {
@@ -0,0 +1,209 @@
+// 构建时为每个proto文件生成<name>.ids.h，包含ProtoCodec::RegisterFile原本在运行时通过选项扩展反射得到的模块id及消息id
+// 用法: million_proto_idgen <descriptor_set> <proto_file> <output_header> [message_id_extension]
+// descriptor_set需由protoc以--include_imports生成，以便在导入的文件中找到扩展的字段号
+// message_id_extension为标注消息id的MessageOptions扩展的全名，如million.test.ss.message_id，未指定时不生成消息id
+
+#include <cstdint>
+
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <google/protobuf/descriptor.pb.h>
+#include <google/protobuf/unknown_field_set.h>
+
+namespace protobuf = google::protobuf;
+
+// 与million/module_def.h中的ModuleId、ModuleSubCode一致
+using ModuleId = uint16_t;
+using MessageId = uint16_t;
+
+static constexpr std::string_view kModuleIdExtension = "module_id";
+static constexpr std::string_view kModuleIdPackage = "million.module";
+static constexpr std::string_view kEnumOptions = ".google.protobuf.EnumOptions";
+static constexpr std::string_view kMessageOptions = ".google.protobuf.MessageOptions";
+
+// 自定义选项在未链接对应扩展时作为未知字段保留
+static std::optional<uint64_t> FindVarintOption(const protobuf::UnknownFieldSet& fields, int number) {
+    for (int i = 0; i < fields.field_count(); ++i) {
+        const auto& field = fields.field(i);
+        if (field.number() == number && field.type() == protobuf::UnknownField::TYPE_VARINT) {
+            return field.varint();
+        }
+    }
+    return std::nullopt;
+}
+
+static std::optional<int> FindModuleIdExtensionNumber(const protobuf::FileDescriptorSet& set) {
+    for (const auto& file : set.file()) {
+        if (file.package() != kModuleIdPackage) {
+            continue;
+        }
+        for (const auto& extension : file.extension()) {
+            if (extension.name() == kModuleIdExtension && extension.extendee() == kEnumOptions) {
+                return extension.number();
+            }
+        }
+    }
+    return std::nullopt;
+}
+
+static const protobuf::FieldDescriptorProto* FindExtension(const protobuf::RepeatedPtrField<protobuf::DescriptorProto>& message_types,
+    const protobuf::RepeatedPtrField<protobuf::FieldDescriptorProto>& extensions, const std::string& scope, std::string_view full_name) {
+    for (const auto& extension : extensions) {
+        if (scope + extension.name() == full_name) {
+            return &extension;
+        }
+    }
+    // 定义在消息内的扩展，全名以消息名为作用域
+    for (const auto& message_type : message_types) {
+        auto found = FindExtension(message_type.nested_type(), message_type.extension(), scope + message_type.name() + ".", full_name);
+        if (found) {
+            return found;
+        }
+    }
+    return nullptr;
+}
+
+// 与RegisterFile的消息扩展参数对应，在整个描述符集(含导入的文件)中按全名查找
+static std::optional<int> FindMessageIdExtensionNumber(const protobuf::FileDescriptorSet& set, std::string_view full_name) {
+    if (full_name.starts_with('.')) {
+        full_name.remove_prefix(1);
+    }
+    for (const auto& file : set.file()) {
+        auto scope = file.package().empty() ? std::string() : file.package() + ".";
+        auto extension = FindExtension(file.message_type(), file.extension(), scope, full_name);
+        if (extension && extension->extendee() == kMessageOptions) {
+            return extension->number();
+        }
+    }
+    return std::nullopt;
+}
+
+static std::string FileStem(const std::string& path) {
+    auto begin = path.find_last_of('/');
+    begin = begin == std::string::npos ? 0 : begin + 1;
+    auto end = path.find('.', begin);
+    return path.substr(begin, end == std::string::npos ? std::string::npos : end - begin);
+}
+
+static std::string PackageToNamespace(const std::string& package) {
+    auto ns = package;
+    for (size_t pos = 0; (pos = ns.find('.', pos)) != std::string::npos; pos += 2) {
+        ns.replace(pos, 1, "::");
+    }
+    return ns;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc != 4 && argc != 5) {
+        std::cerr << "usage: million_proto_idgen <descriptor_set> <proto_file> <output_header> [message_id_extension]" << std::endl;
+        return 1;
+    }
+    std::string set_path = argv[1];
+    std::string proto_file = argv[2];
+    std::string output_path = argv[3];
+    std::string msg_ext_name = argc == 5 ? argv[4] : "";
+
+    protobuf::FileDescriptorSet set;
+    {
+        std::ifstream input(set_path, std::ios::binary);
+        if (!input || !set.ParseFromIstream(&input)) {
+            std::cerr << "cannot parse descriptor set: " << set_path << std::endl;
+            return 1;
+        }
+    }
+
+    const protobuf::FileDescriptorProto* file = nullptr;
+    for (const auto& f : set.file()) {
+        if (f.name() == proto_file) {
+            file = &f;
+            break;
+        }
+    }
+    if (!file) {
+        std::cerr << "cannot find '" << proto_file << "' in " << set_path << std::endl;
+        return 1;
+    }
+
+    // 文件中第一个带module_id选项的枚举，没有时为0，RegisterIdTable将返回false
+    uint64_t module_id = 0;
+    auto module_ext_number = FindModuleIdExtensionNumber(set);
+    if (module_ext_number) {
+        for (const auto& enum_type : file->enum_type()) {
+            auto value = FindVarintOption(enum_type.options().unknown_fields(), *module_ext_number);
+            if (value) {
+                module_id = *value;
+                break;
+            }
+        }
+    }
+    if (module_id > std::numeric_limits<ModuleId>::max()) {
+        std::cerr << proto_file << ": module id out of range: " << module_id << std::endl;
+        return 1;
+    }
+
+    struct MessageIdEntry {
+        int index;
+        uint64_t msg_id;
+        std::string name;
+    };
+    std::vector<MessageIdEntry> entries;
+    if (!msg_ext_name.empty()) {
+        auto msg_ext_number = FindMessageIdExtensionNumber(set, msg_ext_name);
+        if (!msg_ext_number) {
+            std::cerr << proto_file << ": cannot find MessageOptions extension '" << msg_ext_name << "' in " << set_path << std::endl;
+            return 1;
+        }
+        for (int i = 0; i < file->message_type_size(); ++i) {
+            const auto& message_type = file->message_type(i);
+            auto value = FindVarintOption(message_type.options().unknown_fields(), *msg_ext_number);
+            if (!value) {
+                continue;
+            }
+            if (*value > std::numeric_limits<MessageId>::max()) {
+                std::cerr << proto_file << ": message id of '" << message_type.name() << "' out of range: " << *value << std::endl;
+                return 1;
+            }
+            entries.push_back(MessageIdEntry{ i, *value, message_type.name() });
+        }
+    }
+
+    auto table_name = FileStem(proto_file) + "_ids";
+    std::ostringstream out;
+    out << "// 由million_proto_idgen根据" << proto_file << "生成，请勿修改\n"
+        << "#pragma once\n\n"
+        << "#include <array>\n"
+        << "#include <cstdint>\n"
+        << "#include <string_view>\n"
+        << "#include <utility>\n\n";
+    if (!file->package().empty()) {
+        out << "namespace " << PackageToNamespace(file->package()) << " {\n\n";
+    }
+    out << "// 通过ProtoCodec::RegisterIdTable<" << table_name << ">()注册\n"
+        << "struct " << table_name << " {\n"
+        << "    static constexpr std::string_view kProtoFile = \"" << proto_file << "\";\n"
+        << "    static constexpr uint32_t kModuleId = " << module_id << ";\n"
+        << "    // (文件内的消息下标, 消息id)\n"
+        << "    static constexpr std::array<std::pair<int32_t, uint32_t>, " << entries.size() << "> kMessageIds = {{\n";
+    for (const auto& entry : entries) {
+        out << "        { " << entry.index << ", " << entry.msg_id << " },    // " << entry.name << "\n";
+    }
+    out << "    }};\n"
+        << "};\n";
+    if (!file->package().empty()) {
+        out << "\n} // namespace " << PackageToNamespace(file->package()) << "\n";
+    }
+
+    std::ofstream output(output_path, std::ios::binary | std::ios::trunc);
+    if (!output) {
+        std::cerr << "cannot write " << output_path << std::endl;
+        return 1;
+    }
+    output << out.str();
+    return output ? 0 : 1;
+}
@@ -1,4 +1,5 @@
 #include <iostream>
+#include <format>
 
 #include <million/imillion.h>
 
@@ -6,6 +7,7 @@
 
 #include <million/cluster/cluster.h>
 #include <million/test/ss_test.pb.h>
+#include <million/test/ss_test.ids.h>
 #include <million/cluster/ss_cluster.pb.h>
 
 namespace test = million::test;
@@ -15,6 +17,11 @@ namespace protobuf = google::protobuf;
 
 MILLION_MESSAGE_DEFINE_NONCOPYABLE(, TestMsg, (million::ModuleCode) target_service_name_id, (million::ProtoMessageUnique) request);
 
+// 不经过.proto定义，由CppMessageCodec编码后跨节点传输
+MILLION_MESSAGE_DEFINE(, TestCppItem, (uint32_t) id, (std::string) name)
+MILLION_MESSAGE_DEFINE(, TestCppLoginRequest, (std::string) value, (std::vector<TestCppItem>) items, (std::optional<uint64_t>) token)
+MILLION_MESSAGE_DEFINE(, TestCppLoginResponse, (std::string) value, (std::vector<int32_t>) scores)
+
 class TestService : public million::IService {
     MILLION_SERVICE_DEFINE(TestService);
 
@@ -34,7 +41,22 @@ public:
         }
         cluster_ = *handle;
 
-        imillion().proto_mgr().codec().RegisterFile("million/test/ss_test.proto", module::module_id, test::ss::message_id);
+        imillion().proto_mgr().codec().RegisterIdTable<test::ss::ss_test_ids>();
+
+        // 复制独占的proto消息，副本也应是独占的，而不是被当作Arena上的消息
+        auto proto_msg = million::MessagePointer(million::make_proto_message<test::ss::LoginRequest>("copy"));
+        auto proto_copy = proto_msg.Copy();
+        if (!proto_copy.IsProtoMessageUnique() || proto_copy.GetMessage<test::ss::LoginRequest>()->value() != "copy") {
+            logger().LOG_ERROR("proto message copy is not unique.");
+            return false;
+        }
+
+        auto& cpp_codec = imillion().cpp_codec();
+        if (!cpp_codec.Register<TestCppLoginRequest>("million.test.TestCppLoginRequest")
+            || !cpp_codec.Register<TestCppLoginResponse>("million.test.TestCppLoginResponse")) {
+            logger().LOG_ERROR("register cpp messages failed.");
+            return false;
+        }
 
         return true;
     }
@@ -46,11 +68,28 @@ public:
         co_return million::make_proto_message<test::ss::LoginResponse>("LoginResponse res");
     }
 
+    MILLION_MESSAGE_HANDLE(TestCppLoginRequest, req) {
+        logger().LOG_INFO("TestCppLoginRequest, value:{}, items:{}, token:{}", req->value, req->items.size(), req->token.value_or(0));
+
+        auto scores = std::vector<int32_t>();
+        for (const auto& item : req->items) {
+            scores.emplace_back(static_cast<int32_t>(item.id * 10));
+        }
+        co_return million::make_message<TestCppLoginResponse>("TestCppLoginResponse res", std::move(scores));
+    }
+
     MILLION_MESSAGE_HANDLE(TestMsg, msg) {
+        auto target_service_name_id = msg->target_service_name_id;
         auto res = co_await Call<million::cluster::ClusterCallMessage, test::ss::LoginResponse>(cluster_,
-            msg->target_service_name_id,
+            target_service_name_id,
             std::move(msg->request));
         logger().LOG_INFO("test::ss::LoginResponse, value:{}", res->value());
+
+        auto items = std::vector<TestCppItem>{ TestCppItem(1, "a"), TestCppItem(2, "b") };
+        auto cpp_res = co_await Call<million::cluster::ClusterCallCppMessage, TestCppLoginResponse>(cluster_,
+            target_service_name_id,
+            million::make_cpp_message<TestCppLoginRequest>("TestCppLoginRequest message", std::move(items), 42));
+        logger().LOG_INFO("TestCppLoginResponse, value:{}, scores:{}", cpp_res->value, cpp_res->scores.size());
         co_return nullptr;
     }
 
@@ -119,5 +158,7 @@ int main() {
 
     getchar();
 
+    test_app->DumpTrace(std::format("cluster_test_trace_{}.json", settings["node"]["id"].as<int>()));
+
     return 0;
 }
@@ -0,0 +1,495 @@
+#include <iostream>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <format>
+#include <future>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#include <asio.hpp>
+
+#include <yaml-cpp/yaml.h>
+
+#include <million/imillion.h>
+#include <million/proto_mgr.h>
+#include <million/gateway/gateway.h>
+#include <million/gateway/ss_gateway.pb.h>
+
+#include <million/test/cs_test.pb.h>
+#include <million/test/cs_test.ids.h>
+
+MILLION_MODULE_INIT();
+
+namespace gateway = million::gateway;
+namespace module = million::module;
+namespace test = million::test;
+namespace protobuf = google::protobuf;
+namespace net = million::net;
+
+// 与GatewayService一致，长度之后固定8字节的网关头
+constexpr uint32_t kGatewayHeaderSize = 8;
+// 消息中第一个string字段的前缀为发送时间(纳秒，定长十进制)，回包原样带回用于计算往返延迟
+constexpr size_t kTimestampSize = 20;
+
+struct BotConfig {
+    std::string host = "127.0.0.1";
+    std::string port;
+    bool local_gateway = true;      // 在本进程中加载网关并启动回显服务
+    uint32_t connections = 1000;
+    uint32_t connect_rate = 1000;   // 每秒发起的连接数，0表示不限制
+    uint32_t send_rate = 10000;     // 所有连接合计每秒发送的消息数，0表示每个连接收到回包后立即发送下一个
+    uint32_t duration_s = 30;
+    uint32_t payload_size = 64;
+    std::string message = "million.test.cs.LoginRequest";
+};
+
+// 本地网关的用户服务，将客户端发来的消息原样回复
+class BotEchoService : public million::IService {
+    MILLION_SERVICE_DEFINE(BotEchoService);
+
+public:
+    using Base = million::IService;
+    BotEchoService(million::IMillion* imillion, std::promise<void>* registered)
+        : Base(imillion)
+        , registered_(registered) {}
+
+    virtual bool OnInit() override {
+        auto handle = imillion().FindServiceByNameId(module::module_id, gateway::ss::ServiceNameId_descriptor(), gateway::ss::SERVICE_NAME_ID_GATEWAY);
+        if (!handle) {
+            logger().LOG_ERROR("Unable to find GatewayService.");
+            return false;
+        }
+        gateway_ = *handle;
+        return true;
+    }
+
+    virtual million::Task<million::MessagePointer> OnStart(million::ServiceHandle sender, million::SessionId session_id, million::MessagePointer with_msg) override {
+        co_await Call<gateway::GatewayRegisterUserServiceReq, gateway::GatewayRegisterUserServiceResp>(gateway_, service_handle());
+        registered_->set_value();
+        co_return nullptr;
+    }
+
+    virtual million::Task<million::MessagePointer> OnMsg(million::ServiceHandle sender, million::SessionId session_id, million::MessagePointer msg) override {
+        if (!msg.IsProtoMessage()) {
+            co_return nullptr;
+        }
+        // 网关以连接的agent_id作为会话id转发，回复到该会话即发回对应连接
+        Reply(sender, session_id, std::move(msg));
+        co_return nullptr;
+    }
+
+private:
+    million::ServiceHandle gateway_;
+    std::promise<void>* registered_;
+};
+
+class BotApp : public million::IMillion {
+public:
+    virtual bool OnInit() override {
+        if (!proto_mgr().codec().RegisterIdTable<test::cs::cs_test_ids>()) {
+            logger().LOG_ERROR("register 'million/test/cs_test.proto' failed.");
+            return false;
+        }
+        return true;
+    }
+};
+
+static uint64_t NowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static const protobuf::FieldDescriptor* FindFirstStringField(const protobuf::Descriptor& desc) {
+    for (int i = 0; i < desc.field_count(); ++i) {
+        auto field = desc.field(i);
+        if (!field->is_repeated() && field->cpp_type() == protobuf::FieldDescriptor::CPPTYPE_STRING) {
+            return field;
+        }
+    }
+    return nullptr;
+}
+
+// 所有连接共享的状态，计数及延迟通过指标注册表按线程分片记录，无需加锁
+class BotContext : million::noncopyable {
+public:
+    BotContext(million::IMillion* app, BotConfig config, const protobuf::Descriptor* desc, const protobuf::FieldDescriptor* field)
+        : app_(app)
+        , config_(std::move(config))
+        , desc_(desc)
+        , field_(field)
+    {
+        auto& metrics = app_->metrics();
+        connected_metric_ = metrics.RegisterCounter("bot_connections_established_total", "Bot connections established.");
+        connect_failed_metric_ = metrics.RegisterCounter("bot_connections_failed_total", "Bot connections failed.");
+        closed_metric_ = metrics.RegisterCounter("bot_connections_closed_total", "Bot connections closed by error or peer.");
+        sent_metric_ = metrics.RegisterCounter("bot_messages_sent_total", "Messages sent by the bot.");
+        received_metric_ = metrics.RegisterCounter("bot_messages_received_total", "Messages received by the bot.");
+        received_bytes_metric_ = metrics.RegisterCounter("bot_received_bytes_total", "Bytes received by the bot, including framing.");
+        connect_ns_metric_ = metrics.RegisterHistogram("bot_connect_ns", "Time to establish a bot connection.");
+        rtt_ns_metric_ = metrics.RegisterHistogram("bot_rtt_ns", "Round trip time of bot messages.");
+    }
+
+    // 按connect_rate逐个发起连接，连接分散到各io_context
+    void Start() {
+        start_ns_ = NowNs();
+        asio::co_spawn(app_->NextIoContext().get_executor(), Launch(), asio::detached);
+    }
+
+    void Stop() {
+        running_.store(false, std::memory_order_relaxed);
+    }
+
+    bool running() const { return running_.load(std::memory_order_relaxed); }
+    uint64_t start_ns() const { return start_ns_; }
+    uint64_t last_connected_ns() const { return last_connected_ns_.load(std::memory_order_relaxed); }
+    const BotConfig& config() const { return config_; }
+
+private:
+    asio::awaitable<void> Launch() {
+        auto executor = co_await asio::this_coro::executor;
+        asio::steady_timer timer(executor);
+        for (uint32_t i = 0; i < config_.connections && running(); ++i) {
+            if (config_.connect_rate > 0) {
+                auto due_ns = start_ns_ + static_cast<uint64_t>(i) * 1000000000 / config_.connect_rate;
+                auto now_ns = NowNs();
+                if (due_ns > now_ns) {
+                    timer.expires_after(std::chrono::nanoseconds(due_ns - now_ns));
+                    co_await timer.async_wait(asio::use_awaitable);
+                }
+            }
+            asio::co_spawn(app_->NextIoContext().get_executor(), RunConnection(), asio::detached);
+        }
+    }
+
+    asio::awaitable<void> RunConnection() {
+        auto executor = co_await asio::this_coro::executor;
+        auto& metrics = app_->metrics();
+        asio::ip::tcp::socket socket(executor);
+        auto begin_ns = NowNs();
+        try {
+            asio::ip::tcp::resolver resolver(executor);
+            auto endpoints = co_await resolver.async_resolve(config_.host, config_.port, asio::use_awaitable);
+            co_await asio::async_connect(socket, endpoints, asio::use_awaitable);
+            socket.set_option(asio::ip::tcp::no_delay(true));
+        }
+        catch (const std::exception& e) {
+            metrics.Add(connect_failed_metric_);
+            app_->logger().LOG_DEBUG("bot connect failed: {}", e.what());
+            co_return;
+        }
+        auto now_ns = NowNs();
+        metrics.Add(connected_metric_);
+        metrics.Record(connect_ns_metric_, now_ns - begin_ns);
+        last_connected_ns_.store(now_ns, std::memory_order_relaxed);
+
+        auto connection = std::make_shared<Connection>(this, std::move(socket));
+        if (config_.send_rate > 0) {
+            asio::co_spawn(executor, connection->ReadLoop(false), asio::detached);
+            auto interval_ns = static_cast<uint64_t>(config_.connections) * 1000000000 / config_.send_rate;
+            co_await connection->WriteLoop(interval_ns);
+        }
+        else {
+            co_await connection->ReadLoop(true);
+        }
+    }
+
+    class Connection : public std::enable_shared_from_this<Connection> {
+    public:
+        Connection(BotContext* context, asio::ip::tcp::socket socket)
+            : context_(context)
+            , socket_(std::move(socket))
+            , msg_(context->app_->proto_mgr().NewMessage(*context->desc_))
+            , padding_(context->config_.payload_size > kTimestampSize ? context->config_.payload_size - kTimestampSize : 0, 'x') {}
+
+        // 按固定间隔发送，以计划时间推进，落后时立即补发
+        asio::awaitable<void> WriteLoop(uint64_t interval_ns) {
+            auto self = shared_from_this();
+            asio::steady_timer timer(socket_.get_executor());
+            auto next_ns = NowNs();
+            try {
+                while (context_->running()) {
+                    auto now_ns = NowNs();
+                    if (next_ns > now_ns) {
+                        timer.expires_after(std::chrono::nanoseconds(next_ns - now_ns));
+                        co_await timer.async_wait(asio::use_awaitable);
+                    }
+                    next_ns += interval_ns;
+                    co_await SendOne();
+                }
+            }
+            catch (const std::exception& e) {
+                Close(e);
+            }
+        }
+
+        // closed_loop为true时，每收到一个回包再发送下一个
+        asio::awaitable<void> ReadLoop(bool closed_loop) {
+            auto self = shared_from_this();
+            auto& metrics = context_->app_->metrics();
+            auto& codec = context_->app_->proto_mgr().codec();
+            try {
+                if (closed_loop) {
+                    co_await SendOne();
+                }
+                while (true) {
+                    uint32_t len = 0;
+                    co_await asio::async_read(socket_, asio::buffer(&len, sizeof(len)), asio::use_awaitable);
+                    len = asio::detail::socket_ops::network_to_host_long(len);
+                    if (len < kGatewayHeaderSize || len > net::kPacketMaxSize) {
+                        context_->app_->logger().LOG_ERROR("bot received abnormal packet length: {}.", len);
+                        break;
+                    }
+                    recv_buffer_.resize(len);
+                    co_await asio::async_read(socket_, asio::buffer(recv_buffer_), asio::use_awaitable);
+                    auto now_ns = NowNs();
+                    metrics.Add(context_->received_metric_);
+                    metrics.Add(context_->received_bytes_metric_, sizeof(len) + len);
+
+                    auto res = codec.DecodeMessage(net::PacketSpan(recv_buffer_.data() + kGatewayHeaderSize, len - kGatewayHeaderSize));
+                    if (res) {
+                        auto send_ns = ParseTimestamp(*res->msg.GetProtoMessage());
+                        if (send_ns && *send_ns <= now_ns) {
+                            metrics.Record(context_->rtt_ns_metric_, now_ns - *send_ns);
+                        }
+                    }
+                    if (closed_loop && context_->running()) {
+                        co_await SendOne();
+                    }
+                }
+            }
+            catch (const std::exception& e) {
+                Close(e);
+            }
+        }
+
+    private:
+        asio::awaitable<void> SendOne() {
+            msg_->GetReflection()->SetString(msg_.get(), context_->field_, std::format("{:020}", NowNs()) + padding_);
+            auto packet = context_->app_->proto_mgr().codec().EncodeMessage(*msg_);
+            if (!packet) {
+                throw std::runtime_error(std::format("encode '{}' failed.", context_->desc_->full_name()));
+            }
+            // 长度 + 网关头 + 模块/消息id + protobuf
+            uint32_t len = kGatewayHeaderSize + static_cast<uint32_t>(packet->size());
+            send_buffer_.assign(sizeof(len) + len, 0);
+            auto net_len = asio::detail::socket_ops::host_to_network_long(len);
+            std::memcpy(send_buffer_.data(), &net_len, sizeof(net_len));
+            std::memcpy(send_buffer_.data() + sizeof(len) + kGatewayHeaderSize, packet->data(), packet->size());
+            co_await asio::async_write(socket_, asio::buffer(send_buffer_), asio::use_awaitable);
+            context_->app_->metrics().Add(context_->sent_metric_);
+        }
+
+        std::optional<uint64_t> ParseTimestamp(const million::ProtoMessage& msg) {
+            auto field = FindFirstStringField(*msg.GetDescriptor());
+            if (!field) {
+                return std::nullopt;
+            }
+            auto value = msg.GetReflection()->GetString(msg, field);
+            if (value.size() < kTimestampSize) {
+                return std::nullopt;
+            }
+            uint64_t send_ns = 0;
+            for (size_t i = 0; i < kTimestampSize; ++i) {
+                if (value[i] < '0' || value[i] > '9') {
+                    return std::nullopt;
+                }
+                send_ns = send_ns * 10 + (value[i] - '0');
+            }
+            return send_ns;
+        }
+
+        // 读写协程各自结束时都会调用，只记录一次
+        void Close(const std::exception& e) {
+            if (closed_) {
+                return;
+            }
+            closed_ = true;
+            if (context_->running()) {
+                context_->app_->metrics().Add(context_->closed_metric_);
+                context_->app_->logger().LOG_DEBUG("bot connection closed: {}", e.what());
+            }
+            asio::error_code ec;
+            socket_.close(ec);
+        }
+
+    private:
+        BotContext* context_;
+        asio::ip::tcp::socket socket_;
+        million::ProtoMessageUnique msg_;
+        std::string padding_;
+        net::Packet send_buffer_;
+        net::Packet recv_buffer_;
+        bool closed_ = false;
+    };
+
+private:
+    million::IMillion* app_;
+    BotConfig config_;
+    const protobuf::Descriptor* desc_;
+    const protobuf::FieldDescriptor* field_;
+    std::atomic<bool> running_ = true;
+    uint64_t start_ns_ = 0;
+    std::atomic<uint64_t> last_connected_ns_ = 0;
+
+    million::MetricId connected_metric_;
+    million::MetricId connect_failed_metric_;
+    million::MetricId closed_metric_;
+    million::MetricId sent_metric_;
+    million::MetricId received_metric_;
+    million::MetricId received_bytes_metric_;
+    million::MetricId connect_ns_metric_;
+    million::MetricId rtt_ns_metric_;
+};
+
+static std::optional<BotConfig> LoadBotConfig(million::IMillion& app) {
+    const auto& settings = app.YamlSettings();
+    const auto& bot_settings = settings["bot"];
+    if (!bot_settings) {
+        app.logger().LOG_ERROR("cannot find 'bot'.");
+        return std::nullopt;
+    }
+    BotConfig config;
+    if (bot_settings["host"]) config.host = bot_settings["host"].as<std::string>();
+    if (bot_settings["port"]) {
+        config.port = bot_settings["port"].as<std::string>();
+    }
+    else if (settings["gateway"] && settings["gateway"]["port"]) {
+        config.port = settings["gateway"]["port"].as<std::string>();
+    }
+    else {
+        app.logger().LOG_ERROR("cannot find 'bot.port'.");
+        return std::nullopt;
+    }
+    if (bot_settings["local_gateway"]) config.local_gateway = bot_settings["local_gateway"].as<bool>();
+    if (bot_settings["connections"]) config.connections = bot_settings["connections"].as<uint32_t>();
+    if (bot_settings["connect_rate"]) config.connect_rate = bot_settings["connect_rate"].as<uint32_t>();
+    if (bot_settings["send_rate"]) config.send_rate = bot_settings["send_rate"].as<uint32_t>();
+    if (bot_settings["duration_s"]) config.duration_s = bot_settings["duration_s"].as<uint32_t>();
+    if (bot_settings["payload_size"]) config.payload_size = bot_settings["payload_size"].as<uint32_t>();
+    if (bot_settings["message"]) config.message = bot_settings["message"].as<std::string>();
+    if (config.connections == 0) {
+        app.logger().LOG_ERROR("invalid 'bot.connections': 0.");
+        return std::nullopt;
+    }
+    return config;
+}
+
+struct BotCounters {
+    uint64_t connected = 0;
+    uint64_t connect_failed = 0;
+    uint64_t closed = 0;
+    uint64_t sent = 0;
+    uint64_t received = 0;
+    uint64_t received_bytes = 0;
+    million::HistogramSnapshot connect_ns;
+    million::HistogramSnapshot rtt_ns;
+};
+
+static BotCounters ReadCounters(million::IMillion& app) {
+    auto snapshot = app.GetMetricsSnapshot();
+    auto counter = [&](std::string_view name) -> uint64_t {
+        auto sample = snapshot.Find(name);
+        return sample ? static_cast<uint64_t>(sample->value) : 0;
+    };
+    auto histogram = [&](std::string_view name) {
+        auto sample = snapshot.Find(name);
+        return sample ? sample->histogram : million::HistogramSnapshot();
+    };
+    BotCounters counters;
+    counters.connected = counter("bot_connections_established_total");
+    counters.connect_failed = counter("bot_connections_failed_total");
+    counters.closed = counter("bot_connections_closed_total");
+    counters.sent = counter("bot_messages_sent_total");
+    counters.received = counter("bot_messages_received_total");
+    counters.received_bytes = counter("bot_received_bytes_total");
+    counters.connect_ns = histogram("bot_connect_ns");
+    counters.rtt_ns = histogram("bot_rtt_ns");
+    return counters;
+}
+
+static std::string FormatPercentiles(const million::HistogramSnapshot& histogram) {
+    return std::format("p50: {}us, p90: {}us, p99: {}us, p999: {}us, max: {}us",
+        histogram.Percentile(0.5) / 1000, histogram.Percentile(0.9) / 1000, histogram.Percentile(0.99) / 1000,
+        histogram.Percentile(0.999) / 1000, histogram.max / 1000);
+}
+
+int main(int argc, char* argv[]) {
+    std::string settings_path = "gateway_bot_settings.yaml";
+    if (argc > 1) {
+        settings_path = argv[1];
+    }
+
+    if constexpr (!million::kMetricsEnabled) {
+        std::cout << "gateway_bot requires MILLION_METRICS." << std::endl;
+        return 1;
+    }
+
+    auto app = std::make_unique<BotApp>();
+    if (!app->Init(settings_path)) {
+        return 1;
+    }
+    app->Start();
+
+    auto config = LoadBotConfig(*app);
+    if (!config) {
+        return 1;
+    }
+    auto desc = app->proto_mgr().FindMessageTypeByName(config->message);
+    if (!desc) {
+        app->logger().LOG_ERROR("cannot find message '{}'.", config->message);
+        return 1;
+    }
+    auto field = FindFirstStringField(*desc);
+    if (!field) {
+        app->logger().LOG_ERROR("message '{}' has no string field to carry the timestamp.", config->message);
+        return 1;
+    }
+
+    if (config->local_gateway) {
+        std::promise<void> registered;
+        auto echo = app->NewService<BotEchoService>(&registered);
+        if (!echo) {
+            return 1;
+        }
+        registered.get_future().get();
+    }
+
+    std::cout << std::format("bot: {} connections to {}:{}, connect_rate: {}/s, send_rate: {}/s, payload: {}b, message: {}, duration: {}s",
+        config->connections, config->host, config->port, config->connect_rate, config->send_rate, config->payload_size,
+        config->message, config->duration_s) << std::endl;
+
+    BotContext context(app.get(), *config, desc, field);
+    context.Start();
+
+    BotCounters last;
+    for (uint32_t i = 0; i < config->duration_s; ++i) {
+        std::this_thread::sleep_for(std::chrono::seconds(1));
+        auto counters = ReadCounters(*app);
+        std::cout << std::format("[{:>4}s] connected: {}, failed: {}, closed: {}, sent: {}/s, received: {}/s, rtt p99: {}us",
+            i + 1, counters.connected, counters.connect_failed, counters.closed,
+            counters.sent - last.sent, counters.received - last.received, counters.rtt_ns.Percentile(0.99) / 1000) << std::endl;
+        last = std::move(counters);
+    }
+
+    context.Stop();
+    auto elapsed_ns = NowNs() - context.start_ns();
+    // 等待已发出的消息回包
+    std::this_thread::sleep_for(std::chrono::seconds(1));
+    auto counters = ReadCounters(*app);
+
+    auto connect_elapsed_ns = context.last_connected_ns() > context.start_ns() ? context.last_connected_ns() - context.start_ns() : 0;
+    auto elapsed_s = elapsed_ns / 1e9;
+    std::cout << "==== gateway bot report ====" << std::endl;
+    std::cout << std::format("connections: {} established, {} failed, {} closed", counters.connected, counters.connect_failed, counters.closed) << std::endl;
+    std::cout << std::format("connect rate: {:.0f}/s, connect time {}", connect_elapsed_ns ? counters.connected * 1e9 / connect_elapsed_ns : 0.0, FormatPercentiles(counters.connect_ns)) << std::endl;
+    std::cout << std::format("sent: {} ({:.0f}/s), received: {} ({:.0f}/s, {:.2f}MB/s)",
+        counters.sent, counters.sent / elapsed_s, counters.received, counters.received / elapsed_s, counters.received_bytes / elapsed_s / 1e6) << std::endl;
+    std::cout << std::format("rtt {}", FormatPercentiles(counters.rtt_ns)) << std::endl;
+
+    // 连接协程仍引用context，先停止io线程并销毁挂起的协程
+    app.reset();
+    return 0;
+}
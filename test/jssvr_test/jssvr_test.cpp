@@ -5,6 +5,7 @@
 #include <million/imillion.h>
 #include <million/jssvr/jssvr.h>
 #include <million/test/ss_test.pb.h>
+#include <million/test/ss_test.ids.h>
 
 MILLION_MODULE_INIT();
 
@@ -26,7 +27,7 @@ public:
     virtual bool OnInit() override {
         imillion().SetServiceNameId(service_handle(), module::module_id, test::ss::ServiceNameId_descriptor(), test::ss::SERVICE_NAME_ID_TEST_A);
 
-        imillion().proto_mgr().codec().RegisterFile("million/test/ss_test.proto", module::module_id, test::ss::message_id);
+        imillion().proto_mgr().codec().RegisterIdTable<test::ss::ss_test_ids>();
 
         return true;
     }
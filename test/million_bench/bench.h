@@ -0,0 +1,112 @@
+#pragma once
+
+#include <cstdint>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <million/imillion.h>
+
+namespace bench {
+
+// 单项测试结果，ops为操作次数，metrics为附加指标(延迟分位、吞吐等)
+struct Result {
+    std::string name;
+    uint64_t ops = 0;
+    uint64_t elapsed_ns = 0;
+    std::map<std::string, double> metrics;
+};
+
+inline uint64_t NowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// 防止被测表达式的结果被编译器优化掉
+inline const void* volatile do_not_optimize_sink = nullptr;
+template <typename T>
+inline void DoNotOptimize(const T& value) {
+    do_not_optimize_sink = &value;
+    std::atomic_signal_fence(std::memory_order_seq_cst);
+}
+
+// 将延迟样本(纳秒)的分位数写入结果
+inline void AddLatencyPercentiles(Result* result, std::vector<uint64_t> samples_ns, std::string_view prefix) {
+    if (samples_ns.empty()) {
+        return;
+    }
+    std::sort(samples_ns.begin(), samples_ns.end());
+    auto percentile = [&](double p) {
+        return static_cast<double>(samples_ns[static_cast<size_t>(p * (samples_ns.size() - 1))]);
+    };
+    auto key = [&](std::string_view name) {
+        return std::string(prefix) + std::string(name);
+    };
+    result->metrics[key("p50_ns")] = percentile(0.5);
+    result->metrics[key("p90_ns")] = percentile(0.9);
+    result->metrics[key("p99_ns")] = percentile(0.99);
+    result->metrics[key("p999_ns")] = percentile(0.999);
+    result->metrics[key("max_ns")] = static_cast<double>(samples_ns.back());
+}
+
+class Runner {
+public:
+    Runner(million::IMillion* app, double scale, std::string filter, uint16_t tcp_port)
+        : app_(app)
+        , scale_(scale)
+        , filter_(std::move(filter))
+        , tcp_port_(tcp_port) {}
+
+    million::IMillion& app() { return *app_; }
+    uint16_t tcp_port() const { return tcp_port_; }
+
+    // 按比例缩放迭代次数，便于快速冒烟或延长测试
+    uint64_t Scale(uint64_t ops) const {
+        return std::max<uint64_t>(1, static_cast<uint64_t>(ops * scale_));
+    }
+
+    // 名称包含过滤串的测试才会执行
+    bool Enabled(std::string_view name) const {
+        return filter_.empty() || name.find(filter_) != std::string_view::npos;
+    }
+
+    // 单线程循环测试，先以1/10的次数预热
+    template <typename Func>
+    Result Loop(std::string name, uint64_t ops, Func&& func) {
+        ops = Scale(ops);
+        for (uint64_t i = 0; i < ops / 10; ++i) {
+            func(i);
+        }
+        Result result;
+        result.name = std::move(name);
+        result.ops = ops;
+        auto begin = NowNs();
+        for (uint64_t i = 0; i < ops; ++i) {
+            func(i);
+        }
+        result.elapsed_ns = NowNs() - begin;
+        return result;
+    }
+
+    void Add(Result result);
+    const std::vector<Result>& results() const { return results_; }
+
+private:
+    million::IMillion* app_;
+    double scale_;
+    std::string filter_;
+    uint16_t tcp_port_;
+    std::vector<Result> results_;
+};
+
+// 各组测试，按名称前缀划分
+void RunRuntimeBenches(Runner& runner);
+void RunCodecBenches(Runner& runner);
+void RunNetBenches(Runner& runner);
+void RunModuleBenches(Runner& runner);
+
+} // namespace bench
@@ -0,0 +1,110 @@
+#include <format>
+#include <string>
+
+#include <million/imillion.h>
+#include <million/proto_mgr.h>
+
+#include <million/test/cs_test.pb.h>
+#include <million/test/cs_test.ids.h>
+
+#include "bench.h"
+
+namespace bench {
+
+namespace test = million::test;
+
+// 与cs_test.proto的LoginRequest对应
+MILLION_MESSAGE_DEFINE(, BenchCppLoginRequest, (std::string) value)
+
+static void BenchProtoCodec(Runner& runner, size_t payload_size) {
+    auto& codec = runner.app().proto_mgr().codec();
+    test::cs::LoginRequest request;
+    request.set_value(std::string(payload_size, 'x'));
+    auto packet = codec.EncodeMessage(request);
+    if (!packet) {
+        runner.app().logger().LOG_ERROR("encode LoginRequest failed.");
+        return;
+    }
+    auto packet_size = packet->size();
+
+    auto name = std::format("codec.proto_encode_{}b", payload_size);
+    if (runner.Enabled(name)) {
+        auto result = runner.Loop(std::move(name), 1000000, [&](uint64_t) {
+            auto encoded = codec.EncodeMessage(request);
+            DoNotOptimize(encoded);
+        });
+        result.metrics["mb_per_sec"] = result.ops * packet_size * 1e3 / result.elapsed_ns;
+        runner.Add(std::move(result));
+    }
+
+    // 复用缓冲区，对应网关直接编码到连接缓冲区的路径
+    name = std::format("codec.proto_encode_to_{}b", payload_size);
+    if (runner.Enabled(name)) {
+        auto buffer = million::net::Packet(packet_size);
+        auto result = runner.Loop(std::move(name), 1000000, [&](uint64_t) {
+            auto byte_size = request.ByteSizeLong();
+            auto success = codec.EncodeMessageTo(request, byte_size, buffer.data());
+            DoNotOptimize(success);
+        });
+        result.metrics["mb_per_sec"] = result.ops * packet_size * 1e3 / result.elapsed_ns;
+        runner.Add(std::move(result));
+    }
+
+    name = std::format("codec.proto_decode_{}b", payload_size);
+    if (runner.Enabled(name)) {
+        auto result = runner.Loop(std::move(name), 1000000, [&](uint64_t) {
+            auto decoded = codec.DecodeMessage(*packet);
+            DoNotOptimize(decoded);
+        });
+        result.metrics["mb_per_sec"] = result.ops * packet_size * 1e3 / result.elapsed_ns;
+        runner.Add(std::move(result));
+    }
+}
+
+static void BenchCppCodec(Runner& runner, size_t payload_size) {
+    auto& codec = runner.app().cpp_codec();
+    BenchCppLoginRequest request(std::string(payload_size, 'x'));
+    auto packet = codec.EncodeMessage(request);
+    if (!packet) {
+        runner.app().logger().LOG_ERROR("encode BenchCppLoginRequest failed.");
+        return;
+    }
+    auto packet_size = packet->size();
+
+    auto name = std::format("codec.cpp_encode_{}b", payload_size);
+    if (runner.Enabled(name)) {
+        auto result = runner.Loop(std::move(name), 1000000, [&](uint64_t) {
+            auto encoded = codec.EncodeMessage(request);
+            DoNotOptimize(encoded);
+        });
+        result.metrics["mb_per_sec"] = result.ops * packet_size * 1e3 / result.elapsed_ns;
+        runner.Add(std::move(result));
+    }
+
+    name = std::format("codec.cpp_decode_{}b", payload_size);
+    if (runner.Enabled(name)) {
+        auto result = runner.Loop(std::move(name), 1000000, [&](uint64_t) {
+            auto decoded = codec.DecodeMessage(*packet);
+            DoNotOptimize(decoded);
+        });
+        result.metrics["mb_per_sec"] = result.ops * packet_size * 1e3 / result.elapsed_ns;
+        runner.Add(std::move(result));
+    }
+}
+
+void RunCodecBenches(Runner& runner) {
+    if (!runner.app().proto_mgr().codec().RegisterIdTable<test::cs::cs_test_ids>()) {
+        runner.app().logger().LOG_ERROR("register 'million/test/cs_test.proto' failed.");
+        return;
+    }
+    if (!runner.app().cpp_codec().Register<BenchCppLoginRequest>("million.bench.LoginRequest")) {
+        runner.app().logger().LOG_ERROR("register 'million.bench.LoginRequest' failed.");
+        return;
+    }
+    for (size_t payload_size : { 16, 1024, 16384 }) {
+        BenchProtoCodec(runner, payload_size);
+        BenchCppCodec(runner, payload_size);
+    }
+}
+
+} // namespace bench
@@ -0,0 +1,105 @@
+#include <iostream>
+#include <fstream>
+#include <format>
+#include <string>
+#include <string_view>
+
+#include <nlohmann/json.hpp>
+
+#include <million/imillion.h>
+
+#include "bench.h"
+
+MILLION_MODULE_INIT();
+
+namespace bench {
+
+void Runner::Add(Result result) {
+    auto ns_per_op = result.ops ? static_cast<double>(result.elapsed_ns) / result.ops : 0.0;
+    auto ops_per_sec = result.elapsed_ns ? result.ops * 1e9 / result.elapsed_ns : 0.0;
+    std::cout << std::format("{:<40} {:>12} ops {:>14.1f} ns/op {:>16.0f} ops/s", result.name, result.ops, ns_per_op, ops_per_sec);
+    for (auto& [key, value] : result.metrics) {
+        std::cout << std::format("  {}={:.1f}", key, value);
+    }
+    std::cout << std::endl;
+    results_.emplace_back(std::move(result));
+}
+
+} // namespace bench
+
+class BenchApp : public million::IMillion {
+};
+
+// 以测试名为键输出，键有序，便于不同提交间直接diff
+static nlohmann::json ResultsToJson(const std::vector<bench::Result>& results, double scale) {
+    nlohmann::json json;
+    json["scale"] = scale;
+    auto& items = json["results"];
+    items = nlohmann::json::object();
+    for (auto& result : results) {
+        auto& item = items[result.name];
+        item["ops"] = result.ops;
+        item["elapsed_ns"] = result.elapsed_ns;
+        item["ns_per_op"] = result.ops ? static_cast<double>(result.elapsed_ns) / result.ops : 0.0;
+        item["ops_per_sec"] = result.elapsed_ns ? result.ops * 1e9 / result.elapsed_ns : 0.0;
+        for (auto& [key, value] : result.metrics) {
+            item[key] = value;
+        }
+    }
+    return json;
+}
+
+static void PrintUsage() {
+    std::cout << "usage: million_bench [--filter <name>] [--scale <factor>] [--out <path>] [--tcp-port <port>]" << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    std::string filter;
+    std::string out_path = "million_bench.json";
+    double scale = 1.0;
+    uint16_t tcp_port = 18650;
+    for (int i = 1; i < argc; ++i) {
+        std::string_view arg = argv[i];
+        if (i + 1 >= argc) {
+            PrintUsage();
+            return 1;
+        }
+        if (arg == "--filter") {
+            filter = argv[++i];
+        }
+        else if (arg == "--scale") {
+            scale = std::stod(argv[++i]);
+        }
+        else if (arg == "--out") {
+            out_path = argv[++i];
+        }
+        else if (arg == "--tcp-port") {
+            tcp_port = static_cast<uint16_t>(std::stoul(argv[++i]));
+        }
+        else {
+            PrintUsage();
+            return 1;
+        }
+    }
+
+    auto app = std::make_unique<BenchApp>();
+    if (!app->Init("million_bench_settings.yaml")) {
+        return 1;
+    }
+    app->Start();
+
+    bench::Runner runner(app.get(), scale, std::move(filter), tcp_port);
+    bench::RunRuntimeBenches(runner);
+    bench::RunCodecBenches(runner);
+    bench::RunNetBenches(runner);
+    bench::RunModuleBenches(runner);
+
+    std::ofstream out(out_path);
+    if (!out) {
+        std::cout << "open '" << out_path << "' failed." << std::endl;
+        return 1;
+    }
+    out << ResultsToJson(runner.results(), scale).dump(2) << std::endl;
+    std::cout << "results written to " << out_path << std::endl;
+    return 0;
+}
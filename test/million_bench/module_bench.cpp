@@ -0,0 +1,119 @@
+#include <format>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <million/imillion.h>
+#include <million/config/config_table.h>
+#include <million/db/db_row.h>
+
+#include <million/test/cfg_network.pb.h>
+#include <million/test/db_example.pb.h>
+
+#include "bench.h"
+
+namespace bench {
+
+namespace config = million::config;
+namespace db = million::db;
+namespace test = million::test;
+namespace example = million::example;
+
+static void BenchConfigTable(Runner& runner, int32_t row_count) {
+    auto table = million::make_proto_message<test::cfg::TbServer>();
+    for (int32_t i = 0; i < row_count; ++i) {
+        auto row = table->add_data_list();
+        row->set_id(1000 + i);
+        row->set_type(i % 2 ? test::cfg::ServerType_resource_download : test::cfg::ServerType_main);
+        row->set_host(std::format("10.0.{}.{}", i / 256, i % 256));
+        row->set_port(20000 + i);
+    }
+    config::ConfigTable<test::cfg::Server> config_table(std::move(table));
+    config_table.BuildIndex(test::cfg::Server::kIdFieldNumber);
+    config_table.BuildCompositeIndex({ test::cfg::Server::kTypeFieldNumber, test::cfg::Server::kPortFieldNumber });
+
+    // 预先生成随机键，避免随机数生成计入查找耗时
+    std::mt19937 rng(row_count);
+    std::vector<int32_t> keys(4096);
+    for (auto& key : keys) {
+        key = std::uniform_int_distribution<int32_t>(0, row_count - 1)(rng);
+    }
+
+    auto name = std::format("config.index_lookup_{}", row_count);
+    if (runner.Enabled(name)) {
+        runner.Add(runner.Loop(std::move(name), 2000000, [&](uint64_t i) {
+            auto row = config_table.FindRowByIndex(test::cfg::Server::kIdFieldNumber, 1000 + keys[i % keys.size()]);
+            DoNotOptimize(row);
+        }));
+    }
+
+    name = std::format("config.composite_index_lookup_{}", row_count);
+    if (runner.Enabled(name)) {
+        runner.Add(runner.Loop(std::move(name), 1000000, [&](uint64_t i) {
+            auto key = keys[i % keys.size()];
+            auto row = config_table.FindRowByCompositeIndex({ test::cfg::Server::kTypeFieldNumber, test::cfg::Server::kPortFieldNumber }
+                , static_cast<int32_t>(key % 2 ? test::cfg::ServerType_resource_download : test::cfg::ServerType_main), 20000 + key);
+            DoNotOptimize(row);
+        }));
+    }
+
+    // 无索引时的线性查找，作为对照
+    name = std::format("config.linear_lookup_{}", row_count);
+    if (runner.Enabled(name)) {
+        runner.Add(runner.Loop(std::move(name), 20000, [&](uint64_t i) {
+            auto id = 1000 + keys[i % keys.size()];
+            auto row = config_table.FindRow([id](const test::cfg::Server& server) {
+                return server.id() == id;
+            });
+            DoNotOptimize(row);
+        }));
+    }
+}
+
+static db::DBRow MakeUserRow() {
+    auto user = million::make_proto_message<example::db::User>();
+    user->set_id(100);
+    user->set_name("bench_user");
+    user->set_email("bench_user@example.com");
+    user->set_phone_number("13800000000");
+    for (int32_t i = 0; i < 16; ++i) {
+        user->mutable_role_info()->add_role_ids(i);
+    }
+    user->set_password_hash(std::string(64, 'h'));
+    user->set_is_active(true);
+    user->set_created_at(10000);
+    user->set_updated_at(13123);
+    return db::DBRow(std::move(user));
+}
+
+static void BenchDBRow(Runner& runner) {
+    auto name = std::string("db.row_copy_dirty_2_fields");
+    if (runner.Enabled(name)) {
+        auto row = MakeUserRow();
+        row.MarkDirtyByFieldNum(example::db::User::kEmailFieldNumber);
+        row.MarkDirtyByFieldNum(example::db::User::kUpdatedAtFieldNumber);
+        runner.Add(runner.Loop(std::move(name), 500000, [&](uint64_t) {
+            auto copy = row.CopyDirtyTo(true);
+            DoNotOptimize(copy);
+        }));
+    }
+
+    name = "db.row_copy_dirty_all_fields";
+    if (runner.Enabled(name)) {
+        auto row = MakeUserRow();
+        row.MarkDirty();
+        runner.Add(runner.Loop(std::move(name), 500000, [&](uint64_t) {
+            auto copy = row.CopyDirtyTo(true);
+            DoNotOptimize(copy);
+        }));
+    }
+}
+
+void RunModuleBenches(Runner& runner) {
+    for (int32_t row_count : { 100, 10000 }) {
+        BenchConfigTable(runner, row_count);
+    }
+    BenchDBRow(runner);
+}
+
+} // namespace bench
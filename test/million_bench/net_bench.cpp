@@ -0,0 +1,109 @@
+#include <atomic>
+#include <chrono>
+#include <format>
+#include <future>
+#include <memory>
+#include <optional>
+#include <string>
+#include <thread>
+#include <utility>
+
+#include <asio.hpp>
+
+#include <million/imillion.h>
+#include <million/net/tcp_server.h>
+#include <million/net/tcp_connection.h>
+
+#include "bench.h"
+
+namespace bench {
+
+namespace net = million::net;
+
+struct LoopbackState {
+    std::atomic<uint64_t> received_packets = 0;
+};
+
+// 客户端持续发送，未被服务端读取的包不超过kWindow，避免发送队列无限增长
+static void BenchTcpLoopback(Runner& runner, const net::TcpConnectionShared& connection, LoopbackState* state, size_t packet_size, uint64_t count) {
+    constexpr uint64_t kWindow = 1024;
+    auto name = std::format("net.tcp_loopback_{}b", packet_size);
+    if (!runner.Enabled(name)) {
+        return;
+    }
+    auto payload = net::Packet(packet_size, 0x5a);
+    Result result;
+    result.name = std::move(name);
+    result.ops = runner.Scale(count);
+    auto base = state->received_packets.load(std::memory_order_acquire);
+    auto begin_ns = NowNs();
+    for (uint64_t i = 0; i < result.ops; ++i) {
+        while (i - (state->received_packets.load(std::memory_order_acquire) - base) >= kWindow) {
+            std::this_thread::yield();
+        }
+        connection->Send(net::Packet(payload));
+    }
+    while (state->received_packets.load(std::memory_order_acquire) - base < result.ops) {
+        std::this_thread::yield();
+    }
+    result.elapsed_ns = NowNs() - begin_ns;
+    // 包含4字节长度头
+    result.metrics["mb_per_sec"] = result.ops * (packet_size + sizeof(uint32_t)) * 1e3 / result.elapsed_ns;
+    runner.Add(std::move(result));
+}
+
+// 包大小及发送次数
+static constexpr std::pair<size_t, uint64_t> kLoopbackCases[] = {
+    { 64, 500000 },
+    { 1024, 200000 },
+    { 16384, 20000 },
+};
+
+void RunNetBenches(Runner& runner) {
+    bool enabled = false;
+    for (auto [packet_size, count] : kLoopbackCases) {
+        enabled = enabled || runner.Enabled(std::format("net.tcp_loopback_{}b", packet_size));
+    }
+    if (!enabled) {
+        return;
+    }
+    auto& app = runner.app();
+    auto state = std::make_shared<LoopbackState>();
+
+    // 监听协程没有退出机制，服务端与客户端在进程结束前保持有效
+    auto server = new net::TcpServer(&app);
+    server->set_on_msg([state](const net::TcpConnectionShared&, net::Packet&& packet) -> asio::awaitable<void> {
+        state->received_packets.fetch_add(1, std::memory_order_release);
+        co_return;
+    });
+    server->Start(runner.tcp_port());
+
+    auto client = new net::TcpServer(&app);
+    auto port = std::to_string(runner.tcp_port());
+    std::promise<std::optional<net::TcpConnectionShared>> connected;
+    asio::co_spawn(app.NextIoContext().get_executor(), [client, &port, &connected]() -> asio::awaitable<void> {
+        // 监听在io线程中异步开始，首次连接可能早于监听
+        for (int i = 0; i < 50; ++i) {
+            auto connection = co_await client->ConnectTo("127.0.0.1", port);
+            if (connection) {
+                connected.set_value(std::move(connection));
+                co_return;
+            }
+            asio::steady_timer timer(co_await asio::this_coro::executor, std::chrono::milliseconds(20));
+            co_await timer.async_wait(asio::use_awaitable);
+        }
+        connected.set_value(std::nullopt);
+    }, asio::detached);
+
+    auto connection = connected.get_future().get();
+    if (!connection) {
+        app.logger().LOG_ERROR("connect to 127.0.0.1:{} failed.", port);
+        return;
+    }
+
+    for (auto [packet_size, count] : kLoopbackCases) {
+        BenchTcpLoopback(runner, *connection, state.get(), packet_size, count);
+    }
+}
+
+} // namespace bench
@@ -0,0 +1,370 @@
+#include <algorithm>
+#include <atomic>
+#include <format>
+#include <future>
+#include <memory>
+#include <vector>
+
+#include <million/imillion.h>
+#include <million/event_mgr.h>
+
+#include "bench.h"
+
+namespace bench {
+
+MILLION_MESSAGE_DEFINE(, BenchPingMsg, (uint64_t) seq);
+MILLION_MESSAGE_DEFINE(, BenchPongMsg, (uint64_t) seq);
+MILLION_MESSAGE_DEFINE(, BenchCallReq, (uint64_t) seq);
+MILLION_MESSAGE_DEFINE(, BenchCallResp, (uint64_t) seq);
+MILLION_MESSAGE_DEFINE(, BenchStartMsg, (uint64_t) count);
+MILLION_MESSAGE_DEFINE(, BenchItemMsg, (uint64_t) seq);
+MILLION_MESSAGE_DEFINE(, BenchEventMsg, (uint64_t) seq);
+MILLION_MESSAGE_DEFINE(, BenchTimerStormMsg, (uint64_t) count, (uint32_t) max_tick);
+MILLION_MESSAGE_DEFINE(, BenchTimerFiredMsg, (uint64_t) seq);
+
+// Ping以新消息Send回Pong，不经过会话协程；CallReq通过回复返回，由调用方协程等待
+class BenchEchoService : public million::IService {
+    MILLION_SERVICE_DEFINE(BenchEchoService);
+
+public:
+    using Base = million::IService;
+    using Base::Base;
+
+    MILLION_MESSAGE_HANDLE(BenchPingMsg, msg) {
+        Send<BenchPongMsg>(sender, msg->seq);
+        co_return nullptr;
+    }
+
+    MILLION_MESSAGE_HANDLE(BenchCallReq, msg) {
+        co_return million::make_message<BenchCallResp>(msg->seq);
+    }
+};
+
+// 单向消息往返，每轮由Pong的处理函数发出下一次Ping
+class BenchPingPongService : public million::IService {
+    MILLION_SERVICE_DEFINE(BenchPingPongService);
+
+public:
+    using Base = million::IService;
+    BenchPingPongService(million::IMillion* imillion, million::ServiceHandle echo, std::promise<std::vector<uint64_t>>* result)
+        : Base(imillion)
+        , echo_(std::move(echo))
+        , result_(result) {}
+
+    MILLION_MESSAGE_HANDLE(BenchStartMsg, msg) {
+        count_ = msg->count;
+        latencies_ns_.reserve(count_);
+        send_ns_ = NowNs();
+        Send<BenchPingMsg>(echo_, 0);
+        co_return nullptr;
+    }
+
+    MILLION_MESSAGE_HANDLE(BenchPongMsg, msg) {
+        auto now_ns = NowNs();
+        latencies_ns_.emplace_back(now_ns - send_ns_);
+        if (msg->seq + 1 >= count_) {
+            result_->set_value(std::move(latencies_ns_));
+            co_return nullptr;
+        }
+        send_ns_ = now_ns;
+        Send<BenchPingMsg>(echo_, msg->seq + 1);
+        co_return nullptr;
+    }
+
+private:
+    million::ServiceHandle echo_;
+    std::promise<std::vector<uint64_t>>* result_;
+    uint64_t count_ = 0;
+    uint64_t send_ns_ = 0;
+    std::vector<uint64_t> latencies_ns_;
+};
+
+// Call往返，每轮挂起协程等待回复
+class BenchCallService : public million::IService {
+    MILLION_SERVICE_DEFINE(BenchCallService);
+
+public:
+    using Base = million::IService;
+    BenchCallService(million::IMillion* imillion, million::ServiceHandle echo, std::promise<std::vector<uint64_t>>* result)
+        : Base(imillion)
+        , echo_(std::move(echo))
+        , result_(result) {}
+
+    MILLION_MESSAGE_HANDLE(BenchStartMsg, msg) {
+        std::vector<uint64_t> latencies_ns;
+        latencies_ns.reserve(msg->count);
+        for (uint64_t i = 0; i < msg->count; ++i) {
+            auto begin_ns = NowNs();
+            auto res = co_await Call<BenchCallReq, BenchCallResp>(echo_, i);
+            latencies_ns.emplace_back(NowNs() - begin_ns);
+            DoNotOptimize(res->seq);
+        }
+        result_->set_value(std::move(latencies_ns));
+        co_return nullptr;
+    }
+
+private:
+    million::ServiceHandle echo_;
+    std::promise<std::vector<uint64_t>>* result_;
+};
+
+// 多个生产者向同一消费者投递，消费者收齐后通知
+class BenchConsumerService : public million::IService {
+    MILLION_SERVICE_DEFINE(BenchConsumerService);
+
+public:
+    using Base = million::IService;
+    BenchConsumerService(million::IMillion* imillion, uint64_t expected, std::promise<void>* done)
+        : Base(imillion)
+        , expected_(expected)
+        , done_(done) {}
+
+    MILLION_MESSAGE_HANDLE(BenchItemMsg, msg) {
+        if (++received_ == expected_) {
+            done_->set_value();
+        }
+        co_return nullptr;
+    }
+
+private:
+    uint64_t expected_;
+    uint64_t received_ = 0;
+    std::promise<void>* done_;
+};
+
+class BenchProducerService : public million::IService {
+    MILLION_SERVICE_DEFINE(BenchProducerService);
+
+public:
+    using Base = million::IService;
+    BenchProducerService(million::IMillion* imillion, million::ServiceHandle consumer)
+        : Base(imillion)
+        , consumer_(std::move(consumer)) {}
+
+    MILLION_MESSAGE_HANDLE(BenchStartMsg, msg) {
+        for (uint64_t i = 0; i < msg->count; ++i) {
+            Send<BenchItemMsg>(consumer_, i);
+        }
+        co_return nullptr;
+    }
+
+private:
+    million::ServiceHandle consumer_;
+};
+
+// EventMgr非线程安全，订阅在主线程完成后只由发布者服务访问
+class BenchPublisherService : public million::IService {
+    MILLION_SERVICE_DEFINE(BenchPublisherService);
+
+public:
+    using Base = million::IService;
+    BenchPublisherService(million::IMillion* imillion, million::EventMgr* event_mgr, std::promise<void>* published)
+        : Base(imillion)
+        , event_mgr_(event_mgr)
+        , published_(published) {}
+
+    MILLION_MESSAGE_HANDLE(BenchStartMsg, msg) {
+        for (uint64_t i = 0; i < msg->count; ++i) {
+            event_mgr_->Send(service_handle(), million::make_message<BenchEventMsg>(i));
+        }
+        published_->set_value();
+        co_return nullptr;
+    }
+
+private:
+    million::EventMgr* event_mgr_;
+    std::promise<void>* published_;
+};
+
+class BenchSubscriberService : public million::IService {
+    MILLION_SERVICE_DEFINE(BenchSubscriberService);
+
+public:
+    using Base = million::IService;
+    BenchSubscriberService(million::IMillion* imillion, std::atomic<uint64_t>* remaining, std::promise<void>* done)
+        : Base(imillion)
+        , remaining_(remaining)
+        , done_(done) {}
+
+    MILLION_MESSAGE_HANDLE(BenchEventMsg, msg) {
+        if (remaining_->fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            done_->set_value();
+        }
+        co_return nullptr;
+    }
+
+private:
+    std::atomic<uint64_t>* remaining_;
+    std::promise<void>* done_;
+};
+
+// 一次性插入大量定时任务，到期时间均匀分布在[0, max_tick]
+class BenchTimerService : public million::IService {
+    MILLION_SERVICE_DEFINE(BenchTimerService);
+
+public:
+    using Base = million::IService;
+    BenchTimerService(million::IMillion* imillion, std::promise<uint64_t>* insert_ns, std::promise<void>* done)
+        : Base(imillion)
+        , insert_ns_(insert_ns)
+        , done_(done) {}
+
+    MILLION_MESSAGE_HANDLE(BenchTimerStormMsg, msg) {
+        expected_ = msg->count;
+        auto begin_ns = NowNs();
+        for (uint64_t i = 0; i < msg->count; ++i) {
+            Timeout<BenchTimerFiredMsg>(static_cast<uint32_t>(i % (msg->max_tick + 1)), i);
+        }
+        insert_ns_->set_value(NowNs() - begin_ns);
+        co_return nullptr;
+    }
+
+    MILLION_MESSAGE_HANDLE(BenchTimerFiredMsg, msg) {
+        if (++fired_ == expected_) {
+            done_->set_value();
+        }
+        co_return nullptr;
+    }
+
+private:
+    std::promise<uint64_t>* insert_ns_;
+    std::promise<void>* done_;
+    uint64_t expected_ = 0;
+    uint64_t fired_ = 0;
+};
+
+static void StopServices(million::IMillion& app, const std::vector<million::ServiceHandle>& services) {
+    for (auto& service : services) {
+        app.StopService(service, nullptr);
+    }
+}
+
+static void BenchPingPong(Runner& runner) {
+    auto& app = runner.app();
+    std::promise<std::vector<uint64_t>> latencies;
+    auto echo = app.NewService<BenchEchoService>();
+    auto ping = app.NewService<BenchPingPongService>(*echo, &latencies);
+
+    Result result;
+    result.name = "runtime.ping_pong";
+    result.ops = runner.Scale(200000);
+    auto begin_ns = NowNs();
+    app.Send<BenchStartMsg>(*ping, *ping, result.ops);
+    AddLatencyPercentiles(&result, latencies.get_future().get(), "rtt_");
+    result.elapsed_ns = NowNs() - begin_ns;
+    runner.Add(std::move(result));
+
+    StopServices(app, { *ping, *echo });
+}
+
+static void BenchCallRoundTrip(Runner& runner) {
+    auto& app = runner.app();
+    std::promise<std::vector<uint64_t>> latencies;
+    auto echo = app.NewService<BenchEchoService>();
+    auto caller = app.NewService<BenchCallService>(*echo, &latencies);
+
+    Result result;
+    result.name = "runtime.call_rtt";
+    result.ops = runner.Scale(100000);
+    auto begin_ns = NowNs();
+    app.Send<BenchStartMsg>(*caller, *caller, result.ops);
+    AddLatencyPercentiles(&result, latencies.get_future().get(), "rtt_");
+    result.elapsed_ns = NowNs() - begin_ns;
+    runner.Add(std::move(result));
+
+    StopServices(app, { *caller, *echo });
+}
+
+static void BenchMailbox(Runner& runner, size_t producer_count) {
+    auto& app = runner.app();
+    // 缩放后不足每个生产者一条时，消费者会一直等不到完成
+    auto per_producer = std::max<size_t>(runner.Scale(1000000) / producer_count, 1);
+    std::promise<void> done;
+    auto consumer = app.NewService<BenchConsumerService>(per_producer * producer_count, &done);
+    std::vector<million::ServiceHandle> services = { *consumer };
+    for (size_t i = 0; i < producer_count; ++i) {
+        services.emplace_back(*app.NewService<BenchProducerService>(*consumer));
+    }
+
+    Result result;
+    result.name = std::format("runtime.mailbox_{}p1c", producer_count);
+    result.ops = per_producer * producer_count;
+    auto begin_ns = NowNs();
+    for (size_t i = 1; i < services.size(); ++i) {
+        app.Send<BenchStartMsg>(services[i], services[i], per_producer);
+    }
+    done.get_future().get();
+    result.elapsed_ns = NowNs() - begin_ns;
+    if (auto stats = app.GetMailboxStats(*consumer)) {
+        result.metrics["mailbox_high_water_mark"] = static_cast<double>(stats->high_water_mark);
+    }
+    runner.Add(std::move(result));
+
+    StopServices(app, services);
+}
+
+static void BenchEventFanOut(Runner& runner, size_t subscriber_count) {
+    auto& app = runner.app();
+    auto event_count = runner.Scale(100000);
+    std::atomic<uint64_t> remaining = event_count * subscriber_count;
+    std::promise<void> done;
+    std::promise<void> published;
+    million::EventMgr event_mgr(&app);
+    std::vector<million::ServiceHandle> services;
+    for (size_t i = 0; i < subscriber_count; ++i) {
+        auto subscriber = app.NewService<BenchSubscriberService>(&remaining, &done);
+        event_mgr.Subscribe(million::GetMessageTypeKey<BenchEventMsg>(), *subscriber);
+        services.emplace_back(*subscriber);
+    }
+    auto publisher = app.NewService<BenchPublisherService>(&event_mgr, &published);
+    services.emplace_back(*publisher);
+
+    Result result;
+    result.name = std::format("runtime.event_fan_out_{}", subscriber_count);
+    result.ops = event_count * subscriber_count;
+    auto begin_ns = NowNs();
+    app.Send<BenchStartMsg>(*publisher, *publisher, event_count);
+    done.get_future().get();
+    result.elapsed_ns = NowNs() - begin_ns;
+    // 发布者退出循环后才能析构event_mgr
+    published.get_future().get();
+    result.metrics["events"] = static_cast<double>(event_count);
+    runner.Add(std::move(result));
+
+    StopServices(app, services);
+}
+
+static void BenchTimerStorm(Runner& runner) {
+    auto& app = runner.app();
+    std::promise<uint64_t> insert_ns;
+    std::promise<void> done;
+    auto timer = app.NewService<BenchTimerService>(&insert_ns, &done);
+
+    Result result;
+    result.name = "runtime.timer_storm";
+    result.ops = runner.Scale(500000);
+    auto begin_ns = NowNs();
+    app.Send<BenchTimerStormMsg>(*timer, *timer, result.ops, 10);
+    auto insert_elapsed_ns = insert_ns.get_future().get();
+    done.get_future().get();
+    result.elapsed_ns = NowNs() - begin_ns;
+    // 总耗时包含等待最后一批到期的时间，插入开销单独统计
+    result.metrics["insert_ns_per_op"] = static_cast<double>(insert_elapsed_ns) / result.ops;
+    runner.Add(std::move(result));
+
+    StopServices(app, { *timer });
+}
+
+void RunRuntimeBenches(Runner& runner) {
+    if (runner.Enabled("runtime.ping_pong")) BenchPingPong(runner);
+    if (runner.Enabled("runtime.call_rtt")) BenchCallRoundTrip(runner);
+    for (size_t producer_count : { 1, 4, 8 }) {
+        if (runner.Enabled(std::format("runtime.mailbox_{}p1c", producer_count))) BenchMailbox(runner, producer_count);
+    }
+    for (size_t subscriber_count : { 1, 16, 128 }) {
+        if (runner.Enabled(std::format("runtime.event_fan_out_{}", subscriber_count))) BenchEventFanOut(runner, subscriber_count);
+    }
+    if (runner.Enabled("runtime.timer_storm")) BenchTimerStorm(runner);
+}
+
+} // namespace bench
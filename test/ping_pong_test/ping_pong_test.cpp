@@ -0,0 +1,152 @@
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <future>
+#include <string>
+
+#include <asio.hpp>
+
+#include <million/imillion.h>
+
+MILLION_MODULE_INIT();
+
+MILLION_MESSAGE_DEFINE(, PingMsg, (uint64_t) seq);
+MILLION_MESSAGE_DEFINE(, PongMsg, (uint64_t) seq);
+MILLION_MESSAGE_DEFINE(, PingPongStartMsg, (uint32_t) round_count);
+MILLION_MESSAGE_DEFINE(, PingPongResultMsg, (std::vector<uint64_t>) latencies_ns);
+
+class PongService : public million::IService {
+    MILLION_SERVICE_DEFINE(PongService);
+
+public:
+    using Base = million::IService;
+    using Base::Base;
+
+    MILLION_MESSAGE_HANDLE(PingMsg, msg) {
+        co_return million::make_message<PongMsg>(msg->seq);
+    }
+};
+
+class PingService : public million::IService {
+    MILLION_SERVICE_DEFINE(PingService);
+
+public:
+    using Base = million::IService;
+    PingService(million::IMillion* imillion, million::ServiceHandle pong)
+        : Base(imillion)
+        , pong_(std::move(pong)) {}
+
+    MILLION_MESSAGE_HANDLE(PingPongStartMsg, msg) {
+        std::vector<uint64_t> latencies_ns;
+        latencies_ns.reserve(msg->round_count);
+        for (uint32_t i = 0; i < msg->round_count; ++i) {
+            auto start = std::chrono::steady_clock::now();
+            auto res = co_await Call<PingMsg, PongMsg>(pong_, i);
+            auto end = std::chrono::steady_clock::now();
+            if (res->seq != i) {
+                logger().LOG_ERROR("pong seq mismatch: {} != {}.", res->seq, i);
+            }
+            latencies_ns.emplace_back(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+        }
+        co_return million::make_message<PingPongResultMsg>(std::move(latencies_ns));
+    }
+
+private:
+    million::ServiceHandle pong_;
+};
+
+// 外部线程通过该服务发起测试，并等待结果
+class DriverService : public million::IService {
+    MILLION_SERVICE_DEFINE(DriverService);
+
+public:
+    using Base = million::IService;
+    DriverService(million::IMillion* imillion, million::ServiceHandle ping, std::promise<std::vector<uint64_t>>* result)
+        : Base(imillion)
+        , ping_(std::move(ping))
+        , result_(result) {}
+
+    MILLION_MESSAGE_HANDLE(PingPongStartMsg, msg) {
+        auto res = co_await CallWithTimeout<PingPongStartMsg, PingPongResultMsg>(ping_, million::kSessionNeverTimeout, msg->round_count);
+        result_->set_value(std::move(res->latencies_ns));
+        co_return nullptr;
+    }
+
+private:
+    million::ServiceHandle ping_;
+    std::promise<std::vector<uint64_t>>* result_;
+};
+
+class TestApp : public million::IMillion {
+};
+
+static uint64_t Percentile(const std::vector<uint64_t>& sorted, double p) {
+    if (sorted.empty()) {
+        return 0;
+    }
+    auto index = static_cast<size_t>(p * (sorted.size() - 1));
+    return sorted[index];
+}
+
+// 以普通的HTTP GET抓取指标接口
+static std::string HttpGet(const std::string& host, const std::string& port, const std::string& path) {
+    asio::io_context io_context;
+    asio::ip::tcp::resolver resolver(io_context);
+    asio::ip::tcp::socket socket(io_context);
+    asio::connect(socket, resolver.resolve(host, port));
+    auto request = "GET " + path + " HTTP/1.1\r\nHost: " + host + "\r\nConnection: close\r\n\r\n";
+    asio::write(socket, asio::buffer(request));
+    std::string response;
+    asio::error_code ec;
+    asio::read(socket, asio::dynamic_buffer(response), ec);
+    return response;
+}
+
+int main(int argc, char* argv[]) {
+    uint32_t round_count = 100000;
+    if (argc > 1) {
+        round_count = std::stoul(argv[1]);
+    }
+
+    auto test_app = std::make_unique<TestApp>();
+    if (!test_app->Init("ping_pong_test_settings.yaml")) {
+        return 0;
+    }
+    test_app->Start();
+
+    auto pong = test_app->NewService<PongService>();
+    auto ping = test_app->NewService<PingService>(*pong);
+    std::promise<std::vector<uint64_t>> result;
+    auto driver = test_app->NewService<DriverService>(*ping, &result);
+    if (!pong || !ping || !driver) {
+        return 0;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    test_app->Send<PingPongStartMsg>(*driver, *driver, round_count);
+    auto latencies_ns = result.get_future().get();
+    auto end = std::chrono::steady_clock::now();
+
+    std::sort(latencies_ns.begin(), latencies_ns.end());
+    auto total_ms = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
+    std::cout << "ping-pong rounds: " << latencies_ns.size() << ", total: " << total_ms << "ms" << std::endl;
+    std::cout << "rtt(ns) p50: " << Percentile(latencies_ns, 0.5)
+        << ", p90: " << Percentile(latencies_ns, 0.9)
+        << ", p99: " << Percentile(latencies_ns, 0.99)
+        << ", p999: " << Percentile(latencies_ns, 0.999)
+        << ", max: " << (latencies_ns.empty() ? 0 : latencies_ns.back()) << std::endl;
+
+    try {
+        std::cout << HttpGet("127.0.0.1", "9100", "/metrics") << std::endl;
+    }
+    catch (const std::exception& e) {
+        std::cout << "scrape metrics failed: " << e.what() << std::endl;
+    }
+
+    if (test_app->DumpTrace("ping_pong_trace.json")) {
+        std::cout << "trace dumped to ping_pong_trace.json" << std::endl;
+    }
+
+    return 0;
+}